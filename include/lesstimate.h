@@ -7,7 +7,21 @@
 #include "lesstimate/glmnet_class.h"
 #include "lesstimate/glmnet_penalties.h"
 #include "lesstimate/bfgsOptim.h"
+#include "lesstimate/svrg_class.h"
+#include "lesstimate/sparse_models.h"
+#include "lesstimate/parallel.h"
+#include "lesstimate/profiling.h"
+#include "lesstimate/numerical_gradients.h"
+#include "lesstimate/sum_over_observations.h"
+#include "lesstimate/cached_model.h"
+#include "lesstimate/autodiff.h"
 #include "lesstimate/simplified_interfaces.h"
+#include "lesstimate/batch_fitting.h"
+#include "lesstimate/regularization_path.h"
+#include "lesstimate/async_fitting.h"
+#include "lesstimate/reverse_communication.h"
+#include "lesstimate/stability_selection.h"
+#include "lesstimate/mixed_precision.h"
 
 namespace less = lessSEM;
 
@@ -0,0 +1,294 @@
+#ifndef ASYNC_FITTING_H
+#define ASYNC_FITTING_H
+// fitGlmnet, fitIsta, and fitGlmnetPath block the calling thread until the
+// optimization is finished. The asynchronous versions below run the fit on a
+// thread pool managed by lesstimate and immediately return a handle (asyncFit).
+// The handle can be used to poll the progress of the fit (current iteration, best
+// fit so far, and a snapshot of the corresponding parameters), to cancel the fit,
+// and to wait for the results.
+//
+// Example:
+//
+// lessSEM::asyncFit<lessSEM::fitResults> handle = lessSEM::fitGlmnetAsync(model, startingValues, labels, penalty, lambda, theta);
+// while (!handle.ready())
+// {
+//   std::cout << handle.iteration() << ": " << handle.bestFit() << std::endl;
+//   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+// }
+// lessSEM::fitResults fitResults_ = handle.get();
+//
+// Note: The model is used by the thread pool until the fit is finished. It must outlive
+// the fit and must not be used by other threads in the meantime. When using R, the fits
+// run synchronously when they are started because the R API is single threaded.
+
+// the standard headers are included before common_headers.h because the latter defines error as a macro
+#include <future>
+#include <memory>
+
+#include "common_headers.h"
+#include "simplified_interfaces.h"
+#include "regularization_path.h"
+#include "fit_progress.h"
+#include "parallel.h"
+
+namespace lessSEM
+{
+
+  /**
+   * @brief returns the thread pool which runs the asynchronous fits. The pool is created when the
+   * first asynchronous fit is started.
+   *
+   * @return threadPool&
+   */
+  inline threadPool &asyncExecutor()
+  {
+#if USE_R
+    static threadPool executor(1);
+#else
+    // the pool counts the calling thread, which does not work on submitted tasks
+    static threadPool executor(std::max(std::thread::hardware_concurrency(), 1u) + 1);
+#endif
+    return (executor);
+  }
+
+  /**
+   * @brief handle to a fit running on the asyncExecutor. Destroying the handle before the results were
+   * retrieved cancels the fit and waits until it is stopped.
+   */
+  template <typename T>
+  class asyncFit
+  {
+  public:
+    /**
+     * @brief Construct a new handle
+     *
+     * @param result_ future of the results
+     * @param progress_ progress of the fit
+     */
+    asyncFit(std::future<T> result_,
+             std::shared_ptr<fitProgress> progress_) : result(std::move(result_)),
+                                                       progress(progress_) {}
+
+    asyncFit(asyncFit &&) = default;
+    asyncFit(const asyncFit &) = delete;
+    asyncFit &operator=(const asyncFit &) = delete;
+    asyncFit &operator=(asyncFit &&) = delete;
+
+    ~asyncFit()
+    {
+      if (result.valid())
+      {
+        progress->cancel();
+        result.wait();
+      }
+    }
+
+    /**
+     * @brief returns true if the fit is finished
+     *
+     * @return bool
+     */
+    bool ready() const
+    {
+      return (result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+
+    /**
+     * @brief blocks until the fit is finished
+     */
+    void wait() const
+    {
+      result.wait();
+    }
+
+    /**
+     * @brief blocks until the fit is finished and returns the results. Errors of the fit are rethrown.
+     * Can only be called once.
+     *
+     * @return T
+     */
+    T get()
+    {
+      if (!result.valid())
+        error("The results of the asynchronous fit have already been retrieved.");
+      return (result.get());
+    }
+
+    /**
+     * @brief asks the fit to stop after the current outer iteration. get() then returns the current
+     * parameter values with convergence = false.
+     */
+    void cancel()
+    {
+      progress->cancel();
+    }
+
+    /**
+     * @brief returns the outer iteration of the current fit
+     *
+     * @return unsigned int
+     */
+    unsigned int iteration() const
+    {
+      return (progress->iteration());
+    }
+
+    /**
+     * @brief returns the number of finished fits (e.g., lambda values of a regularization path)
+     *
+     * @return unsigned int
+     */
+    unsigned int completedFits() const
+    {
+      return (progress->completedFits());
+    }
+
+    /**
+     * @brief returns the best regularized fit of the current fit so far
+     *
+     * @return double
+     */
+    double bestFit() const
+    {
+      return (progress->bestFit());
+    }
+
+    /**
+     * @brief returns the parameters with the best fit of the current fit so far (see fitProgress::snapshot)
+     *
+     * @return fitResults
+     */
+    fitResults snapshot() const
+    {
+      return (progress->snapshot());
+    }
+
+  private:
+    std::future<T> result;
+    std::shared_ptr<fitProgress> progress;
+  };
+
+  /**
+   * @brief runs a fit on the asyncExecutor
+   *
+   * @param fit function running the fit. Receives the progress object which must be passed to the optimizer.
+   * @return asyncFit<T>
+   */
+  template <typename T>
+  inline asyncFit<T> launchAsyncFit(std::function<T(fitProgress &)> fit)
+  {
+    std::shared_ptr<fitProgress> progress = std::make_shared<fitProgress>();
+    std::shared_ptr<std::packaged_task<T()>> task = std::make_shared<std::packaged_task<T()>>(
+        [fit, progress]()
+        {
+          return (fit(*progress));
+        });
+    std::future<T> result = task->get_future();
+    // errors are stored in the future of the packaged task
+    asyncExecutor().submit([task]()
+                           { (*task)(); });
+    return (asyncFit<T>(std::move(result), progress));
+  }
+
+  /**
+   * @brief Asynchronous version of fitGlmnet. See fitGlmnet for details on the arguments.
+   *
+   * @return asyncFit<fitResults>
+   */
+  inline asyncFit<fitResults> fitGlmnetAsync(
+      model &userModel,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+      controlGLMNET controlOptimizer = controlGlmnetDefault(),
+      const int verbose = 0)
+  {
+    // the arguments are copied because the fit outlives the call
+    return (launchAsyncFit<fitResults>(
+        [&userModel, startingValues, parameterLabels, penalty, lambda, theta, initialHessian, controlOptimizer, verbose](fitProgress &progress)
+        {
+          controlGLMNET control_ = controlOptimizer;
+          control_.progress = &progress;
+          return (fitGlmnet(userModel,
+                            startingValues,
+                            parameterLabels,
+                            penalty,
+                            lambda,
+                            theta,
+                            initialHessian,
+                            control_,
+                            verbose));
+        }));
+  }
+
+  /**
+   * @brief Asynchronous version of fitIsta. See fitIsta for details on the arguments.
+   *
+   * @return asyncFit<fitResults>
+   */
+  inline asyncFit<fitResults> fitIstaAsync(
+      model &userModel,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      controlIsta controlOptimizer = controlIstaDefault(),
+      const int verbose = 0)
+  {
+    // the arguments are copied because the fit outlives the call
+    return (launchAsyncFit<fitResults>(
+        [&userModel, startingValues, parameterLabels, penalty, lambda, theta, controlOptimizer, verbose](fitProgress &progress)
+        {
+          controlIsta control_ = controlOptimizer;
+          control_.progress = &progress;
+          return (fitIsta(userModel,
+                          startingValues,
+                          parameterLabels,
+                          penalty,
+                          lambda,
+                          theta,
+                          control_,
+                          verbose));
+        }));
+  }
+
+  /**
+   * @brief Asynchronous version of fitGlmnetPath. See fitGlmnetPath for details on the arguments. completedFits()
+   * of the handle returns the number of lambda values which have been fitted. If the path is cancelled, the results
+   * of the remaining lambda values are NA.
+   *
+   * @return asyncFit<pathResults>
+   */
+  inline asyncFit<pathResults> fitGlmnetPathAsync(
+      model &userModel,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      const arma::rowvec &lambdas,
+      arma::rowvec theta,
+      arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+      controlGLMNET controlOptimizer = controlGlmnetDefault())
+  {
+    // the arguments are copied because the fit outlives the call
+    return (launchAsyncFit<pathResults>(
+        [&userModel, startingValues, parameterLabels, penalty, lambdas, theta, initialHessian, controlOptimizer](fitProgress &progress)
+        {
+          controlGLMNET control_ = controlOptimizer;
+          control_.progress = &progress;
+          return (fitGlmnetPath(userModel,
+                                startingValues,
+                                parameterLabels,
+                                penalty,
+                                lambdas,
+                                theta,
+                                initialHessian,
+                                control_));
+        }));
+  }
+
+}
+#endif
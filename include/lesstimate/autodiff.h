@@ -0,0 +1,414 @@
+#ifndef AUTODIFF_H
+#define AUTODIFF_H
+#include "common_headers.h"
+
+#include <cmath>
+#include <limits>
+#include "model.h"
+
+// Reverse mode automatic differentiation for models which implement the fit
+// function once, generically over the scalar type. The operations are recorded
+// on a tape which is reused between evaluations; after the first call, the
+// tape no longer allocates memory. The gradients are then computed with one
+// backward pass over the tape, which costs a small multiple of the fit.
+//
+// Example:
+//
+// class myModel : public lessSEM::autodiffModel<myModel>
+// {
+// public:
+//   template <typename scalar>
+//   scalar fitTemplate(const std::vector<scalar> &parameterValues,
+//                      const lessSEM::stringVector &parameterLabels)
+//   {
+//     scalar sse = 0.0;
+//     for (unsigned int i = 0; i < y.n_elem; i++)
+//       sse += lessSEM::ad::pow(y(i) - parameterValues[0] - parameterValues[1] * x(i), 2);
+//     return (sse);
+//   }
+// };
+//
+// Alternatively, fitTemplate can call the functions unqualified after
+// using namespace lessSEM::ad; (or using std::pow; etc.): the versions for
+// adVar are found by argument dependent lookup.
+
+namespace lessSEM
+{
+  class adVar;
+
+  /**
+   * @brief the tape records all operations on adVars. Each node stores the indices of
+   * up to two arguments and the partial derivatives of the node with respect to these arguments.
+   */
+  class adTape
+  {
+  public:
+    static constexpr unsigned int constant = std::numeric_limits<unsigned int>::max();
+
+    /**
+     * @brief remove all nodes from the tape. The memory is kept for the next evaluation.
+     */
+    void clear()
+    {
+      nodes.clear();
+    }
+
+    /**
+     * @brief add a node to the tape
+     *
+     * @param argument1 index of the first argument (or constant)
+     * @param partial1 partial derivative with respect to the first argument
+     * @param argument2 index of the second argument (or constant)
+     * @param partial2 partial derivative with respect to the second argument
+     * @return unsigned int index of the new node
+     */
+    unsigned int push(const unsigned int argument1, const double partial1,
+                      const unsigned int argument2 = constant, const double partial2 = 0.0)
+    {
+      nodes.push_back({argument1, argument2, partial1, partial2});
+      return ((unsigned int)(nodes.size() - 1));
+    }
+
+    /**
+     * @brief returns the number of nodes on the tape
+     *
+     * @return unsigned int
+     */
+    unsigned int size() const
+    {
+      return ((unsigned int)nodes.size());
+    }
+
+    /**
+     * @brief computes the derivatives of node output with respect to all nodes.
+     *
+     * @param output index of the node that should be differentiated
+     * @return const std::vector<double>& adjoints of all nodes
+     */
+    const std::vector<double> &backward(const unsigned int output)
+    {
+      adjoints.assign(nodes.size(), 0.0);
+      if (output == constant)
+        return (adjoints);
+
+      adjoints.at(output) = 1.0;
+      for (unsigned int i = output + 1; i-- > 0;)
+      {
+        const double adjoint = adjoints[i];
+        if (adjoint == 0.0)
+          continue;
+        const node &node_ = nodes[i];
+        if (node_.argument1 != constant)
+          adjoints[node_.argument1] += adjoint * node_.partial1;
+        if (node_.argument2 != constant)
+          adjoints[node_.argument2] += adjoint * node_.partial2;
+      }
+      return (adjoints);
+    }
+
+  private:
+    struct node
+    {
+      unsigned int argument1;
+      unsigned int argument2;
+      double partial1;
+      double partial2;
+    };
+    std::vector<node> nodes;
+    std::vector<double> adjoints;
+  };
+
+  /**
+   * @brief scalar type for reverse mode automatic differentiation. adVars which are
+   * created from a double are constants and are not recorded on the tape.
+   */
+  class adVar
+  {
+  public:
+    double value;       ///> value of the variable
+    unsigned int index; ///> position on the tape (adTape::constant for constants)
+    adTape *tape;       ///> tape the variable is recorded on
+
+    adVar(const double value_ = 0.0) : value(value_), index(adTape::constant), tape(nullptr) {}
+    adVar(const double value_, const unsigned int index_, adTape *tape_) : value(value_), index(index_), tape(tape_) {}
+
+    adVar &operator+=(const adVar &other)
+    {
+      *this = *this + other;
+      return (*this);
+    }
+    adVar &operator-=(const adVar &other)
+    {
+      *this = *this - other;
+      return (*this);
+    }
+    adVar &operator*=(const adVar &other)
+    {
+      *this = *this * other;
+      return (*this);
+    }
+    adVar &operator/=(const adVar &other)
+    {
+      *this = *this / other;
+      return (*this);
+    }
+
+    friend adVar operator+(const adVar &a, const adVar &b)
+    {
+      return (record(a.value + b.value, a, 1.0, b, 1.0));
+    }
+    friend adVar operator-(const adVar &a, const adVar &b)
+    {
+      return (record(a.value - b.value, a, 1.0, b, -1.0));
+    }
+    friend adVar operator*(const adVar &a, const adVar &b)
+    {
+      return (record(a.value * b.value, a, b.value, b, a.value));
+    }
+    friend adVar operator/(const adVar &a, const adVar &b)
+    {
+      const double result = a.value / b.value;
+      return (record(result, a, 1.0 / b.value, b, -result / b.value));
+    }
+    friend adVar operator-(const adVar &a)
+    {
+      return (record(-a.value, a, -1.0));
+    }
+
+    friend bool operator<(const adVar &a, const adVar &b) { return (a.value < b.value); }
+    friend bool operator>(const adVar &a, const adVar &b) { return (a.value > b.value); }
+    friend bool operator<=(const adVar &a, const adVar &b) { return (a.value <= b.value); }
+    friend bool operator>=(const adVar &a, const adVar &b) { return (a.value >= b.value); }
+    friend bool operator==(const adVar &a, const adVar &b) { return (a.value == b.value); }
+    friend bool operator!=(const adVar &a, const adVar &b) { return (a.value != b.value); }
+
+    /**
+     * @brief records a unary operation
+     *
+     * @param result value of the operation
+     * @param a argument
+     * @param partial derivative of the operation with respect to a
+     * @return adVar
+     */
+    static adVar record(const double result, const adVar &a, const double partial)
+    {
+      if (a.tape == nullptr)
+        return (adVar(result));
+      return (adVar(result, a.tape->push(a.index, partial), a.tape));
+    }
+
+    /**
+     * @brief records a binary operation
+     *
+     * @param result value of the operation
+     * @param a first argument
+     * @param partialA derivative of the operation with respect to a
+     * @param b second argument
+     * @param partialB derivative of the operation with respect to b
+     * @return adVar
+     */
+    static adVar record(const double result,
+                        const adVar &a, const double partialA,
+                        const adVar &b, const double partialB)
+    {
+      adTape *tape_ = (a.tape != nullptr) ? a.tape : b.tape;
+      if (tape_ == nullptr)
+        return (adVar(result));
+      return (adVar(result, tape_->push(a.index, partialA, b.index, partialB), tape_));
+    }
+  };
+
+  // Elementary functions for adVars. They are found by argument dependent lookup.
+  inline adVar exp(const adVar &a)
+  {
+    const double result = std::exp(a.value);
+    return (adVar::record(result, a, result));
+  }
+  inline adVar log(const adVar &a)
+  {
+    return (adVar::record(std::log(a.value), a, 1.0 / a.value));
+  }
+  inline adVar log1p(const adVar &a)
+  {
+    return (adVar::record(std::log1p(a.value), a, 1.0 / (1.0 + a.value)));
+  }
+  inline adVar sqrt(const adVar &a)
+  {
+    const double result = std::sqrt(a.value);
+    return (adVar::record(result, a, 0.5 / result));
+  }
+  inline adVar pow(const adVar &a, const double exponent)
+  {
+    return (adVar::record(std::pow(a.value, exponent), a, exponent * std::pow(a.value, exponent - 1.0)));
+  }
+  inline adVar pow(const adVar &a, const int exponent)
+  {
+    return (pow(a, (double)exponent));
+  }
+  inline adVar pow(const adVar &a, const adVar &b)
+  {
+    const double result = std::pow(a.value, b.value);
+    return (adVar::record(result,
+                          a, b.value * std::pow(a.value, b.value - 1.0),
+                          b, (a.value > 0.0) ? result * std::log(a.value) : 0.0));
+  }
+  inline adVar sin(const adVar &a)
+  {
+    return (adVar::record(std::sin(a.value), a, std::cos(a.value)));
+  }
+  inline adVar cos(const adVar &a)
+  {
+    return (adVar::record(std::cos(a.value), a, -std::sin(a.value)));
+  }
+  inline adVar tanh(const adVar &a)
+  {
+    const double result = std::tanh(a.value);
+    return (adVar::record(result, a, 1.0 - result * result));
+  }
+  inline adVar abs(const adVar &a)
+  {
+    return (adVar::record(std::abs(a.value), a, (a.value >= 0.0) ? 1.0 : -1.0));
+  }
+
+  // Elementary functions for fitTemplate: the versions for double are used when the fit is
+  // evaluated without derivatives, the versions for adVar when the gradients are computed.
+  // They are collected in a nested namespace so that the std functions are not pulled into
+  // lessSEM (and into user code with using namespace lessSEM).
+  namespace ad
+  {
+    using std::abs;
+    using std::cos;
+    using std::exp;
+    using std::log;
+    using std::log1p;
+    using std::pow;
+    using std::sin;
+    using std::sqrt;
+    using std::tanh;
+
+    using lessSEM::abs;
+    using lessSEM::cos;
+    using lessSEM::exp;
+    using lessSEM::log;
+    using lessSEM::log1p;
+    using lessSEM::pow;
+    using lessSEM::sin;
+    using lessSEM::sqrt;
+    using lessSEM::tanh;
+  }
+
+  /**
+   * @brief base class for models with automatic gradients. The user specified model
+   * should inherit from autodiffModel<myModel> (curiously recurring template pattern) and
+   * implement
+   *
+   * template <typename scalar>
+   * scalar fitTemplate(const std::vector<scalar> &parameterValues, const stringVector &parameterLabels)
+   *
+   * which is called with scalar = double by fit and with scalar = adVar by gradients.
+   * The fit value computed in gradients is cached so that a subsequent call to fit with
+   * the same parameters does not evaluate the model again.
+   *
+   * @tparam derivedModel the user specified model
+   */
+  template <class derivedModel>
+  class autodiffModel : public model
+  {
+  public:
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      if (cacheIsValid(parameterValues))
+        return (cachedFit);
+
+      doubleParameters.resize(parameterValues.n_elem);
+      for (unsigned int i = 0; i < parameterValues.n_elem; i++)
+        doubleParameters[i] = parameterValues.at(i);
+      return (static_cast<derivedModel *>(this)->fitTemplate(doubleParameters, parameterLabels.legacy()));
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      arma::rowvec gradients_;
+      fitAndGradients(parameterValues, parameterLabels.legacy(), gradients_);
+      return (gradients_);
+    }
+
+    /**
+     * @brief computes the fit and the gradients with a single evaluation of the model
+     *
+     * @param parameterValues parameter values
+     * @param parameterLabels parameter labels
+     * @param gradients_ will be overwritten with the gradients
+     * @return double fit value
+     */
+    double fitAndGradients(const arma::rowvec &parameterValues,
+                           const stringVector &parameterLabels,
+                           arma::rowvec &gradients_)
+    {
+      tape.clear();
+      adParameters.resize(parameterValues.n_elem);
+      // the parameters are the first nodes on the tape; they have no arguments
+      for (unsigned int i = 0; i < parameterValues.n_elem; i++)
+        adParameters[i] = adVar(parameterValues.at(i), tape.push(adTape::constant, 0.0), &tape);
+
+      const adVar result = static_cast<derivedModel *>(this)->fitTemplate(adParameters, parameterLabels);
+
+      const std::vector<double> &adjoints = tape.backward(result.index);
+      gradients_.set_size(parameterValues.n_elem);
+      for (unsigned int i = 0; i < parameterValues.n_elem; i++)
+        gradients_.at(i) = adjoints[i];
+
+      cachedParameters = parameterValues;
+      cachedFit = result.value;
+      hasCache = true;
+
+      return (result.value);
+    }
+
+  protected:
+    /**
+     * @brief must be called by the derived model if anything other than the parameters
+     * changes the fit (e.g., the data)
+     */
+    void invalidateCache()
+    {
+      hasCache = false;
+    }
+
+  private:
+    adTape tape;
+    std::vector<adVar> adParameters;
+    std::vector<double> doubleParameters;
+    arma::rowvec cachedParameters;
+    double cachedFit = 0.0;
+    bool hasCache = false;
+
+    bool cacheIsValid(const arma::rowvec &parameterValues) const
+    {
+      if (!hasCache || (cachedParameters.n_elem != parameterValues.n_elem))
+        return (false);
+      for (unsigned int i = 0; i < parameterValues.n_elem; i++)
+      {
+        if (cachedParameters.at(i) != parameterValues.at(i))
+          return (false);
+      }
+      return (true);
+    }
+  };
+
+}
+#endif
@@ -0,0 +1,359 @@
+#ifndef BATCH_FITTING_H
+#define BATCH_FITTING_H
+// Fitting many small, independent models (e.g., bootstrap samples, simulation
+// studies, or separate models for segments of the data). For models with few
+// parameters, the overhead of fitGlmnet and fitIsta (setting up the penalties,
+// allocating the memory of the optimizer, and copying the results) is often
+// larger than the optimization itself. The batch functions set up the penalties
+// once per thread, reuse one optimizer object per thread for all models (see
+// glmnetOptimizer and istaOptimizer), and write the results of all fits into
+// a single batchFitResults object.
+//
+// Note: When using R, the models are fitted sequentially because the R API is single threaded.
+
+#include "common_headers.h"
+#include "simplified_interfaces.h"
+#include "parallel.h"
+
+namespace lessSEM
+{
+  /**
+   * @struct batchFitResults
+   * @brief The results of fitting many models with the same parameter structure. Each element
+   * is stored as a single array with one entry per model.
+   * @var fit final fit value (regularized fit) of each model
+   * @var convergence 1 if the outer breaking condition was met for the model, 0 otherwise
+   * @var parameterValues matrix with final parameter values. Column i holds the parameters of model i
+   * so that the parameters of one model are contiguous in memory.
+   */
+  struct batchFitResults
+  {
+    arma::colvec fit;
+    arma::uvec convergence;
+    arma::mat parameterValues;
+  };
+
+  /**
+   * @brief checks the dimensions of the arguments of the batch functions and prepares the results
+   *
+   * @param nModels number of models
+   * @param startingValues matrix with starting values
+   * @param parameterLabels labels of the parameters
+   * @return batchFitResults
+   */
+  inline batchFitResults prepareBatchFitResults(const unsigned int nModels,
+                                                const arma::mat &startingValues,
+                                                const stringVector &parameterLabels)
+  {
+    if (startingValues.n_rows != (arma::uword)parameterLabels.size())
+      error("startingValues must have one row for each parameter.");
+    if ((startingValues.n_cols != 1) && (startingValues.n_cols != nModels))
+      error("startingValues must have one column or one column for each model.");
+
+    batchFitResults batchFitResults_;
+    batchFitResults_.fit.set_size(nModels);
+    batchFitResults_.fit.fill(NA_REAL);
+    batchFitResults_.convergence.zeros(nModels);
+    batchFitResults_.parameterValues.set_size(startingValues.n_rows, nModels);
+    batchFitResults_.parameterValues.fill(NA_REAL);
+    return (batchFitResults_);
+  }
+
+  /**
+   * @brief Fits many models with the glmnet optimizer. All models must have the same parameters
+   * (e.g., the same model fitted to different bootstrap samples). The settings are identical to those of
+   * fitGlmnet.
+   *
+   * @param userModels pointers to your models. Must inherit from lessSEM::model! Each model is only used
+   * by one thread at a time; the pointers must therefore refer to distinct objects.
+   * @param startingValues matrix with starting values. Column i holds the starting values of model i. If the matrix
+   * has only one column, the same starting values are used for all models.
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty vector with strings indicating the penalty for each parameter. See fitGlmnet.
+   * @param lambda lambda tuning parameter values. See fitGlmnet.
+   * @param theta theta tuning parameter values. See fitGlmnet.
+   * @param initialHessian matrix with initial Hessian values.
+   * @param controlOptimizer option to change the optimizer settings
+   * @param nThreads number of threads. If set to 0, the number of hardware threads is used.
+   * @param verbose should additional information be printed? See fitGlmnet.
+   * @return batchFitResults
+   */
+  inline batchFitResults fitGlmnetBatch(
+      const std::vector<model *> &userModels,
+      const arma::mat &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+      controlGLMNET controlOptimizer = controlGlmnetDefault(),
+      const unsigned int nThreads = 0,
+      const int verbose = 0)
+  {
+    const unsigned int numberParameters = startingValues.n_rows;
+    const unsigned int nModels = userModels.size();
+
+    batchFitResults batchFitResults_ = prepareBatchFitResults(nModels,
+                                                              startingValues,
+                                                              parameterLabels);
+
+    penalty = resizeVector(numberParameters, penalty);
+    lambda = resizeVector(numberParameters, lambda);
+    theta = resizeVector(numberParameters, theta);
+
+    std::vector<penaltyType> penalties = stringPenaltyToPenaltyType(penalty);
+
+    // If no Hessian is provided (1x1 matrix), the optimizer starts with a diagonal
+    // matrix and rescales it after the first step (see controlGLMNET.hessianScaling)
+    controlOptimizer.initialHessian = initialHessian;
+    // check if all elements are of equal length now:
+    std::vector<unsigned int> nElements{
+        (unsigned int)penalties.size(),
+        (unsigned int)lambda.n_elem,
+        (unsigned int)theta.n_elem};
+    if (initialHessian.n_elem != 1)
+    {
+      nElements.push_back(initialHessian.n_rows);
+      nElements.push_back(initialHessian.n_cols);
+    }
+
+    if (!allEqual(nElements))
+    {
+      error("penalty, regularized, lambda, theta, alpha, nrow(initialHessian) and ncol(initialHessian) must all be of the same length.");
+    }
+
+    std::vector<double> weights(numberParameters);
+
+    for (unsigned int i = 0; i < penalties.size(); i++)
+    {
+      if (penalties.at(i) != penaltyType::none)
+      {
+        weights.at(i) = 1.0;
+      }
+      else
+      {
+        weights.at(i) = 0.0;
+      }
+    }
+
+    if (verbose)
+      printPenaltyDetails(
+          parameterLabels,
+          penalties,
+          lambda,
+          theta);
+
+    // the tuning parameters are only read by the penalties and can be shared by all threads
+    tuningParametersMixedGlmnet tp;
+    tp.alpha = arma::rowvec(numberParameters, arma::fill::ones);
+    tp.lambda = lambda;
+    tp.penaltyType_ = penalties;
+    tp.theta = theta;
+    tp.weights = weights;
+
+#if USE_R
+    threadPool pool(1);
+#else
+    threadPool pool(nThreads);
+#endif
+
+    // the models are already fitted concurrently. A speculative line search would
+    // additionally copy each model (see speculative_evaluation.h)
+    if (pool.size() > 1)
+      controlOptimizer.speculativeTrials = 0;
+
+    // the penalties have internal workspaces; each thread therefore gets its own penalty and optimizer
+    struct threadResources
+    {
+      glmnetOptimizer optimizer;
+      penaltyMixedGlmnet pen;
+      noSmoothPenalty<tuningParametersMixedGlmnet> smoothPen;
+      arma::rowvec startingValues_;
+      fitResults fitResults_;
+
+      threadResources(const controlGLMNET &control_) : optimizer(control_) {}
+    };
+    std::vector<std::unique_ptr<threadResources>> resources;
+    for (unsigned int i = 0; i < std::min(pool.size(), std::max(nModels, 1u)); i++)
+    {
+      resources.emplace_back(new threadResources(controlOptimizer));
+      initializeMixedPenaltiesGlmnet(resources.back()->pen,
+                                     penalties);
+    }
+
+    // the models are handed out one at a time; slowly converging fits do not hold up the other threads
+    pool.parallelForDynamic(
+        nModels,
+        [&](const unsigned int i, const unsigned int worker)
+        {
+          threadResources &resources_ = *resources.at(worker);
+          resources_.startingValues_ = arma::trans(startingValues.col(startingValues.n_cols == 1 ? 0 : i));
+
+          resources_.optimizer.optimize(*userModels.at(i),
+                                        resources_.startingValues_,
+                                        parameterLabels,
+                                        resources_.pen,
+                                        resources_.smoothPen,
+                                        tp,
+                                        resources_.fitResults_);
+
+          // each model writes to its own elements; no synchronization is required
+          batchFitResults_.fit.at(i) = resources_.fitResults_.fit;
+          batchFitResults_.convergence.at(i) = resources_.fitResults_.convergence;
+          batchFitResults_.parameterValues.col(i) = arma::trans(resources_.fitResults_.parameterValues);
+        },
+        resources.size());
+
+    return (batchFitResults_);
+  }
+
+  /**
+   * @brief Fits many models with the ista optimizer. All models must have the same parameters
+   * (e.g., the same model fitted to different bootstrap samples). The settings are identical to those of
+   * fitIsta.
+   *
+   * @param userModels pointers to your models. Must inherit from lessSEM::model! Each model is only used
+   * by one thread at a time; the pointers must therefore refer to distinct objects.
+   * @param startingValues matrix with starting values. Column i holds the starting values of model i. If the matrix
+   * has only one column, the same starting values are used for all models.
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty vector with strings indicating the penalty for each parameter. See fitIsta.
+   * @param lambda lambda tuning parameter values. See fitIsta.
+   * @param theta theta tuning parameter values. See fitIsta.
+   * @param controlOptimizer option to change the optimizer settings
+   * @param nThreads number of threads. If set to 0, the number of hardware threads is used.
+   * @param verbose should additional information be printed? See fitIsta.
+   * @return batchFitResults
+   */
+  inline batchFitResults fitIstaBatch(
+      const std::vector<model *> &userModels,
+      const arma::mat &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      controlIsta controlOptimizer = controlIstaDefault(),
+      const unsigned int nThreads = 0,
+      const int verbose = 0)
+  {
+    const unsigned int numberParameters = startingValues.n_rows;
+    const unsigned int nModels = userModels.size();
+
+    batchFitResults batchFitResults_ = prepareBatchFitResults(nModels,
+                                                              startingValues,
+                                                              parameterLabels);
+
+    penalty = resizeVector(numberParameters, penalty);
+    lambda = resizeVector(numberParameters, lambda);
+    theta = resizeVector(numberParameters, theta);
+
+    std::vector<penaltyType> penalties = stringPenaltyToPenaltyType(penalty);
+
+    // check if all elements are of equal length now:
+    std::vector<unsigned int> nElements{
+        (unsigned int)penalties.size(),
+        (unsigned int)lambda.n_elem,
+        (unsigned int)theta.n_elem};
+
+    if (!allEqual(nElements))
+    {
+      error("penalty, regularized, lambda, theta, and alpha must all be of the same length.");
+    }
+
+    std::vector<double> weights(numberParameters);
+
+    for (unsigned int i = 0; i < penalties.size(); i++)
+    {
+      if (penalties.at(i) != penaltyType::none)
+      {
+        weights.at(i) = 1.0;
+      }
+      else
+      {
+        weights.at(i) = 0.0;
+      }
+    }
+
+    if (verbose)
+      printPenaltyDetails(
+          parameterLabels,
+          penalties,
+          lambda,
+          theta);
+
+    // the tuning parameters are only read by the penalties and can be shared by all threads
+    tuningParametersMixedPenalty tp;
+    tp.alpha = arma::rowvec(numberParameters, arma::fill::ones);
+    tp.lambda = lambda;
+    tp.pt = penalties;
+    tp.theta = theta;
+    tp.weights = weights;
+
+    tuningParametersEnet smoothTp;
+    smoothTp.alpha = 0.0;
+    smoothTp.lambda = 0.0;
+    smoothTp.weights = weights;
+
+#if USE_R
+    threadPool pool(1);
+#else
+    threadPool pool(nThreads);
+#endif
+
+    // the models are already fitted concurrently. A speculative line search would
+    // additionally copy each model (see speculative_evaluation.h)
+    if (pool.size() > 1)
+      controlOptimizer.speculativeTrials = 0;
+
+    // the penalties have internal workspaces; each thread therefore gets its own penalty and optimizer
+    struct threadResources
+    {
+      istaOptimizer optimizer;
+      proximalOperatorMixedPenalty proximalOperator_;
+      penaltyMixedPenalty penalty_;
+      penaltyRidge smoothPenalty_;
+      arma::rowvec startingValues_;
+      fitResults fitResults_;
+
+      threadResources(const controlIsta &control_) : optimizer(control_) {}
+    };
+    std::vector<std::unique_ptr<threadResources>> resources;
+    for (unsigned int i = 0; i < std::min(pool.size(), std::max(nModels, 1u)); i++)
+    {
+      resources.emplace_back(new threadResources(controlOptimizer));
+      initializeMixedProximalOperators(resources.back()->proximalOperator_,
+                                       penalties);
+      initializeMixedPenalties(resources.back()->penalty_,
+                               penalties);
+    }
+
+    // the models are handed out one at a time; slowly converging fits do not hold up the other threads
+    pool.parallelForDynamic(
+        nModels,
+        [&](const unsigned int i, const unsigned int worker)
+        {
+          threadResources &resources_ = *resources.at(worker);
+          resources_.startingValues_ = arma::trans(startingValues.col(startingValues.n_cols == 1 ? 0 : i));
+
+          resources_.optimizer.optimize(*userModels.at(i),
+                                        resources_.startingValues_,
+                                        parameterLabels,
+                                        resources_.proximalOperator_,
+                                        resources_.penalty_,
+                                        resources_.smoothPenalty_,
+                                        tp,
+                                        smoothTp,
+                                        resources_.fitResults_);
+
+          // each model writes to its own elements; no synchronization is required
+          batchFitResults_.fit.at(i) = resources_.fitResults_.fit;
+          batchFitResults_.convergence.at(i) = resources_.fitResults_.convergence;
+          batchFitResults_.parameterValues.col(i) = arma::trans(resources_.fitResults_.parameterValues);
+        },
+        resources.size());
+
+    return (batchFitResults_);
+  }
+
+}
+#endif
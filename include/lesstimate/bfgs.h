@@ -2,12 +2,118 @@
 #define BFGS_H
 
 #include "common_headers.h"
+#include "profiling.h"
+#include "diagnostics.h"
 
 namespace lessSEM
 {
 
   /**
-   * @brief computes the BFGS Hessian approximation
+   * Specifies how the initial Hessian approximation is scaled after the first step of the optimizer.
+   * The scaling is only applied if no full initial Hessian matrix is provided by the user.
+   */
+  enum initialHessianScaling
+  {
+    noHessianScaling,   /** Uses the initial Hessian as is.*/
+    shannoPhuaScaling,  /** Replaces the initial Hessian with (y'y)/(y's) * I, where s is the first step and y the change in gradients.
+                            See Shanno, D. F., & Phua, K. H. (1978). Matrix conditioning and nonlinear optimization. Mathematical
+                            Programming, 14, 149–160. https://doi.org/10.1007/BF01588962*/
+    diagonalHessianScaling /** Replaces the initial Hessian with a diagonal matrix with elements y_i/s_i. Elements with unreliable
+                               estimates fall back to the Shanno-Phua scaling.*/
+  };
+  const std::vector<std::string> initialHessianScaling_txt = {
+      "noHessianScaling",
+      "shannoPhuaScaling",
+      "diagonalHessianScaling"};
+
+  /**
+   * @brief Rescales the initial Hessian approximation after the first step of the optimizer.
+   * Should be called before the first BFGS update. If the change in gradients does not allow for
+   * a positive scaling (y's <= 0), the Hessian is not changed.
+   *
+   * @param scaling see initialHessianScaling
+   * @param parameters_kMinus1 parameters before the first step
+   * @param gradients_kMinus1 gradients before the first step
+   * @param parameters_k parameters after the first step
+   * @param gradients_k gradients after the first step
+   * @param Hessian will be overwritten with the scaled initial Hessian
+   * @return true if the Hessian was changed
+   */
+  inline bool scaleInitialHessian(const initialHessianScaling scaling,
+                                  const arma::rowvec &parameters_kMinus1,
+                                  const arma::rowvec &gradients_kMinus1,
+                                  const arma::rowvec &parameters_k,
+                                  const arma::rowvec &gradients_k,
+                                  arma::mat &Hessian)
+  {
+    if (scaling == noHessianScaling)
+      return (false);
+
+    const arma::uword nParameters = parameters_k.n_elem;
+    double yTimesS = 0.0;
+    double yTimesY = 0.0;
+    for (arma::uword i = 0; i < nParameters; i++)
+    {
+      const double y_i = gradients_k.at(i) - gradients_kMinus1.at(i);
+      yTimesS += y_i * (parameters_k.at(i) - parameters_kMinus1.at(i));
+      yTimesY += y_i * y_i;
+    }
+
+    // Nocedal, J., & Wright, S. J. (2006). Numerical optimization (2nd ed). Springer, Eq. 6.20
+    // (for the Hessian instead of its inverse)
+    const double scale = yTimesY / yTimesS;
+    if (!(yTimesS > 0.0) || !arma::is_finite(scale) || !(scale > 0.0))
+      return (false);
+
+    Hessian.zeros(nParameters, nParameters);
+
+    if (scaling == shannoPhuaScaling)
+    {
+      Hessian.diag().fill(scale);
+      return (true);
+    }
+
+    // diagonalHessianScaling: a single step only provides a rough estimate of the
+    // curvature in each direction. The elements are therefore restricted to a
+    // range around the Shanno-Phua scaling.
+    for (arma::uword i = 0; i < nParameters; i++)
+    {
+      const double s_i = parameters_k.at(i) - parameters_kMinus1.at(i);
+      const double curvature = (gradients_k.at(i) - gradients_kMinus1.at(i)) / s_i;
+      if ((s_i == 0.0) || !arma::is_finite(curvature) || !(curvature > 0.0))
+        Hessian.at(i, i) = scale;
+      else
+        Hessian.at(i, i) = std::min(std::max(curvature, 1e-2 * scale), 1e2 * scale);
+    }
+    return (true);
+  }
+
+  /**
+   * @brief computes max_i(H_ii * d_i^2), the convergence criterion of Yuan et al. (2012),
+   * using only the diagonal of the Hessian.
+   *
+   * @param Hessian Hessian (approximation)
+   * @param direction step direction
+   * @return double
+   */
+  inline double maxDiagonalDecrease(const arma::mat &Hessian,
+                                    const arma::rowvec &direction)
+  {
+    double maxDecrease = 0.0;
+    for (arma::uword i = 0; i < direction.n_elem; i++)
+    {
+      const double decrease = Hessian.at(i, i) * direction.at(i) * direction.at(i);
+      if (!arma::is_finite(decrease))
+        return (arma::datum::inf);
+      maxDecrease = std::max(maxDecrease, decrease);
+    }
+    return (maxDecrease);
+  }
+
+  /**
+   * @brief computes the BFGS Hessian approximation and writes it to Hessian_k. Uses the memory
+   * of Hessian_k and HessianTimesD; if these already have the correct size, no memory is allocated
+   * (with the exception of the rare case where the Hessian has to be made positive definite).
    *
    * @param parameters_kMinus1 parameters of previous iteration
    * @param gradients_kMinus1 gradients of previous iteration
@@ -16,10 +122,11 @@ namespace lessSEM
    * @param gradients_k gradients of current iteration
    * @param cautious boolean: should the update be skipped if it would result in a non positive definite Hessian?
    * @param hessianEps controls when the update of the Hessian approximation is skipped
-   * @param verbose if set to true, will print more details
-   * @return arma::mat: returns a matrix with parameter estimates
+   * @param verbose if set to true, problems with the update are reported even if no diagnostics collector is active (see diagnostics.h)
+   * @param Hessian_k will be overwritten with the new Hessian approximation. Must not be the same object as Hessian_kMinus1
+   * @param HessianTimesD workspace
    */
-  inline arma::mat BFGS(
+  inline void updateBFGS(
       const arma::rowvec &parameters_kMinus1,
       const arma::rowvec &gradients_kMinus1,
       const arma::mat &Hessian_kMinus1,
@@ -27,67 +134,99 @@ namespace lessSEM
       const arma::rowvec &gradients_k,
       const bool cautious,
       const double hessianEps,
-      bool verbose)
+      bool verbose,
+      arma::mat &Hessian_k,
+      arma::colvec &HessianTimesD)
   {
+    LESSTIMATE_PROFILE_SCOPE("updateBFGS");
+    const arma::uword nParameters = parameters_k.n_elem;
+    Hessian_k = Hessian_kMinus1;
+
+    // y = gradients_k - gradients_kMinus1 and d = parameters_k - parameters_kMinus1
+    // are computed on the fly to avoid allocating memory
+    double yTimesD = 0.0;
+    for (arma::uword i = 0; i < nParameters; i++)
+      yTimesD += (gradients_k.at(i) - gradients_kMinus1.at(i)) * (parameters_k.at(i) - parameters_kMinus1.at(i));
 
-    arma::rowvec y = gradients_k - gradients_kMinus1;
-    arma::rowvec d = parameters_k - parameters_kMinus1;
-    arma::mat yTimesD = y * arma::trans(d);
-    arma::mat Hessian_k = Hessian_kMinus1;
-    arma::mat ySquared, dHd;
-    bool skipUpdate = false;
     // test if positive definiteness is ensured
-    try
-    {
+    const bool skipUpdate = (yTimesD < hessianEps) && cautious;
 
-      skipUpdate = (yTimesD(0, 0) < hessianEps) && cautious;
-    }
-    catch (...)
+    if (yTimesD < 0)
     {
-      // skip in case of error: return Hessian_kMinus1
-      if (verbose)
-        warn("Hessian update skipped.");
-      return (Hessian_k);
+      reportDiagnostic(hessianUpdateNotPositiveDefinite, verbose);
+      if (skipUpdate)
+        return;
     }
-
-    if (yTimesD(0, 0) < 0)
+    if (!arma::is_finite(yTimesD))
     {
-      if (verbose)
-        warn("Hessian update possibly non-positive definite.");
-      if (skipUpdate)
-        return (Hessian_k);
+      // skip in case of error: return Hessian_kMinus1
+      reportDiagnostic(hessianUpdateSkipped, verbose);
+      return;
     }
 
     // see e.g., Nocedal, J., & Wright, S. J. (2006). Numerical optimization (2nd ed).
     // Springer, p. 537 Equation 18.16
+    // Hessian_k = Hessian_kMinus1 - (Hessian_kMinus1 * d^T * d * Hessian_kMinus1) / (d * Hessian_kMinus1 * d^T) +
+    //             y^T * y / (y * d^T)
+    HessianTimesD.set_size(nParameters);
+    for (arma::uword i = 0; i < nParameters; i++)
+      HessianTimesD.at(i) = 0.0;
+    for (arma::uword j = 0; j < nParameters; j++)
+    {
+      const double d_j = parameters_k.at(j) - parameters_kMinus1.at(j);
+      for (arma::uword i = 0; i < nParameters; i++)
+        HessianTimesD.at(i) += Hessian_kMinus1.at(i, j) * d_j;
+    }
+    double dHd = 0.0;
+    for (arma::uword i = 0; i < nParameters; i++)
+      dHd += (parameters_k.at(i) - parameters_kMinus1.at(i)) * HessianTimesD.at(i);
 
-    ySquared = arma::trans(y) * y;
-    dHd = d * Hessian_kMinus1 * arma::trans(d);
-
-    Hessian_k = Hessian_kMinus1 -
-                (Hessian_kMinus1 * arma::trans(d) * d * Hessian_kMinus1) / dHd(0, 0) +
-                ySquared / yTimesD(0, 0);
+    // for a symmetric Hessian_kMinus1, d * Hessian_kMinus1 is the transpose of Hessian_kMinus1 * d^T.
+    // Otherwise, the rank two update is not symmetric and is made symmetric below.
+    const bool symmetricHessian = Hessian_kMinus1.is_symmetric();
 
-    if (!arma::is_finite(Hessian_k))
+    for (arma::uword j = 0; j < nParameters; j++)
     {
-      if (verbose)
-        warn("Non-finite Hessian. Returning previous Hessian");
-      return (Hessian_kMinus1);
+      double dH_j = HessianTimesD.at(j);
+      if (!symmetricHessian)
+      {
+        dH_j = 0.0;
+        for (arma::uword i = 0; i < nParameters; i++)
+          dH_j += (parameters_k.at(i) - parameters_kMinus1.at(i)) * Hessian_kMinus1.at(i, j);
+      }
+      const double y_j = gradients_k.at(j) - gradients_kMinus1.at(j);
+      for (arma::uword i = 0; i < nParameters; i++)
+      {
+        Hessian_k.at(i, j) += -HessianTimesD.at(i) * dH_j / dHd +
+                              (gradients_k.at(i) - gradients_kMinus1.at(i)) * y_j / yTimesD;
+      }
     }
 
-    // check for symmetric positive definiteness
-    if (!Hessian_k.is_symmetric())
+    if (!Hessian_k.is_finite())
     {
-      // make symmetric
-      double sumElem = arma::accu(arma::pow(Hessian_k - .5 * (Hessian_k + arma::trans(Hessian_k)), 2));
-      if ((sumElem > 1) & verbose)
-        warn("Hessian not symmetric");
-      Hessian_k = .5 * (Hessian_k + arma::trans(Hessian_k));
+      reportDiagnostic(hessianNotFinite, verbose);
+      Hessian_k = Hessian_kMinus1;
+      return;
     }
-    else
+
+    // check for symmetric positive definiteness
+    if (Hessian_k.is_symmetric())
+      return;
+
+    // make symmetric
+    double sumElem = 0.0;
+    for (arma::uword j = 0; j < nParameters; j++)
     {
-      return (Hessian_k);
+      for (arma::uword i = j + 1; i < nParameters; i++)
+      {
+        const double average = .5 * (Hessian_k.at(i, j) + Hessian_k.at(j, i));
+        sumElem += 2.0 * std::pow(Hessian_k.at(i, j) - average, 2);
+        Hessian_k.at(i, j) = average;
+        Hessian_k.at(j, i) = average;
+      }
     }
+    if (sumElem > 1)
+      reportDiagnostic(hessianNotSymmetric, verbose);
 
     // we now know that the matrix is symmetric; lets check again
     // for positive definite
@@ -95,25 +234,55 @@ namespace lessSEM
     {
       // make positive definite
       // see https://nhigham.com/2021/02/16/diagonally-perturbing-a-symmetric-matrix-to-make-it-positive-definite/
-      if (verbose)
-        warn("Hessian not pd");
+      reportDiagnostic(hessianNotPositiveDefinite, verbose);
       arma::vec eigenValues = arma::eig_sym(Hessian_k);
-      arma::mat diagMat = arma::eye(Hessian_k.n_rows,
-                                    Hessian_k.n_cols);
-      diagMat.fill(0.0);
-      diagMat.diag() += -1.1 * arma::min(eigenValues);
-      Hessian_k = Hessian_k + diagMat;
+      Hessian_k.diag() += -1.1 * arma::min(eigenValues);
 
       // check again...
       if (!Hessian_k.is_sympd())
       {
         // return non-updated hessian
-        if (verbose)
-          warn("Invalid Hessian. Returning previous Hessian");
-        return (Hessian_kMinus1);
+        reportDiagnostic(hessianInvalid, verbose);
+        Hessian_k = Hessian_kMinus1;
       }
     }
+  }
 
+  /**
+   * @brief computes the BFGS Hessian approximation
+   *
+   * @param parameters_kMinus1 parameters of previous iteration
+   * @param gradients_kMinus1 gradients of previous iteration
+   * @param Hessian_kMinus1 Hessian of previous iteration
+   * @param parameters_k parameters of current iteration
+   * @param gradients_k gradients of current iteration
+   * @param cautious boolean: should the update be skipped if it would result in a non positive definite Hessian?
+   * @param hessianEps controls when the update of the Hessian approximation is skipped
+   * @param verbose if set to true, will print more details
+   * @return arma::mat: returns a matrix with parameter estimates
+   */
+  inline arma::mat BFGS(
+      const arma::rowvec &parameters_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const arma::mat &Hessian_kMinus1,
+      const arma::rowvec &parameters_k,
+      const arma::rowvec &gradients_k,
+      const bool cautious,
+      const double hessianEps,
+      bool verbose)
+  {
+    arma::mat Hessian_k;
+    arma::colvec HessianTimesD;
+    updateBFGS(parameters_kMinus1,
+               gradients_kMinus1,
+               Hessian_kMinus1,
+               parameters_k,
+               gradients_k,
+               cautious,
+               hessianEps,
+               verbose,
+               Hessian_k,
+               HessianTimesD);
     return (Hessian_k);
   }
 
@@ -7,6 +7,9 @@
 #include "proximalOperator.h"
 #include "glmnet_ridge.h"
 #include "bfgs.h"
+#include "line_search.h"
+#include "profiling.h"
+#include "diagnostics.h"
 
 // The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
 // user supplies a C++ class with methods fit and gradients which is used
@@ -30,17 +33,22 @@ namespace lessSEM
 
   /**
    * Specifies the convergence criteria that are currently available for the BFGS optimizer. The optimization stops if the specified convergence criterion is met.
+   * The trailing underscore distinguishes the enumerators from those of convergenceCriteriaGlmnet; they can also be
+   * qualified with the enum name (e.g., convergenceCriteriaBFGS::kkt_ vs. convergenceCriteriaGlmnet::kkt).
    */
   enum convergenceCriteriaBFGS
   {
     GLMNET_,    /** Uses the convergence criterion outlined in Yuan et al. (2012) for GLMNET. Note that in case of BFGS, this will be identical to using the Armijo condition.*/
     fitChange_, /** Uses the change in fit from one iteration to the next.*/
-    gradients_  /** Uses the gradients; if all are (close to) zero, the minimum is found*/
+    gradients_, /** Uses the gradients; if all are (close to) zero, the minimum is found*/
+    kkt_        /** Uses the largest absolute gradient; the optimization stops if
+                    max_j |g_j| <= breakKKTAbsolute + breakKKTRelative * max_j |g_j at the starting values|*/
   };
   const std::vector<std::string> convergenceCriteriaBFGS_txt = {
       "GLMNET_",
       "fitChange_",
-      "gradients_"};
+      "gradients_",
+      "kkt_"};
 
   /**
    * @struct controlBFGS
@@ -56,10 +64,16 @@ namespace lessSEM
    * @var maxIterLine Maximal number of iterations for the line search procedure
    * @var breakOuter Stopping criterion for outer iterations
    * @var breakInner Stopping criterion for inner iterations
-   * @var convergenceCriterion which convergence criterion should be used for the outer iterations? possible are 0 = GLMNET, 1 = fitChange, 2 = gradients.
-   * Note that in case of gradients and GLMNET, we divide the gradients (and the Hessian) of the log-Likelihood by N as it would otherwise be
+   * @var convergenceCriterion which convergence criterion should be used for the outer iterations? possible are 0 = GLMNET, 1 = fitChange, 2 = gradients,
+   * 3 = kkt_. Note that in case of gradients and GLMNET, we divide the gradients (and the Hessian) of the log-Likelihood by N as it would otherwise be
    * considerably more difficult for larger sample sizes to reach the convergence criteria.
    * @var verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @var lineSearch procedure used to find the step size in the outer iterations. See lineSearchType. If not
+   * specified, backtracking is used.
+   * @var hessianScaling if initialHessian is a 1x1 matrix (i.e., no full Hessian is provided), the initial Hessian
+   * is rescaled after the first step. See initialHessianScaling. If not specified, no scaling is used.
+   * @var breakKKTAbsolute absolute tolerance of the kkt_ convergence criterion
+   * @var breakKKTRelative tolerance of the kkt_ convergence criterion relative to the largest absolute gradient at the starting values
    */
   struct controlBFGS
   {
@@ -76,8 +90,208 @@ namespace lessSEM
     // breaking condition.
     const int verbose; // if set to a value > 0, the fit every verbose iterations
     // is printed.
+    const lineSearchType lineSearch; // procedure used to find the step size
+    const initialHessianScaling hessianScaling; // scaling of the initial Hessian if none is provided
+    const double breakKKTAbsolute;              // absolute tolerance of the kkt_ convergence criterion
+    const double breakKKTRelative;              // relative tolerance of the kkt_ convergence criterion
   };
 
+  /**
+   * @brief Finds a step size satisfying the strong Wolfe conditions
+   * phi(stepSize) <= sigma * stepSize * phi'(0) and |phi'(stepSize)| <= wolfeCurvature * |phi'(0)|,
+   * where phi(stepSize) = f(x + stepSize*d) - f(x). See Algorithms 3.5 and 3.6 in
+   * Nocedal, J., & Wright, S. J. (2006). Numerical Optimization (2nd ed.). Springer.
+   * If no such step size is found within maxIterLine evaluations, the largest step size
+   * satisfying the first condition is used.
+   *
+   * @param model_ the model object derived from the model class in model.h
+   * @param smoothPenalty a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param parameters_kMinus1 parameter estimates from previous iteration k-1
+   * @param parameterLabels names of the parameters
+   * @param direction step direction
+   * @param f_0 fit at parameters_kMinus1
+   * @param derivative_0 phi'(0); must be negative
+   * @param tuningParameters tuning parameters for the smoothPenalty function
+   * @param initialStepSize first trial step size
+   * @param sigma parameter of the sufficient decrease condition
+   * @param maxIterLine maximal number of fit evaluations
+   * @param stepSize_k will be overwritten with the accepted step size
+   * @param parameters_k will be overwritten with the updated parameters
+   * @return true if a step size satisfying the sufficient decrease condition was found
+   */
+  template <typename T> // T is the type of the tuning parameters
+  inline bool strongWolfeLineSearch(
+      model &model_,
+      smoothPenalty<T> &smoothPenalty_,
+      const arma::rowvec &parameters_kMinus1,
+      const stringVector &parameterLabels,
+      const arma::rowvec &direction,
+      const double f_0,
+      const double derivative_0,
+      const T &tuningParameters,
+      const double initialStepSize,
+      const double sigma,
+      const int maxIterLine,
+      double &stepSize_k,
+      arma::rowvec &parameters_k)
+  {
+    LESSTIMATE_PROFILE_SCOPE("bfgsOptim::strongWolfeLineSearch");
+    const labelHandle labels(parameterLabels);
+    arma::rowvec gradients_k;
+    int evaluations = 0;
+
+    // phi(stepSize); sets parameters_k to the trial parameters
+    auto phiAt = [&](const double trialStepSize) -> double
+    {
+      evaluations++;
+      parameters_k = parameters_kMinus1 + trialStepSize * direction;
+      return (LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k,
+                                                                   labels)) +
+              smoothPenalty_.getValue(parameters_k,
+                                      parameterLabels,
+                                      tuningParameters) -
+              f_0);
+    };
+    // phi'(stepSize) at the current trial parameters
+    auto derivativeAt = [&]() -> double
+    {
+      gradients_k = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                     labels)) +
+                    smoothPenalty_.getGradients(parameters_k,
+                                                parameterLabels,
+                                                tuningParameters);
+      return (arma::dot(gradients_k, direction));
+    };
+
+    const double curvatureBound = wolfeCurvature * std::abs(derivative_0);
+
+    // the interval [stepSize_lo, stepSize_hi] (or [stepSize_hi, stepSize_lo]) contains step sizes satisfying the
+    // strong Wolfe conditions once bracketed is true. stepSize_lo always satisfies the sufficient decrease condition.
+    double stepSize_lo = 0.0, phi_lo = 0.0, derivative_lo = derivative_0;
+    double stepSize_hi = 0.0, phi_hi = 0.0, derivative_hi = 0.0;
+    bool bracketed = false;
+
+    // bracketing phase
+    double currentStepSize = initialStepSize;
+    while (evaluations < maxIterLine)
+    {
+      const double phi = phiAt(currentStepSize);
+
+      if (!arma::is_finite(phi) ||
+          (phi > sigma * currentStepSize * derivative_0) ||
+          ((evaluations > 1) && (phi >= phi_lo)))
+      {
+        stepSize_hi = currentStepSize;
+        phi_hi = phi;
+        derivative_hi = arma::datum::nan;
+        bracketed = true;
+        break;
+      }
+
+      const double derivative = derivativeAt();
+
+      if (!arma::is_finite(derivative))
+      {
+        stepSize_hi = currentStepSize;
+        phi_hi = phi;
+        derivative_hi = arma::datum::nan;
+        bracketed = true;
+        break;
+      }
+
+      if (std::abs(derivative) <= curvatureBound)
+      {
+        stepSize_k = currentStepSize;
+        return (true);
+      }
+
+      if (derivative >= 0.0)
+      {
+        stepSize_hi = stepSize_lo;
+        phi_hi = phi_lo;
+        derivative_hi = derivative_lo;
+        stepSize_lo = currentStepSize;
+        phi_lo = phi;
+        derivative_lo = derivative;
+        bracketed = true;
+        break;
+      }
+
+      stepSize_lo = currentStepSize;
+      phi_lo = phi;
+      derivative_lo = derivative;
+      currentStepSize *= 2.0;
+    }
+
+    // zoom phase
+    while (bracketed && (evaluations < maxIterLine))
+    {
+      if (arma::is_finite(phi_hi) && arma::is_finite(derivative_hi))
+        currentStepSize = cubicMinimizerStepSize(stepSize_lo, phi_lo, derivative_lo,
+                                                 stepSize_hi, phi_hi, derivative_hi);
+      else if (arma::is_finite(phi_hi))
+        currentStepSize = quadraticMinimizerStepSize(stepSize_lo, phi_lo, derivative_lo,
+                                                     stepSize_hi, phi_hi);
+      else
+        currentStepSize = .5 * (stepSize_lo + stepSize_hi);
+
+      const double phi = phiAt(currentStepSize);
+
+      if (!arma::is_finite(phi) ||
+          (phi > sigma * currentStepSize * derivative_0) ||
+          (phi >= phi_lo))
+      {
+        stepSize_hi = currentStepSize;
+        phi_hi = phi;
+        derivative_hi = arma::datum::nan;
+      }
+      else
+      {
+        const double derivative = derivativeAt();
+
+        if (!arma::is_finite(derivative))
+        {
+          stepSize_hi = currentStepSize;
+          phi_hi = arma::datum::nan;
+          derivative_hi = arma::datum::nan;
+        }
+        else
+        {
+          if (std::abs(derivative) <= curvatureBound)
+          {
+            stepSize_k = currentStepSize;
+            return (true);
+          }
+
+          if (derivative * (stepSize_hi - stepSize_lo) >= 0.0)
+          {
+            stepSize_hi = stepSize_lo;
+            phi_hi = phi_lo;
+            derivative_hi = derivative_lo;
+          }
+          stepSize_lo = currentStepSize;
+          phi_lo = phi;
+          derivative_lo = derivative;
+        }
+      }
+
+      if (std::abs(stepSize_hi - stepSize_lo) <= 1e-12 * std::max(1.0, stepSize_lo))
+        break;
+    }
+
+    // the curvature condition could not be satisfied; use the step size with
+    // sufficient decrease (if there is one)
+    if (stepSize_lo > 0.0)
+    {
+      parameters_k = parameters_kMinus1 + stepSize_lo * direction;
+      stepSize_k = stepSize_lo;
+      return (true);
+    }
+
+    stepSize_k = currentStepSize;
+    return (false);
+  }
+
   /**
    * @brief   * Given a step direction "direction", the line search procedure will find an adequate
    * step length s in this direction. The new parameter values are then given by
@@ -99,10 +313,13 @@ namespace lessSEM
    * l1-regularized logistic regression. The Journal of Machine Learning Research, 13, 1999–2030. https://doi.org/10.1145/2020408.2020421. Defaults to 0.
    * @param maxIterLine Maximal number of iterations for the line search procedure
    * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
-   * @return vector with updated parameters (parameters_k)
+   * @param lineSearch_ backtracking, interpolation, or strongWolfe. See lineSearchType.
+   * @param stepSize_k step size accepted in the previous outer iteration (used by interpolation and strongWolfe
+   * to find the first trial step size). Will be overwritten with the step size accepted in this line search.
+   * @param parameters_k will be overwritten with the updated parameters
    */
   template <typename T> // T is the type of the tuning parameters
-  inline arma::rowvec bfgsLineSearch(
+  inline void bfgsLineSearch(
       model &model_,
       smoothPenalty<T> &smoothPenalty_,
       const arma::rowvec &parameters_kMinus1,
@@ -118,16 +335,18 @@ namespace lessSEM
       const double sigma,
       const double gamma,
       const int maxIterLine,
-      const int verbose)
+      const int verbose,
+      const lineSearchType lineSearch_,
+      double &stepSize_k,
+      arma::rowvec &parameters_k)
   {
+    LESSTIMATE_PROFILE_SCOPE("bfgsOptim::lineSearch");
+    const labelHandle labels(parameterLabels);
 
-    arma::rowvec gradients_k(gradients_kMinus1.n_rows);
-    gradients_k.fill(arma::datum::nan);
-    arma::rowvec parameters_k(gradients_kMinus1.n_rows);
+    arma::rowvec gradients_k;
+    parameters_k.set_size(parameters_kMinus1.n_elem);
     parameters_k.fill(arma::datum::nan);
 
-    numericVector randomNumber;
-
     double fit_k; // new fit value of differentiable part
     double p_k;   // new penalty value
     double f_k;   // new combined fit
@@ -147,40 +366,62 @@ namespace lessSEM
     // parallels to glmnet
     double pen_d = 0.0;
 
-    double currentStepSize;
-    // a step size of >= 1 would result in no change or in an increasing step
-    // size
-    if (stepSize >= 1)
-    {
-      currentStepSize = .9;
-    }
-    else
-    {
-      currentStepSize = stepSize;
-    }
+    // The right hand side of the line search criterion does not depend on the step size and
+    // is therefore only computed once.
+    // see Equation 20 in Yuan, G.-X., Ho, C.-H., & Lin, C.-J. (2012).
+    // An improved GLMNET for l1-regularized logistic regression.
+    // The Journal of Machine Learning Research, 13, 1999–2030.
+    // https://doi.org/10.1145/2020408.2020421
+    double compareTo = arma::dot(gradients_kMinus1, direction) + // gradients and direction typically show
+                       // in the same direction -> positive
+                       pen_d - pen_0;
+    // gamma is set to zero by Yuan et al. (2012)
+    if (gamma != 0.0)
+      compareTo += gamma * arma::as_scalar(direction * Hessian_kMinus1 * arma::trans(direction)); // always positive
+
+    bool converged = false;
 
-    randomNumber = unif(1, 0.0, 1.0);
-    // randomly resetting the step size can help
-    // if the optimizer is stuck
-    if (randomNumber.at(0) < 0.25)
+    if (lineSearch_ == strongWolfe && compareTo < 0.0)
     {
-      numericVector tmp = unif(1, 0.0, 1.0);
-      currentStepSize = tmp.at(0);
+      converged = strongWolfeLineSearch(model_,
+                                        smoothPenalty_,
+                                        parameters_kMinus1,
+                                        parameterLabels,
+                                        direction,
+                                        f_0,
+                                        compareTo,
+                                        tuningParameters,
+                                        initialTrialStepSize(stepSize_k, stepSize),
+                                        sigma,
+                                        maxIterLine,
+                                        stepSize_k,
+                                        parameters_k);
+      if (!converged)
+        reportDiagnostic(lineSearchNotConverged);
+      return;
     }
 
-    bool converged = false;
+    // compareTo takes the role of the directional derivative in the interpolation;
+    // this requires a descent direction. Otherwise, we fall back to backtracking.
+    const bool interpolate = (lineSearch_ != backtracking) && (compareTo < 0.0);
+
+    double currentStepSize = interpolate ? initialTrialStepSize(stepSize_k, stepSize) : 1.0;
+    double previousStepSize = 0.0;
+    double phi_previous = 0.0;
+    bool hasPrevious = false;
 
     for (int iteration = 0; iteration < maxIterLine; iteration++)
     {
 
       // set step size
-      currentStepSize = std::pow(stepSize, iteration); // starts with 1 and
+      if (!interpolate)
+        currentStepSize = std::pow(stepSize, iteration); // starts with 1 and
       // then decreases with each iteration
 
       parameters_k = parameters_kMinus1 + currentStepSize * direction;
 
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
+      fit_k = LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k,
+                                                                   labels)) +
               smoothPenalty_.getValue(parameters_k,
                                       parameterLabels,
                                       tuningParameters);
@@ -188,6 +429,8 @@ namespace lessSEM
       if (!arma::is_finite(fit_k))
       {
         // skip to next iteration and try a smaller step size
+        currentStepSize *= stepSize;
+        hasPrevious = false;
         continue;
       }
 
@@ -201,280 +444,414 @@ namespace lessSEM
 
       // test line search criterion. g(stepSize) must show a large enough decrease
       // to be accepted
-      // see Equation 20 in Yuan, G.-X., Ho, C.-H., & Lin, C.-J. (2012).
-      // An improved GLMNET for l1-regularized logistic regression.
-      // The Journal of Machine Learning Research, 13, 1999–2030.
-      // https://doi.org/10.1145/2020408.2020421
-
-      arma::mat compareTo =
-          gradients_kMinus1 * arma::trans(direction) + // gradients and direction typically show
-          // in the same direction -> positive
-          gamma * (direction * Hessian_kMinus1 * arma::trans(direction)) + // always positive
-          pen_d - pen_0;
-      // gamma is set to zero by Yuan et al. (2012)
       // if sigma is 0, no decrease is necessary
-
-      converged = f_k - f_0 <= sigma * currentStepSize * compareTo(0, 0);
+      converged = f_k - f_0 <= sigma * currentStepSize * compareTo;
 
       if (converged)
       {
         // check if gradients can be computed at the new location;
         // this can often cause issues
-        gradients_k = model_.gradients(parameters_k,
-                                       parameterLabels);
+        gradients_k = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                       labels));
 
         if (!arma::is_finite(gradients_k))
         {
           // go to next iteration and test smaller step size
+          currentStepSize *= stepSize;
+          hasPrevious = false;
           continue;
         }
         // else
         break;
       }
 
+      if (interpolate)
+      {
+        const double nextStepSize = interpolateStepSize(currentStepSize,
+                                                        f_k - f_0,
+                                                        previousStepSize,
+                                                        phi_previous,
+                                                        hasPrevious,
+                                                        compareTo);
+        previousStepSize = currentStepSize;
+        phi_previous = f_k - f_0;
+        hasPrevious = true;
+        currentStepSize = nextStepSize;
+      }
+
     } // end line search
 
-    if (!converged)
-      warn("Line search did not converge.");
+    stepSize_k = currentStepSize;
 
-    return (parameters_k);
+    if (!converged)
+      reportDiagnostic(lineSearchNotConverged);
   }
 
-  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
-  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
-  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
-  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
-  // second function call can be easier when coming from R.
-
   /**
-   * @brief Optimize a model using the BFGS procedure.
+   * @brief Given a step direction "direction", the line search procedure will find an adequate
+   * step length s in this direction. The new parameter values are then given by
+   * parameters_k = parameters_kMinus1 + s*direction. See above for details on the arguments.
    *
-   * @param model_ the model object derived from the model class in model.h
-   * @param startingValuesRcpp an Rcpp numeric vector with starting values
-   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
-   * @param tuningParameters tuning parameters for the smoothPenalty function
-   * @param control_ settings for the BFGS optimizer. Must be of struct controlBFGS. This can be created with controlBFGS.
-   * @return fit result
+   * @return vector with updated parameters (parameters_k)
    */
   template <typename T> // T is the type of the tuning parameters
-  inline lessSEM::fitResults bfgsOptim(model &model_,
-                                       numericVector startingValuesRcpp,
-                                       smoothPenalty<T> &smoothPenalty_,
-                                       const T &tuningParameters, // tuning parameters are of type T
-                                       const controlBFGS &control_)
+  inline arma::rowvec bfgsLineSearch(
+      model &model_,
+      smoothPenalty<T> &smoothPenalty_,
+      const arma::rowvec &parameters_kMinus1,
+      const stringVector &parameterLabels,
+      const arma::rowvec &direction,
+      const double fit_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const arma::mat &Hessian_kMinus1,
+
+      const T &tuningParameters,
+
+      const double stepSize,
+      const double sigma,
+      const double gamma,
+      const int maxIterLine,
+      const int verbose)
   {
-    if (control_.verbose != 0)
+    arma::rowvec parameters_k;
+    double stepSize_k = 1.0;
+    bfgsLineSearch(model_,
+                   smoothPenalty_,
+                   parameters_kMinus1,
+                   parameterLabels,
+                   direction,
+                   fit_kMinus1,
+                   gradients_kMinus1,
+                   Hessian_kMinus1,
+                   tuningParameters,
+                   stepSize,
+                   sigma,
+                   gamma,
+                   maxIterLine,
+                   verbose,
+                   backtracking,
+                   stepSize_k,
+                   parameters_k);
+    return (parameters_k);
+  }
+
+  /**
+   * @brief BFGS optimizer which owns all memory used in the optimization. When the same
+   * object is used to optimize a model repeatedly (e.g., for many tuning parameters or
+   * different starting values), the memory allocated in the first optimization is reused.
+   */
+  class bfgsOptimizer
+  {
+  public:
+    /**
+     * @brief Construct a new BFGS optimizer
+     *
+     * @param control_ settings for the BFGS optimizer.
+     */
+    bfgsOptimizer(const controlBFGS &control_) : settings(new controlBFGS(control_)) {}
+
+    /**
+     * @brief change the settings of the optimizer. The memory used in the optimization is kept.
+     *
+     * @param control_ settings for the BFGS optimizer.
+     */
+    void setControl(const controlBFGS &control_)
     {
-      print << "Optimizing with bfgs.\n";
+      // the members of controlBFGS are const; the settings are therefore replaced
+      settings.reset(new controlBFGS(control_));
     }
 
-    // separate labels and values
-    arma::rowvec startingValues = toArmaVector(startingValuesRcpp);
-    const stringVector parameterLabels = startingValuesRcpp.names();
-
-    // prepare parameter vectors
-    arma::rowvec parameters_k = startingValues,
-                 parameters_kMinus1 = startingValues;
-    arma::rowvec direction(startingValues.n_elem);
-
-    // prepare fit elements
-    // fit of the smooth part of the fit function
-    double fit_k = model_.fit(parameters_k,
-                              parameterLabels) +
-                   smoothPenalty_.getValue(parameters_k,
-                                           parameterLabels,
-                                           tuningParameters);
-    double fit_kMinus1 = model_.fit(parameters_kMinus1,
-                                    parameterLabels) +
-                         smoothPenalty_.getValue(parameters_kMinus1,
-                                                 parameterLabels,
-                                                 tuningParameters);
-    // add non-differentiable part -> there is none here
-    double penalizedFit_k = fit_k;
-
-    double penalizedFit_kMinus1 = fit_kMinus1;
-
-    // the following vector will save the fits of all iterations:
-    arma::rowvec fits(control_.maxIterOut + 1);
-    fits.fill(NA_REAL);
-    fits(0) = penalizedFit_kMinus1;
-
-    // prepare gradient elements
-    // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
-    // of the model and the smooth penalty function (e.g., ridge)
-    arma::rowvec gradients_k = model_.gradients(parameters_k,
-                                                parameterLabels) +
-                               smoothPenalty_.getGradients(parameters_k,
-                                                           parameterLabels,
-                                                           tuningParameters); // ridge part
-    arma::rowvec gradients_kMinus1 = model_.gradients(parameters_kMinus1,
-                                                      parameterLabels) +
-                                     smoothPenalty_.getGradients(parameters_kMinus1,
-                                                                 parameterLabels,
-                                                                 tuningParameters); // ridge part
-
-    // prepare Hessian elements
-    arma::mat Hessian_k = control_.initialHessian,
-              Hessian_kMinus1 = control_.initialHessian;
-
-    // breaking flags
-    bool breakOuter = false; // if true, the outer iteration is exited
-
-    // outer iteration
-    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    /**
+     * @brief returns the settings of the optimizer
+     *
+     * @return const controlBFGS&
+     */
+    const controlBFGS &getControl() const
     {
+      return (*settings);
+    }
 
-      // check if user wants to stop the computation:
-#if USE_R
-      Rcpp::checkUserInterrupt();
-#endif
+    /**
+     * @brief Optimize a model using the BFGS procedure. See bfgsOptim for details on the arguments.
+     *
+     * @param fitResults_ will be overwritten with the fit results. Passing the same object in each
+     * call avoids allocating memory for the results.
+     */
+    template <typename T> // T is the type of the tuning parameters
+    void optimize(model &model_,
+                  const arma::rowvec &startingValues,
+                  const stringVector &parameterLabels,
+                  smoothPenalty<T> &smoothPenalty_,
+                  const T &tuningParameters, // tuning parameters are of type T
+                  fitResults &fitResults_)
+    {
+      LESSTIMATE_PROFILE_SCOPE("bfgsOptim::optimize");
+      const controlBFGS &control_ = *settings;
 
-      // the gradients will be used by the inner iteration to compute the new
-      // parameters
-      gradients_kMinus1 = model_.gradients(parameters_kMinus1, parameterLabels) +
-                          smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, tuningParameters); // ridge part
-
-      // find step direction -> simple quasi-Newton step
-      direction = -arma::trans(arma::solve(Hessian_kMinus1, arma::trans(gradients_kMinus1)));
-
-      // find length of step in direction
-      parameters_k = bfgsLineSearch(model_,
-                                    smoothPenalty_,
-                                    parameters_kMinus1,
-                                    parameterLabels,
-                                    direction,
-                                    fit_kMinus1,
-                                    gradients_kMinus1,
-                                    Hessian_kMinus1,
-
-                                    tuningParameters,
-
-                                    control_.stepSize,
-                                    control_.sigma,
-                                    control_.gamma,
-                                    control_.maxIterLine,
-                                    control_.verbose);
-
-      // get gradients of differentiable part
-      gradients_k = model_.gradients(parameters_k,
-                                     parameterLabels) +
-                    smoothPenalty_.getGradients(parameters_k,
-                                                parameterLabels,
-                                                tuningParameters);
-      // fit of the smooth part of the fit function
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
-              smoothPenalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
-      // add non-differentiable part -> there is none here
-      penalizedFit_k = fit_k;
+      // problems are counted and summarized once at the end of the fit (see diagnostics.h)
+      diagnostics diagnostics_(control_.verbose != 0);
+      diagnosticsScope diagnosticsScope_(&diagnostics_);
 
-      fits(outer_iteration + 1) = penalizedFit_k;
+      if (control_.verbose != 0)
+      {
+        print << "Optimizing with bfgs.\n";
+      }
+
+      // the models only receive a handle to the labels; this avoids copying them
+      const labelHandle labels(parameterLabels);
 
-      // print fit info
-      if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
+      // prepare parameter vectors
+      parameters_k = startingValues;
+      parameters_kMinus1 = startingValues;
+      direction.zeros(startingValues.n_elem);
+
+      // prepare fit elements
+      // fit of the smooth part of the fit function
+      double fit_kMinus1 = LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_kMinus1,
+                                                                                labels)) +
+                           smoothPenalty_.getValue(parameters_kMinus1,
+                                                   parameterLabels,
+                                                   tuningParameters);
+      double fit_k = fit_kMinus1;
+      // add non-differentiable part -> there is none here
+      double penalizedFit_k = fit_k;
+
+      double penalizedFit_kMinus1 = fit_kMinus1;
+
+      // the following vector will save the fits of all iterations:
+      fits.set_size(control_.maxIterOut + 1);
+      fits.fill(NA_REAL);
+      fits(0) = penalizedFit_kMinus1;
+
+      // prepare gradient elements
+      // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
+      // of the model and the smooth penalty function (e.g., ridge)
+      gradients_kMinus1 = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_kMinus1,
+                                                                                           labels)) +
+                          smoothPenalty_.getGradients(parameters_kMinus1,
+                                                      parameterLabels,
+                                                      tuningParameters); // ridge part
+      gradients_k = gradients_kMinus1;
+
+      // prepare Hessian elements
+      const bool scaleHessian = (control_.initialHessian.n_elem == 1) &&
+                                (control_.hessianScaling != noHessianScaling);
+      if ((control_.initialHessian.n_cols == 1) && (control_.initialHessian.n_rows == 1))
       {
-        print << "Fit in iteration outer_iteration "
-              << outer_iteration + 1
-              << ": "
-              << penalizedFit_k
-              << "\n"
-              << parameters_k
-              << std::endl;
+        // Hessian has to be redefined
+        Hessian_kMinus1.zeros(startingValues.n_elem, startingValues.n_elem);
+        Hessian_kMinus1.diag().fill(control_.initialHessian(0, 0));
       }
+      else
+      {
+        Hessian_kMinus1 = control_.initialHessian;
+      }
+      Hessian_k = Hessian_kMinus1;
+
+      // the kkt_ criterion is relative to the gradients at the starting values
+      const double kktTolerance = control_.breakKKTAbsolute +
+                                  control_.breakKKTRelative * arma::abs(gradients_kMinus1).max();
+
+      // step size accepted in the previous outer iteration
+      double stepSize_k = 1.0;
 
-      // Approximate Hessian using BFGS
-      Hessian_k = lessSEM::BFGS(
-          parameters_kMinus1,
-          gradients_kMinus1,
-          Hessian_kMinus1,
-          parameters_k,
-          gradients_k,
-          true,
-          .001,
-          control_.verbose == -99);
-
-      // check convergence
-      if (control_.convergenceCriterion == GLMNET_)
+      // breaking flags
+      bool breakOuter = false; // if true, the outer iteration is exited
+
+      // outer iteration
+      for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
       {
-        arma::mat HessDiag = arma::eye(Hessian_k.n_rows,
-                                       Hessian_k.n_cols);
-        HessDiag.fill(0.0);
-        HessDiag.diag() = Hessian_k.diag();
-        try
+        LESSTIMATE_PROFILE_SCOPE("bfgsOptim::outerIteration");
+
+        // check if user wants to stop the computation:
+#if USE_R
+        Rcpp::checkUserInterrupt();
+#endif
+
+        // find step direction -> simple quasi-Newton step
+        direction = -arma::trans(arma::solve(Hessian_kMinus1, arma::trans(gradients_kMinus1)));
+
+        // find length of step in direction
+        bfgsLineSearch(model_,
+                       smoothPenalty_,
+                       parameters_kMinus1,
+                       parameterLabels,
+                       direction,
+                       fit_kMinus1,
+                       gradients_kMinus1,
+                       Hessian_kMinus1,
+
+                       tuningParameters,
+
+                       control_.stepSize,
+                       control_.sigma,
+                       control_.gamma,
+                       control_.maxIterLine,
+                       control_.verbose,
+                       control_.lineSearch,
+                       stepSize_k,
+                       parameters_k);
+
+        // get gradients of differentiable part
+        gradients_k = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                       labels)) +
+                      smoothPenalty_.getGradients(parameters_k,
+                                                  parameterLabels,
+                                                  tuningParameters);
+        // fit of the smooth part of the fit function
+        fit_k = LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k,
+                                                                     labels)) +
+                smoothPenalty_.getValue(parameters_k,
+                                        parameterLabels,
+                                        tuningParameters);
+        // add non-differentiable part -> there is none here
+        penalizedFit_k = fit_k;
+
+        fits(outer_iteration + 1) = penalizedFit_k;
+
+        // print fit info
+        if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
         {
-          breakOuter = max(HessDiag * arma::pow(arma::trans(direction), 2)) < control_.breakOuter;
+          print << "Fit in iteration outer_iteration "
+                << outer_iteration + 1
+                << ": "
+                << penalizedFit_k
+                << "\n"
+                << parameters_k
+                << std::endl;
         }
-        catch (...)
+
+        // The initial Hessian is typically badly scaled; after the first
+        // step, the curvature information in the gradients is used to rescale it.
+        if (scaleHessian && (outer_iteration == 0))
+          scaleInitialHessian(control_.hessianScaling,
+                              parameters_kMinus1,
+                              gradients_kMinus1,
+                              parameters_k,
+                              gradients_k,
+                              Hessian_kMinus1);
+
+        // Approximate Hessian using BFGS
+        updateBFGS(
+            parameters_kMinus1,
+            gradients_kMinus1,
+            Hessian_kMinus1,
+            parameters_k,
+            gradients_k,
+            true,
+            .001,
+            control_.verbose == -99,
+            Hessian_k,
+            HessianTimesD);
+
+        // check convergence
+        if (control_.convergenceCriterion == GLMNET_)
         {
-          error("Error while computing convergence criterion");
+          breakOuter = maxDiagonalDecrease(Hessian_k, direction) < control_.breakOuter;
         }
-      }
-      if (control_.convergenceCriterion == fitChange_)
-      {
-        try
+        if (control_.convergenceCriterion == fitChange_)
         {
-          breakOuter = std::abs(fits(outer_iteration + 1) -
-                                fits(outer_iteration)) <
-                       control_.breakOuter;
+          try
+          {
+            breakOuter = std::abs(fits(outer_iteration + 1) -
+                                  fits(outer_iteration)) <
+                         control_.breakOuter;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-        catch (...)
+        if (control_.convergenceCriterion == gradients_)
         {
-          error("Error while computing convergence criterion");
+          try
+          {
+            // check if all gradients are below the convergence criterion:
+            breakOuter = arma::sum(arma::abs(gradients_k) < control_.breakOuter) ==
+                         gradients_k.n_elem;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-      }
-      if (control_.convergenceCriterion == gradients_)
-      {
-        try
+        if (control_.convergenceCriterion == convergenceCriteriaBFGS::kkt_)
         {
-          arma::rowvec subGradients = gradients_k;
-
-          // check if all gradients are below the convergence criterion:
-          breakOuter = arma::sum(arma::abs(subGradients) < control_.breakOuter) ==
-                       subGradients.n_elem;
+          breakOuter = arma::abs(gradients_k).max() <= kktTolerance;
         }
-        catch (...)
+
+        if (breakOuter)
         {
-          error("Error while computing convergence criterion");
+          break;
         }
-      }
 
-      if (breakOuter)
+        // for next iteration: save current values as previous values.
+        // The assignments copy into the existing memory.
+        fit_kMinus1 = fit_k;
+        penalizedFit_kMinus1 = penalizedFit_k;
+        parameters_kMinus1 = parameters_k;
+        gradients_kMinus1 = gradients_k;
+        Hessian_kMinus1 = Hessian_k;
+
+      } // end outer iteration
+
+      if (!breakOuter)
       {
-        break;
+        reportDiagnostic(outerIterationsNotConverged);
       }
 
-      // for next iteration: save current values as previous values
-      fit_kMinus1 = fit_k;
-      penalizedFit_kMinus1 = penalizedFit_k;
-      parameters_kMinus1 = parameters_k;
-      gradients_kMinus1 = gradients_k;
-      Hessian_kMinus1 = Hessian_k;
+      fitResults_.convergence = breakOuter;
+      fitResults_.fit = penalizedFit_k;
+      fitResults_.fits = fits;
+      fitResults_.parameterValues = parameters_k;
+      fitResults_.Hessian = Hessian_k;
+      fitResults_.dualityGap = arma::datum::nan;
+      fitResults_.warningCounts = diagnostics_.getCounts();
+      diagnostics_.summarize();
 
-    } // end outer iteration
+    }
 
-    if (!breakOuter)
+    /**
+     * @brief Optimize a model using the BFGS procedure. See bfgsOptim for details on the arguments.
+     *
+     * @return fit result
+     */
+    template <typename T> // T is the type of the tuning parameters
+    fitResults optimize(model &model_,
+                        const arma::rowvec &startingValues,
+                        const stringVector &parameterLabels,
+                        smoothPenalty<T> &smoothPenalty_,
+                        const T &tuningParameters)
     {
-      warn("Outer iterations did not converge");
+      fitResults fitResults_;
+      optimize(model_,
+               startingValues,
+               parameterLabels,
+               smoothPenalty_,
+               tuningParameters,
+               fitResults_);
+      return (fitResults_);
     }
 
-    fitResults fitResults_;
-
-    fitResults_.convergence = breakOuter;
-    fitResults_.fit = penalizedFit_k;
-    fitResults_.fits = fits;
-    fitResults_.parameterValues = parameters_k;
-    fitResults_.Hessian = Hessian_k;
-
-    return (fitResults_);
+  private:
+    std::unique_ptr<const controlBFGS> settings;
+    arma::rowvec parameters_k, parameters_kMinus1;
+    arma::rowvec direction;
+    arma::rowvec gradients_k, gradients_kMinus1;
+    arma::mat Hessian_k, Hessian_kMinus1;
+    arma::colvec HessianTimesD;
+    arma::rowvec fits;
+  };
 
-  } // end bfgs
+  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
+  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
+  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
+  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
+  // second function call can be easier when coming from R.
 
   /**
    * @brief Optimize a model using the BFGS procedure.
    *
-   * @tparam T type of the tuning parameters
    * @param model_ the model object derived from the model class in model.h
    * @param startingValues an arma::rowvec numeric vector with starting values
    * @param parameterLabels a lessSEM::stringVector with labels for parameters
@@ -485,19 +862,43 @@ namespace lessSEM
    */
   template <typename T> // T is the type of the tuning parameters
   inline lessSEM::fitResults bfgsOptim(model &model_,
-                                       arma::rowvec startingValues,
-                                       stringVector parameterLabels,
+                                       const arma::rowvec &startingValues,
+                                       const stringVector &parameterLabels,
                                        smoothPenalty<T> &smoothPenalty_,
                                        const T &tuningParameters, // tuning parameters are of type T
                                        const controlBFGS &control_)
   {
+    bfgsOptimizer optimizer(control_);
+    return (optimizer.optimize(model_,
+                               startingValues,
+                               parameterLabels,
+                               smoothPenalty_,
+                               tuningParameters));
+  } // end bfgs
 
-    numericVector startingValuesNumVec = toNumericVector(startingValues);
-    startingValuesNumVec.names() = parameterLabels;
+  /**
+   * @brief Optimize a model using the BFGS procedure.
+   *
+   * @tparam T type of the tuning parameters
+   * @param model_ the model object derived from the model class in model.h
+   * @param startingValuesRcpp numericVector with starting values. The names are used as parameter labels
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningParameters tuning parameters for the smoothPenalty function
+   * @param control_ settings for the BFGS optimizer. Must be of struct controlBFGS. This can be created with controlBFGS.
+   * @return fit result
+   */
+  template <typename T> // T is the type of the tuning parameters
+  inline lessSEM::fitResults bfgsOptim(model &model_,
+                                       numericVector startingValuesRcpp,
+                                       smoothPenalty<T> &smoothPenalty_,
+                                       const T &tuningParameters, // tuning parameters are of type T
+                                       const controlBFGS &control_)
+  {
 
     return (
         bfgsOptim(model_,
-                  startingValuesNumVec,
+                  toArmaVectorView(startingValuesRcpp),
+                  startingValuesRcpp.names(),
                   smoothPenalty_,
                   tuningParameters, // tuning parameters are of type T
                   control_));
@@ -0,0 +1,304 @@
+#ifndef CACHED_MODEL_H
+#define CACHED_MODEL_H
+// the standard headers are included before common_headers.h because the latter defines error as a macro
+#include <cstdint>
+#include <cstring>
+
+#include "common_headers.h"
+
+#include "model.h"
+
+// The optimizers sometimes evaluate the model repeatedly at the same parameter
+// values (e.g., when the fit is needed by the convergence criterion and by the
+// line search). cachedModel wraps any model and remembers the last few fit values
+// and gradients. A value is only returned from the cache if the parameter values
+// are bit-wise identical to those of the cached evaluation; the results are therefore
+// exactly the same as without cache.
+//
+// Example:
+//
+// myModel model_(...);
+// lessSEM::cachedModel cached(model_);
+// lessSEM::fitResults fitResults_ = lessSEM::fitGlmnet(cached, startingValues, ...);
+// cached.printStatistics();
+//
+// Note: The cache assumes that fit and gradients only depend on the parameter values. If
+// the model changes otherwise (e.g., new data), call clear().
+
+namespace lessSEM
+{
+
+  /**
+   * @struct cacheStatistics
+   * @brief number of calls to the cached model
+   *
+   * @var fitCalls number of calls to fit
+   * @var fitHits number of calls to fit answered from the cache
+   * @var gradientCalls number of calls to gradients
+   * @var gradientHits number of calls to gradients answered from the cache
+   */
+  struct cacheStatistics
+  {
+    unsigned long fitCalls;
+    unsigned long fitHits;
+    unsigned long gradientCalls;
+    unsigned long gradientHits;
+  };
+
+  /**
+   * @brief remembers the results of the last evaluations at different parameter values. The oldest
+   * entry is replaced when the cache is full.
+   */
+  template <typename T>
+  class evaluationCache
+  {
+  public:
+    /**
+     * @brief Construct a new evaluation cache
+     *
+     * @param size_ maximal number of entries
+     */
+    explicit evaluationCache(const unsigned int size_) : entries(std::max(size_, 1u)) {}
+
+    /**
+     * @brief searches the cache
+     *
+     * @param parameterValues parameter values
+     * @return const T* cached value; nullptr if the parameter values are not in the cache
+     */
+    const T *find(const arma::rowvec &parameterValues) const
+    {
+      const std::uint64_t hash_ = hash(parameterValues);
+      // the newest entries are checked first
+      for (unsigned int i = 0; i < used; i++)
+      {
+        const entry &entry_ = entries.at((next + entries.size() - 1 - i) % entries.size());
+        if ((entry_.hash == hash_) &&
+            (entry_.parameterValues.n_elem == parameterValues.n_elem) &&
+            (std::memcmp(entry_.parameterValues.memptr(),
+                         parameterValues.memptr(),
+                         parameterValues.n_elem * sizeof(double)) == 0))
+          return (&entry_.value);
+      }
+      return (nullptr);
+    }
+
+    /**
+     * @brief adds a value to the cache
+     *
+     * @param parameterValues parameter values
+     * @param value value at the parameter values
+     */
+    void insert(const arma::rowvec &parameterValues,
+                const T &value)
+    {
+      entry &entry_ = entries.at(next);
+      entry_.hash = hash(parameterValues);
+      // the assignments reuse the memory of the replaced entry
+      entry_.parameterValues = parameterValues;
+      entry_.value = value;
+      next = (next + 1) % entries.size();
+      used = std::min(used + 1, (unsigned int)entries.size());
+    }
+
+    /**
+     * @brief removes all entries
+     */
+    void clear()
+    {
+      used = 0;
+      next = 0;
+    }
+
+  private:
+    struct entry
+    {
+      std::uint64_t hash;
+      arma::rowvec parameterValues;
+      T value;
+    };
+
+    std::vector<entry> entries;
+    unsigned int used = 0;
+    unsigned int next = 0;
+
+    // FNV-1a hash of the bits of the parameter values
+    static std::uint64_t hash(const arma::rowvec &parameterValues)
+    {
+      std::uint64_t hash_ = 14695981039346656037ULL;
+      const unsigned char *bytes = reinterpret_cast<const unsigned char *>(parameterValues.memptr());
+      for (std::size_t i = 0; i < parameterValues.n_elem * sizeof(double); i++)
+      {
+        hash_ ^= bytes[i];
+        hash_ *= 1099511628211ULL;
+      }
+      return (hash_);
+    }
+  };
+
+  /**
+   * @brief wraps a model and caches the last fit values and gradients. All other methods are
+   * passed on to the wrapped model.
+   */
+  class cachedModel : public model
+  {
+  public:
+    /**
+     * @brief Construct a new cached model
+     *
+     * @param model_ the model object derived from the model class in model.h. Must outlive the cached model.
+     * @param cacheSize_ number of fit values and gradients which are remembered
+     */
+    cachedModel(model &model_,
+                const unsigned int cacheSize_ = 4) : baseModel(model_),
+                                                     cacheSize(cacheSize_),
+                                                     fitCache(cacheSize_),
+                                                     gradientCache(cacheSize_)
+    {
+      resetStatistics();
+    }
+
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      statistics.fitCalls++;
+      const double *cached = fitCache.find(parameterValues);
+      if (cached != nullptr)
+      {
+        statistics.fitHits++;
+        return (*cached);
+      }
+      const double fit_ = baseModel.fitFast(parameterValues, parameterLabels);
+      fitCache.insert(parameterValues, fit_);
+      return (fit_);
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      statistics.gradientCalls++;
+      const arma::rowvec *cached = gradientCache.find(parameterValues);
+      if (cached != nullptr)
+      {
+        statistics.gradientHits++;
+        return (*cached);
+      }
+      arma::rowvec gradients_ = baseModel.gradientsFast(parameterValues, parameterLabels);
+      gradientCache.insert(parameterValues, gradients_);
+      return (gradients_);
+    }
+
+    unsigned int numberOfObservations() override
+    {
+      return (baseModel.numberOfObservations());
+    }
+
+    arma::rowvec minibatchGradients(const arma::rowvec &parameterValues,
+                                    const labelHandle parameterLabels,
+                                    const unsigned int firstObservation,
+                                    const unsigned int lastObservation) override
+    {
+      return (baseModel.minibatchGradients(parameterValues,
+                                           parameterLabels,
+                                           firstObservation,
+                                           lastObservation));
+    }
+
+    double dualFit(const arma::rowvec &parameterValues,
+                   const double scale) override
+    {
+      return (baseModel.dualFit(parameterValues, scale));
+    }
+
+    /**
+     * @brief the copy wraps a copy of the wrapped model and has its own cache
+     *
+     * @return std::unique_ptr<model> nullptr if the wrapped model can not be copied
+     */
+    std::unique_ptr<model> clone() const override
+    {
+      std::unique_ptr<model> baseCopy = baseModel.clone();
+      if (!baseCopy)
+        return (nullptr);
+      return (std::unique_ptr<model>(new cachedModel(std::move(baseCopy), cacheSize)));
+    }
+
+    /**
+     * @brief removes all cached values. Must be called if the wrapped model changes.
+     */
+    void clear()
+    {
+      fitCache.clear();
+      gradientCache.clear();
+    }
+
+    /**
+     * @brief returns the number of calls and cache hits
+     *
+     * @return cacheStatistics
+     */
+    cacheStatistics getStatistics() const
+    {
+      return (statistics);
+    }
+
+    /**
+     * @brief sets the number of calls and cache hits to zero
+     */
+    void resetStatistics()
+    {
+      statistics = {0, 0, 0, 0};
+    }
+
+    /**
+     * @brief prints the hit rates of the cache
+     */
+    void printStatistics() const
+    {
+      print << "Cache hits: fit "
+            << statistics.fitHits << " of " << statistics.fitCalls
+            << " (" << hitRate(statistics.fitHits, statistics.fitCalls) << "%), gradients "
+            << statistics.gradientHits << " of " << statistics.gradientCalls
+            << " (" << hitRate(statistics.gradientHits, statistics.gradientCalls) << "%)\n";
+    }
+
+  private:
+    // only used by clone(): the cached model owns the copy of the wrapped model
+    std::unique_ptr<model> ownedModel;
+    model &baseModel;
+    const unsigned int cacheSize;
+    evaluationCache<double> fitCache;
+    evaluationCache<arma::rowvec> gradientCache;
+    cacheStatistics statistics;
+
+    cachedModel(std::unique_ptr<model> model_,
+                const unsigned int cacheSize_) : ownedModel(std::move(model_)),
+                                                 baseModel(*ownedModel),
+                                                 cacheSize(cacheSize_),
+                                                 fitCache(cacheSize_),
+                                                 gradientCache(cacheSize_)
+    {
+      resetStatistics();
+    }
+
+    static double hitRate(const unsigned long hits,
+                          const unsigned long calls)
+    {
+      return ((calls == 0) ? 0.0 : (100.0 * hits) / calls);
+    }
+  };
+
+}
+#endif
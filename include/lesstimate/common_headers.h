@@ -40,12 +40,20 @@ namespace lessSEM
    */
   inline arma::rowvec toArmaVector(numericVector numVec)
   {
-    arma::rowvec armaVec(numVec.length());
-    for (unsigned int i = 0; i < numVec.length(); i++)
-    {
-      armaVec(i) = numVec(i);
-    }
-    return (armaVec);
+    return (arma::rowvec(numVec.begin(), numVec.length()));
+  }
+
+  /**
+   * @brief create an arma::rowvec which uses the memory of a Rcpp::NumericVector
+   * without copying the elements. The numericVector must outlive the returned vector;
+   * changes to the rowvec are changes to the numericVector.
+   *
+   * @param numVec vector of class Rcpp::NumericVector
+   * @return arma::rowvec
+   */
+  inline arma::rowvec toArmaVectorView(numericVector &numVec)
+  {
+    return (arma::rowvec(numVec.begin(), numVec.length(), false, true));
   }
 
   /**
@@ -54,14 +62,9 @@ namespace lessSEM
    * @param vec vector of class arma::rowvec
    * @return numericVector
    */
-  inline numericVector toNumericVector(arma::rowvec vec)
+  inline numericVector toNumericVector(const arma::rowvec &vec)
   {
-    numericVector numVec(vec.n_elem);
-    for (unsigned int i = 0; i < numVec.length(); i++)
-    {
-      numVec(i) = vec(i);
-    }
-    return (numVec);
+    return (numericVector(vec.begin(), vec.end()));
   }
 
   /**
@@ -170,7 +173,7 @@ namespace lessSEM
      *
      * @param values_ provide the strings to be stored in the stringVector
      */
-    stringVector(std::vector<std::string> values_) : values(values_) {}
+    stringVector(std::vector<std::string> values_) : values(std::move(values_)) {}
 
     /**
      * @brief return the element at a specific location of the string
@@ -244,9 +247,7 @@ namespace lessSEM
    */
   inline stringVector toStringVector(std::vector<std::string> vec)
   {
-    stringVector myStringVec;
-    myStringVec.values = vec;
-    return (myStringVec);
+    return (stringVector(std::move(vec)));
   }
 
   /**
@@ -295,12 +296,9 @@ namespace lessSEM
      *
      * @param vec arma::rowvec with values to be stored in numericVector
      */
-    numericVector(arma::rowvec vec)
+    numericVector(arma::rowvec vec) : values(std::move(vec))
     {
-      values = vec;
       par_names.values.resize(values.n_elem);
-      for (int i = 0; i < values.n_elem; i++)
-        par_names.values.at(i) = "";
     }
 
     /**
@@ -309,10 +307,9 @@ namespace lessSEM
      * @param vec arma::rowvec with values to be stored in numericVector
      * @param labels std::vector<std::string> with names of the elements in numericVector
      */
-    numericVector(arma::rowvec vec, std::vector<std::string> labels)
+    numericVector(arma::rowvec vec, std::vector<std::string> labels) : values(std::move(vec)),
+                                                                       par_names(std::move(labels))
     {
-      values = vec;
-      par_names.values = labels;
     }
 
     /**
@@ -390,7 +387,20 @@ namespace lessSEM
    */
   inline arma::rowvec toArmaVector(numericVector numVec)
   {
-    return (numVec.values);
+    return (std::move(numVec.values));
+  }
+
+  /**
+   * @brief create an arma::rowvec which uses the memory of a numericVector
+   * without copying the elements. The numericVector must outlive the returned vector;
+   * changes to the rowvec are changes to the numericVector.
+   *
+   * @param numVec numericVector
+   * @return arma::rowvec
+   */
+  inline arma::rowvec toArmaVectorView(numericVector &numVec)
+  {
+    return (arma::rowvec(numVec.values.memptr(), numVec.values.n_elem, false, true));
   }
 
   /**
@@ -401,7 +411,7 @@ namespace lessSEM
    */
   inline numericVector toNumericVector(arma::rowvec vec)
   {
-    return (numericVector(vec));
+    return (numericVector(std::move(vec)));
   }
 
   /**
@@ -439,7 +449,9 @@ namespace lessSEM
    */
   inline numericVector unif(int n, double min, double max)
   {
-    std::default_random_engine generator;
+    // the generator must persist between calls; otherwise we would return
+    // the same "random" numbers on every call
+    thread_local std::default_random_engine generator(std::random_device{}());
     std::uniform_real_distribution<double> unif_dist(min, max);
     arma::vec tst(n);
     numericVector ret(n);
@@ -450,3 +462,129 @@ namespace lessSEM
 }
 
 #endif
+
+// ----------------------
+// RANDOM NUMBERS
+// The optimizers use their own random number generator which is seeded with the
+// seed passed in the control arguments. This makes results reproducible and
+// allows for running multiple optimizers concurrently.
+// ----------------------
+#include <cstdint>
+
+namespace lessSEM
+{
+  /**
+   * @brief Small and fast random number generator (xoshiro256**, see
+   * Blackman, D., & Vigna, S. (2021). Scrambled Linear Pseudorandom Number Generators.
+   * ACM Transactions on Mathematical Software, 47(4), 1–32. https://doi.org/10.1145/3460772).
+   * Each optimizer owns one of these generators; there is no global state.
+   */
+  class randomNumberGenerator
+  {
+  public:
+    /**
+     * @brief Construct a new random number generator
+     *
+     * @param seed seed of the generator
+     * @param stream allows for creating multiple independent generators with the same seed (e.g., one for
+     * each of multiple concurrent fits)
+     */
+    randomNumberGenerator(const std::uint64_t seed = 0, const std::uint64_t stream = 0)
+    {
+      setSeed(seed, stream);
+    }
+
+    /**
+     * @brief reset the state of the generator
+     *
+     * @param seed seed of the generator
+     * @param stream number of the stream
+     */
+    void setSeed(const std::uint64_t seed, const std::uint64_t stream = 0)
+    {
+      // the state is initialized with splitmix64 as recommended by Blackman & Vigna (2021)
+      std::uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+      for (int i = 0; i < 4; i++)
+      {
+        x += 0x9E3779B97F4A7C15ULL;
+        std::uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        state[i] = z ^ (z >> 31);
+      }
+    }
+
+    /**
+     * @brief returns the next 64 bit random number
+     *
+     * @return std::uint64_t
+     */
+    std::uint64_t next()
+    {
+      const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+      const std::uint64_t t = state[1] << 17;
+      state[2] ^= state[0];
+      state[3] ^= state[1];
+      state[1] ^= state[2];
+      state[0] ^= state[3];
+      state[2] ^= t;
+      state[3] = rotl(state[3], 45);
+      return (result);
+    }
+
+    /**
+     * @brief draw from a uniform distribution in [0,1)
+     *
+     * @return double
+     */
+    double uniform()
+    {
+      return ((next() >> 11) * (1.0 / 9007199254740992.0)); // 2^-53
+    }
+
+    /**
+     * @brief draw from a uniform distribution in [min,max)
+     *
+     * @param min minimum value of the uniform distribution
+     * @param max maximum value of the uniform distribution
+     * @return double
+     */
+    double uniform(const double min, const double max)
+    {
+      return (min + (max - min) * uniform());
+    }
+
+    /**
+     * @brief draw a random index in 0, ..., n-1
+     *
+     * @param n number of elements
+     * @return unsigned int
+     */
+    unsigned int index(const unsigned int n)
+    {
+      return ((unsigned int)(next() % n));
+    }
+
+    /**
+     * @brief shuffle the elements of a vector in place (Fisher-Yates)
+     *
+     * @param elements vector to shuffle
+     */
+    template <typename T>
+    void shuffle(std::vector<T> &elements)
+    {
+      for (std::size_t i = elements.size(); i > 1; i--)
+      {
+        std::swap(elements[i - 1], elements[index((unsigned int)i)]);
+      }
+    }
+
+  private:
+    std::uint64_t state[4];
+
+    static std::uint64_t rotl(const std::uint64_t x, const int k)
+    {
+      return ((x << k) | (x >> (64 - k)));
+    }
+  };
+}
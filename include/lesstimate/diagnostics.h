@@ -0,0 +1,189 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+// the standard headers are included before common_headers.h because the latter defines error as a macro
+#include <atomic>
+#include <sstream>
+
+#include "common_headers.h"
+
+// Some problems can occur in every iteration of an optimizer or even for every
+// parameter in every iteration (e.g., a subproblem of the mcp penalty in glmnet
+// which is not positive definite). Writing a warning each time is expensive and
+// floods the output. Instead, the optimizers install a diagnostics collector for
+// the duration of the fit. The problems are counted and a single summary is emitted
+// at the end of the fit. The counts are returned in fitResults::warningCounts.
+//
+// Without an active collector (e.g., when the penalties are used outside of the
+// optimizers), reportDiagnostic falls back to warn().
+
+namespace lessSEM
+{
+
+  /**
+   * Problems which can occur while fitting a model. Used as index of fitResults::warningCounts.
+   */
+  enum diagnosticCode
+  {
+    mcpNotPositiveDefinite,             /** A subproblem of the mcp penalty in glmnet is not positive definite.*/
+    hessianUpdateNotPositiveDefinite,   /** The BFGS update may result in a non-positive definite Hessian.*/
+    hessianUpdateSkipped,               /** The BFGS update was skipped because of non-finite values.*/
+    hessianNotFinite,                   /** The BFGS update resulted in a non-finite Hessian.*/
+    hessianNotSymmetric,                /** The BFGS update resulted in a non-symmetric Hessian.*/
+    hessianNotPositiveDefinite,         /** The BFGS update resulted in a non-positive definite Hessian.*/
+    hessianInvalid,                     /** The Hessian could not be made positive definite.*/
+    innerIterationsFailed,              /** The inner iterations of ista did not improve the fit.*/
+    lineSearchNotConverged,             /** The line search did not converge.*/
+    outerIterationsNotConverged,        /** The outer iterations did not converge.*/
+    numberOfDiagnosticCodes
+  };
+  const std::vector<std::string> diagnosticCode_txt = {
+      "One of the subproblems is not positive definite. Using a small hack... This may work or may fail. We recommend using method = 'ista' for mcp.",
+      "Hessian update possibly non-positive definite.",
+      "Hessian update skipped.",
+      "Non-finite Hessian. Returning previous Hessian",
+      "Hessian not symmetric",
+      "Hessian not pd",
+      "Invalid Hessian. Returning previous Hessian",
+      "Inner iterations did not improve the fit --> resetting L.",
+      "Line search did not converge.",
+      "Outer iterations did not converge"};
+
+  /**
+   * @brief the problems with the Hessian approximation are common and typically harmless. They are only
+   * included in the summary if the optimizer is verbose.
+   *
+   * @param code diagnostic code
+   * @return true if the problem is only reported by verbose optimizers
+   */
+  inline bool diagnosticOnlyVerbose(const diagnosticCode code)
+  {
+    return ((code >= hessianUpdateNotPositiveDefinite) && (code <= hessianInvalid));
+  }
+
+  /**
+   * @brief counts the problems which occur during a single fit. Problems can be reported from
+   * multiple threads at the same time.
+   */
+  class diagnostics
+  {
+  public:
+    /**
+     * @brief Construct a new diagnostics collector
+     *
+     * @param verbose_ if true, the problems with the Hessian approximation are included in the summary
+     */
+    explicit diagnostics(const bool verbose_ = false) : verbose(verbose_)
+    {
+      for (std::atomic<unsigned int> &count : counts)
+        count.store(0);
+    }
+
+    diagnostics(const diagnostics &) = delete;
+    diagnostics &operator=(const diagnostics &) = delete;
+
+    /**
+     * @brief counts an occurrence of a problem
+     *
+     * @param code diagnostic code
+     */
+    void record(const diagnosticCode code)
+    {
+      counts[code].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief returns the number of occurrences of each problem
+     *
+     * @return std::vector<unsigned int> with one element per diagnosticCode
+     */
+    std::vector<unsigned int> getCounts() const
+    {
+      std::vector<unsigned int> counts_(numberOfDiagnosticCodes);
+      for (unsigned int i = 0; i < numberOfDiagnosticCodes; i++)
+        counts_.at(i) = counts[i].load(std::memory_order_relaxed);
+      return (counts_);
+    }
+
+    /**
+     * @brief emits a single warning summarizing all problems
+     */
+    void summarize() const
+    {
+      std::ostringstream summary;
+      for (unsigned int i = 0; i < numberOfDiagnosticCodes; i++)
+      {
+        const unsigned int count = counts[i].load(std::memory_order_relaxed);
+        if ((count == 0) || (diagnosticOnlyVerbose((diagnosticCode)i) && !verbose))
+          continue;
+        summary << diagnosticCode_txt.at(i);
+        if (count > 1)
+          summary << " (" << count << " times)";
+        summary << "\n";
+      }
+      if (summary.tellp() > 0)
+        warn(summary.str());
+    }
+
+    /**
+     * @brief returns the collector of the fit the calling thread is working on
+     *
+     * @return diagnostics* nullptr if there is no active collector
+     */
+    static diagnostics *&active()
+    {
+      thread_local diagnostics *active_ = nullptr;
+      return (active_);
+    }
+
+  private:
+    const bool verbose;
+    std::atomic<unsigned int> counts[numberOfDiagnosticCodes];
+  };
+
+  /**
+   * @brief makes a diagnostics collector the active collector of the calling thread until the scope is left.
+   * Threads working on behalf of an optimizer (e.g., in glmnetInner) use this to report to the collector of the fit.
+   */
+  class diagnosticsScope
+  {
+  public:
+    /**
+     * @brief Construct a new diagnostics scope
+     *
+     * @param diagnostics_ collector; may be a nullptr
+     */
+    explicit diagnosticsScope(diagnostics *diagnostics_) : previous(diagnostics::active())
+    {
+      diagnostics::active() = diagnostics_;
+    }
+
+    diagnosticsScope(const diagnosticsScope &) = delete;
+    diagnosticsScope &operator=(const diagnosticsScope &) = delete;
+
+    ~diagnosticsScope()
+    {
+      diagnostics::active() = previous;
+    }
+
+  private:
+    diagnostics *previous;
+  };
+
+  /**
+   * @brief reports a problem to the active collector. Without active collector, a warning is emitted.
+   *
+   * @param code diagnostic code
+   * @param warnWithoutCollector if false, nothing is emitted without active collector
+   */
+  inline void reportDiagnostic(const diagnosticCode code,
+                               const bool warnWithoutCollector = true)
+  {
+    diagnostics *active = diagnostics::active();
+    if (active != nullptr)
+      active->record(code);
+    else if (warnWithoutCollector)
+      warn(diagnosticCode_txt.at(code));
+  }
+
+}
+#endif
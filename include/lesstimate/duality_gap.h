@@ -0,0 +1,246 @@
+#ifndef DUALITY_GAP_H
+#define DUALITY_GAP_H
+#include "common_headers.h"
+
+#include "model.h"
+#include "penalty.h"
+#include "smoothPenalty.h"
+#include "enet.h"
+#include "glmnet_lasso.h"
+#include "glmnet_ridge.h"
+#include "glmnet_mixedPenalty.h"
+#include "ista_lasso.h"
+#include "ista_ridge.h"
+#include "ista_mixedPenalty.h"
+
+// The duality gap provides a certified bound on the distance of the current fit to
+// the optimal fit: primal(b) - optimum <= primal(b) - dual(u) for any dual feasible u.
+// For models with fit function F(Xb) and lasso / elastic net penalties
+// sum_j l1_j |b_j| + l2_j/2 b_j^2, a dual feasible point is obtained by scaling the
+// negative gradient of F at the linear predictor. See, e.g.,
+// Ndiaye, E., Fercoq, O., Gramfort, A., & Salmon, J. (2017). Gap safe screening rules
+// for sparsity enforcing penalties. Journal of Machine Learning Research, 18(128), 1–33.
+//
+// The model has to implement dualFit (see model.h); the built-in regression models in
+// sparse_models.h do so.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief extracts the parameter-specific weights l1_j of the penalty sum_j l1_j |b_j|. The duality
+   * gap is only available if the penalty can be written in this form.
+   *
+   * @param penalty_ penalty
+   * @param tuningParameters tuning parameters of the penalty
+   * @param numberParameters number of parameters
+   * @param l1 will be overwritten with the weights
+   * @return true if the penalty is supported
+   */
+  template <typename T>
+  inline bool l1PenaltyWeights(const penalty<T> &penalty_,
+                               const T &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l1)
+  {
+    return (false);
+  }
+
+  inline bool l1PenaltyWeights(const penalty<tuningParametersEnetGlmnet> &penalty_,
+                               const tuningParametersEnetGlmnet &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l1)
+  {
+    if (dynamic_cast<const penaltyLASSOGlmnet *>(&penalty_) == nullptr)
+      return (false);
+    l1.set_size(numberParameters);
+    for (unsigned int j = 0; j < numberParameters; j++)
+      l1.at(j) = tuningParameters.alpha.at(j) *
+                 tuningParameters.lambda.at(j) *
+                 tuningParameters.weights.at(j);
+    return (true);
+  }
+
+  inline bool l1PenaltyWeights(const penalty<tuningParametersMixedGlmnet> &penalty_,
+                               const tuningParametersMixedGlmnet &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l1)
+  {
+    if (dynamic_cast<const penaltyMixedGlmnet *>(&penalty_) == nullptr)
+      return (false);
+    l1.zeros(numberParameters);
+    for (unsigned int j = 0; j < numberParameters; j++)
+    {
+      if (tuningParameters.penaltyType_.at(j) == penaltyType::none)
+        continue;
+      if (tuningParameters.penaltyType_.at(j) != penaltyType::lasso)
+        return (false);
+      l1.at(j) = tuningParameters.alpha.at(j) *
+                 tuningParameters.lambda.at(j) *
+                 tuningParameters.weights.at(j);
+    }
+    return (true);
+  }
+
+  inline bool l1PenaltyWeights(const penalty<tuningParametersEnet> &penalty_,
+                               const tuningParametersEnet &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l1)
+  {
+    if (dynamic_cast<const penaltyLASSO *>(&penalty_) == nullptr)
+      return (false);
+    l1.set_size(numberParameters);
+    for (unsigned int j = 0; j < numberParameters; j++)
+      l1.at(j) = tuningParameters.alpha *
+                 tuningParameters.lambda *
+                 tuningParameters.weights.at(j);
+    return (true);
+  }
+
+  inline bool l1PenaltyWeights(const penalty<tuningParametersMixedPenalty> &penalty_,
+                               const tuningParametersMixedPenalty &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l1)
+  {
+    if (dynamic_cast<const penaltyMixedPenalty *>(&penalty_) == nullptr)
+      return (false);
+    l1.zeros(numberParameters);
+    for (unsigned int j = 0; j < numberParameters; j++)
+    {
+      if (tuningParameters.pt.at(j) == penaltyType::none)
+        continue;
+      if (tuningParameters.pt.at(j) != penaltyType::lasso)
+        return (false);
+      l1.at(j) = tuningParameters.alpha.at(j) *
+                 tuningParameters.lambda.at(j) *
+                 tuningParameters.weights.at(j);
+    }
+    return (true);
+  }
+
+  /**
+   * @brief extracts the parameter-specific weights l2_j of the smooth penalty sum_j l2_j/2 b_j^2. The duality
+   * gap is only available if the smooth penalty can be written in this form.
+   *
+   * @param smoothPenalty_ smooth penalty
+   * @param tuningParameters tuning parameters of the smooth penalty
+   * @param numberParameters number of parameters
+   * @param l2 will be overwritten with the weights
+   * @return true if the smooth penalty is supported
+   */
+  template <typename T>
+  inline bool l2PenaltyWeights(const smoothPenalty<T> &smoothPenalty_,
+                               const T &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l2)
+  {
+    if (dynamic_cast<const noSmoothPenalty<T> *>(&smoothPenalty_) == nullptr)
+      return (false);
+    l2.zeros(numberParameters);
+    return (true);
+  }
+
+  inline bool l2PenaltyWeights(const smoothPenalty<tuningParametersEnetGlmnet> &smoothPenalty_,
+                               const tuningParametersEnetGlmnet &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l2)
+  {
+    l2.zeros(numberParameters);
+    if (dynamic_cast<const noSmoothPenalty<tuningParametersEnetGlmnet> *>(&smoothPenalty_) != nullptr)
+      return (true);
+    if (dynamic_cast<const penaltyRidgeGlmnet *>(&smoothPenalty_) == nullptr)
+      return (false);
+    // the ridge penalty is lambda_j * b_j^2 (without the factor 1/2)
+    for (unsigned int j = 0; j < numberParameters; j++)
+      l2.at(j) = 2.0 * (1.0 - tuningParameters.alpha.at(j)) *
+                 tuningParameters.lambda.at(j) *
+                 tuningParameters.weights.at(j);
+    return (true);
+  }
+
+  inline bool l2PenaltyWeights(const smoothPenalty<tuningParametersEnet> &smoothPenalty_,
+                               const tuningParametersEnet &tuningParameters,
+                               const unsigned int numberParameters,
+                               arma::rowvec &l2)
+  {
+    l2.zeros(numberParameters);
+    if (dynamic_cast<const noSmoothPenalty<tuningParametersEnet> *>(&smoothPenalty_) != nullptr)
+      return (true);
+    if (dynamic_cast<const penaltyRidge *>(&smoothPenalty_) == nullptr)
+      return (false);
+    if (tuningParameters.alpha == 1)
+      return (true);
+    // the ridge penalty is lambda_j * b_j^2 (without the factor 1/2)
+    for (unsigned int j = 0; j < numberParameters; j++)
+      l2.at(j) = 2.0 * (1.0 - tuningParameters.alpha) *
+                 tuningParameters.lambda *
+                 tuningParameters.weights.at(j);
+    return (true);
+  }
+
+  /**
+   * @brief computes the duality gap of the objective
+   * F(Xb)/sampleSize + sum_j l1_j |b_j| + l2_j/2 b_j^2.
+   * Parameters without penalty (l1_j = l2_j = 0) enter the dual constraints as X_j^T u = 0. This
+   * constraint can not be enforced by scaling; the gap is therefore only certified if the gradients of these
+   * parameters are (close to) zero. Their largest absolute gradient is returned in unpenalizedResidual.
+   *
+   * @param model_ model implementing dualFit
+   * @param parameters current parameter values
+   * @param smoothFit F(Xb)/sampleSize + sum_j l2_j/2 b_j^2
+   * @param smoothGradients gradients of smoothFit
+   * @param l1 weights of the lasso penalty (see l1PenaltyWeights)
+   * @param l2 weights of the ridge penalty (see l2PenaltyWeights)
+   * @param sampleSize the fit of the model is divided by sampleSize in the objective
+   * @param unpenalizedResidual will be overwritten with the largest absolute gradient of the unpenalized parameters
+   * @return double duality gap (NaN if the model does not implement dualFit)
+   */
+  inline double computeDualityGap(model &model_,
+                                  const arma::rowvec &parameters,
+                                  const double smoothFit,
+                                  const arma::rowvec &smoothGradients,
+                                  const arma::rowvec &l1,
+                                  const arma::rowvec &l2,
+                                  const double sampleSize,
+                                  double &unpenalizedResidual)
+  {
+    double primal = smoothFit;
+    double scale = 1.0;
+    unpenalizedResidual = 0.0;
+
+    // c = X^T u for u = -gradient of F(Xb)/sampleSize
+    for (unsigned int j = 0; j < parameters.n_elem; j++)
+    {
+      const double c_j = -(smoothGradients.at(j) - l2.at(j) * parameters.at(j));
+      primal += l1.at(j) * std::abs(parameters.at(j));
+
+      if ((l1.at(j) == 0.0) && (l2.at(j) == 0.0))
+      {
+        unpenalizedResidual = std::max(unpenalizedResidual, std::abs(c_j));
+        continue;
+      }
+      // without ridge, the dual is only finite if |c_j| <= l1_j
+      if ((l2.at(j) == 0.0) && (std::abs(c_j) > l1.at(j)))
+        scale = std::min(scale, l1.at(j) / std::abs(c_j));
+    }
+
+    double dual = model_.dualFit(parameters, scale) / sampleSize;
+    if (!arma::is_finite(dual))
+      return (arma::datum::nan);
+
+    // conjugate of l1_j |b_j| + l2_j/2 b_j^2
+    for (unsigned int j = 0; j < parameters.n_elem; j++)
+    {
+      if (l2.at(j) == 0.0)
+        continue;
+      const double c_j = -(smoothGradients.at(j) - l2.at(j) * parameters.at(j));
+      const double excess = std::max(scale * std::abs(c_j) - l1.at(j), 0.0);
+      dual -= excess * excess / (2.0 * l2.at(j));
+    }
+
+    // the gap can not be negative; small negative values are rounding errors
+    return (std::max(primal - dual, 0.0));
+  }
+
+}
+#endif
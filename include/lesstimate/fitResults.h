@@ -14,6 +14,8 @@ namespace lessSEM
    * @var convergence was the outer breaking condition met?
    * @var parameterValues final parameter values
    * @var Hessian final Hessian approximation (optional)
+   * @var dualityGap certified duality gap at the final parameter values (NaN if not computed; see duality_gap.h)
+   * @var warningCounts number of occurrences of each problem during the fit. Indexed by diagnosticCode (see diagnostics.h)
    */
   struct fitResults
   {
@@ -22,6 +24,8 @@ namespace lessSEM
     bool convergence;
     arma::rowvec parameterValues;
     arma::mat Hessian;
+    double dualityGap;
+    std::vector<unsigned int> warningCounts;
   };
 
 }
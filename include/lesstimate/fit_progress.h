@@ -0,0 +1,153 @@
+#ifndef FIT_PROGRESS_H
+#define FIT_PROGRESS_H
+// the standard headers are included before common_headers.h because the latter defines error as a macro
+#include <atomic>
+#include <mutex>
+
+#include "common_headers.h"
+
+#include "fitResults.h"
+
+// The optimizers report their progress to a fitProgress object if one is passed
+// in the control settings (controlGLMNET.progress and controlIsta.progress). The
+// progress can be polled from other threads while the optimizer is running and
+// the optimization can be cancelled. This is used by the asynchronous fitting
+// functions (see async_fitting.h).
+
+namespace lessSEM
+{
+
+  /**
+   * @brief progress of one or more consecutive fits (e.g., a regularization path). All methods can
+   * be called from multiple threads at the same time.
+   */
+  class fitProgress
+  {
+  public:
+    fitProgress()
+    {
+      startFit();
+    }
+
+    fitProgress(const fitProgress &) = delete;
+    fitProgress &operator=(const fitProgress &) = delete;
+
+    /**
+     * @brief called by the optimizers at the beginning of each fit. Resets the iteration and the best fit.
+     */
+    void startFit()
+    {
+      std::unique_lock<std::mutex> lock(snapshotMutex);
+      iteration_.store(0);
+      bestFit_ = arma::datum::inf;
+      bestParameters_.reset();
+    }
+
+    /**
+     * @brief called by the optimizers after each outer iteration
+     *
+     * @param iteration current outer iteration
+     * @param fit regularized fit in this iteration
+     * @param parameters parameter values in this iteration
+     */
+    void report(const unsigned int iteration,
+                const double fit,
+                const arma::rowvec &parameters)
+    {
+      iteration_.store(iteration);
+      std::unique_lock<std::mutex> lock(snapshotMutex);
+      if (fit < bestFit_)
+      {
+        bestFit_ = fit;
+        bestParameters_ = parameters;
+      }
+    }
+
+    /**
+     * @brief called by the optimizers at the end of each fit
+     */
+    void finishFit()
+    {
+      completedFits_.fetch_add(1);
+    }
+
+    /**
+     * @brief returns the outer iteration of the current fit
+     *
+     * @return unsigned int
+     */
+    unsigned int iteration() const
+    {
+      return (iteration_.load());
+    }
+
+    /**
+     * @brief returns the number of finished fits (e.g., the number of lambda values of a regularization path)
+     *
+     * @return unsigned int
+     */
+    unsigned int completedFits() const
+    {
+      return (completedFits_.load());
+    }
+
+    /**
+     * @brief returns the best regularized fit of the current fit so far
+     *
+     * @return double inf if no iteration has been completed
+     */
+    double bestFit() const
+    {
+      std::unique_lock<std::mutex> lock(snapshotMutex);
+      return (bestFit_);
+    }
+
+    /**
+     * @brief returns the parameters with the best fit of the current fit so far
+     *
+     * @return fitResults with fit and parameterValues. convergence is false; the other elements are empty.
+     */
+    fitResults snapshot() const
+    {
+      fitResults fitResults_;
+      {
+        std::unique_lock<std::mutex> lock(snapshotMutex);
+        fitResults_.fit = bestFit_;
+        fitResults_.parameterValues = bestParameters_;
+      }
+      fitResults_.convergence = false;
+      fitResults_.dualityGap = arma::datum::nan;
+      return (fitResults_);
+    }
+
+    /**
+     * @brief asks the optimizer to stop after the current outer iteration. The optimizer returns
+     * the current parameter values with convergence = false. Cancelled fits are not reported
+     * as outer iterations that did not converge.
+     */
+    void cancel()
+    {
+      cancelled_.store(true);
+    }
+
+    /**
+     * @brief returns true if cancel has been called
+     *
+     * @return bool
+     */
+    bool cancelled() const
+    {
+      return (cancelled_.load());
+    }
+
+  private:
+    std::atomic<unsigned int> iteration_{0};
+    std::atomic<unsigned int> completedFits_{0};
+    std::atomic<bool> cancelled_{false};
+    mutable std::mutex snapshotMutex;
+    double bestFit_;
+    arma::rowvec bestParameters_;
+  };
+
+}
+#endif
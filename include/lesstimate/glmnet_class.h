@@ -8,6 +8,13 @@
 #include "glmnet_ridge.h"
 #include "enet.h"
 #include "bfgs.h"
+#include "line_search.h"
+#include "duality_gap.h"
+#include "speculative_evaluation.h"
+#include "parallel.h"
+#include "profiling.h"
+#include "diagnostics.h"
+#include "fit_progress.h"
 
 // The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
 // user supplies a C++ class with methods fit and gradients which is used
@@ -34,12 +41,39 @@ namespace lessSEM
   {
     GLMNET,    /** Uses the convergence criterion outlined in Yuan et al. (2012) for GLMNET. Note that in case of BFGS, this will be identical to using the Armijo condition.*/
     fitChange, /** Uses the change in fit from one iteration to the next.*/
-    gradients  /** Uses the gradients; if all are (close to) zero, the minimum is found*/
+    gradients, /** Uses the gradients; if all are (close to) zero, the minimum is found*/
+    kkt,       /** Uses the residual of the optimality (KKT) conditions; the optimization stops if
+                   max_j |H_jj * z_j| <= breakKKTAbsolute + breakKKTRelative * (residual at the starting values), where z_j is
+                   the coordinate step of the inner iteration computed at the current parameters. For the lasso, this is the
+                   smallest subgradient unless the step crosses zero. Works for all penalties, including mixed penalties.*/
+    dualityGap /** Uses the duality gap, which bounds the distance of the penalized fit to the optimum; the optimization stops if
+                   the gap is smaller than breakOuter. Only available for models implementing dualFit (e.g., the regression models in
+                   sparse_models.h) with lasso or elastic net penalties. Unpenalized parameters must additionally have gradients
+                   smaller than breakOuter. See duality_gap.h.*/
   };
   const std::vector<std::string> convergenceCriteriaGlmnet_txt = {
       "GLMNET",
       "fitChange",
-      "gradients"};
+      "gradients",
+      "kkt",
+      "dualityGap"};
+
+  /**
+   * Specifies the order in which the parameters are updated in the inner iterations of glmnet.
+   */
+  enum coordinateOrderGlmnet
+  {
+    randomOrder,     /** Uses a new random order in each inner iteration.*/
+    cyclic,          /** Updates the parameters in the order 1, ..., p.*/
+    permutationPool, /** Cycles through a small pool of random orders which is drawn once per optimization.*/
+    gaussSouthwell   /** Updates the parameters in the order of the largest expected decrease of the quadratic approximation
+                         in the previous inner iteration. Parameters that no longer change are skipped until all others converged.*/
+  };
+  const std::vector<std::string> coordinateOrderGlmnet_txt = {
+      "randomOrder",
+      "cyclic",
+      "permutationPool",
+      "gaussSouthwell"};
 
   /**
    *
@@ -55,10 +89,27 @@ namespace lessSEM
    * @var maxIterLine Maximal number of iterations for the line search procedure
    * @var breakOuter Stopping criterion for outer iterations
    * @var breakInner Stopping criterion for inner iterations
-   * @var convergenceCriterion which convergence criterion should be used for the outer iterations? possible are 0 = GLMNET, 1 = fitChange, 2 = gradients.
-   * Note that in case of gradients and GLMNET, we divide the gradients (and the Hessian) of the log-Likelihood by N as it would otherwise be
+   * @var convergenceCriterion which convergence criterion should be used for the outer iterations? possible are 0 = GLMNET, 1 = fitChange, 2 = gradients,
+   * 3 = kkt, 4 = dualityGap. Note that in case of gradients and GLMNET, we divide the gradients (and the Hessian) of the log-Likelihood by N as it would otherwise be
    * considerably more difficult for larger sample sizes to reach the convergence criteria.
    * @var verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @var seed seed of the random number generator used to randomize the order of the coordinate updates
+   * @var coordinateOrder order in which the parameters are updated in the inner iterations. See coordinateOrderGlmnet.
+   * @var lineSearch procedure used to find the step size in the outer iterations. backtracking or interpolation. See lineSearchType.
+   * @var hessianScaling if initialHessian is a 1x1 matrix (i.e., no full Hessian is provided), the initial Hessian
+   * is rescaled after the first step. See initialHessianScaling. If not specified, no scaling is used; this is also the
+   * default of controlGlmnetDefault so that positional initializations which stop before hessianScaling behave the same.
+   * @var breakKKTAbsolute absolute tolerance of the kkt convergence criterion (only used if convergenceCriterion = kkt)
+   * @var breakKKTRelative tolerance of the kkt convergence criterion relative to the residual at the starting values
+   * @var speculativeTrials number of step sizes of the backtracking line search which are evaluated concurrently
+   * on copies of the model (see speculative_evaluation.h). 0 and 1 evaluate the step sizes sequentially. Requires
+   * lineSearch = backtracking and a model implementing clone(). If the fit only depends on the parameter values, the results
+   * are identical to those of the sequential search; models with internal state may differ in the last digits. The copies
+   * are created in each optimization (see glmnetOptimizer::setReuseModelCopies).
+   * @var parallelInnerUpdates number of coordinates which are updated simultaneously in the inner iterations (Shotgun; see glmnetInner).
+   * 0 and 1 update the coordinates one at a time. Only recommended for many weakly correlated parameters.
+   * @var progress if not a nullptr, the optimizer reports its progress after each outer iteration and stops
+   * if the fit is cancelled (see fit_progress.h). The object must outlive the optimization.
    */
   struct controlGLMNET
   {
@@ -75,6 +126,15 @@ namespace lessSEM
     // breaking condition.
     int verbose; // if set to a value > 0, the fit every verbose iterations
     // is printed.
+    unsigned int seed; // seed of the random number generator
+    coordinateOrderGlmnet coordinateOrder; // order of the updates in the inner iterations
+    lineSearchType lineSearch;             // procedure used to find the step size
+    initialHessianScaling hessianScaling;  // scaling of the initial Hessian if none is provided
+    double breakKKTAbsolute;               // absolute tolerance of the kkt convergence criterion
+    double breakKKTRelative;               // relative tolerance of the kkt convergence criterion
+    unsigned int speculativeTrials;        // number of step sizes evaluated concurrently in the line search
+    unsigned int parallelInnerUpdates;     // number of coordinates updated simultaneously in the inner iterations
+    fitProgress *progress;                 // progress reporting and cancellation
   };
 
   /**
@@ -98,12 +158,154 @@ namespace lessSEM
         1e-10,          // breakInner;
         fitChange,      // convergenceCriterion; // this is related to the inner
         // breaking condition.
-        0 // verbose; // if set to a value > 0, the fit every verbose iterations
-          // is printed.
+        0, // verbose; // if set to a value > 0, the fit every verbose iterations
+           // is printed.
+        0, // seed
+        randomOrder,      // coordinateOrder
+        backtracking,     // lineSearch
+        noHessianScaling,  // hessianScaling
+        1e-6,              // breakKKTAbsolute
+        1e-6,              // breakKKTRelative
+        0,                 // speculativeTrials
+        0,                 // parallelInnerUpdates
+        nullptr            // progress
     };
     return (defaultIs);
   }
 
+  /**
+   * @brief Selects the order in which the parameters are updated in the inner iterations of glmnet.
+   * The selector is created once per optimization and reused in each outer iteration.
+   */
+  class coordinateSelector
+  {
+  public:
+    /**
+     * @brief Construct a new coordinate selector
+     *
+     * @param coordinateOrder_ strategy used to select the order of the updates
+     * @param seed seed of the random number generator
+     * @param poolSize_ number of random orders in the pool (only used for permutationPool)
+     */
+    coordinateSelector(const coordinateOrderGlmnet coordinateOrder_,
+                       const unsigned int seed,
+                       const unsigned int poolSize_ = 10) : coordinateOrder(coordinateOrder_),
+                                                           rng(seed),
+                                                           poolSize(poolSize_) {}
+
+    /**
+     * @brief Reset the selector to the state after construction. The memory of the
+     * orders is kept for the next optimization.
+     *
+     * @param coordinateOrder_ strategy used to select the order of the updates
+     * @param seed seed of the random number generator
+     */
+    void reset(const coordinateOrderGlmnet coordinateOrder_,
+               const unsigned int seed)
+    {
+      coordinateOrder = coordinateOrder_;
+      rng = randomNumberGenerator(seed);
+      // forces a call to initialize in the next call to getOrder
+      order.clear();
+    }
+
+    /**
+     * @brief Returns the order in which the parameters are updated in the next sweep
+     *
+     * @param nParameters number of parameters
+     * @param expectedDecrease expected decrease of the quadratic model from the last update of each parameter.
+     * Only used by gaussSouthwell
+     * @param fullSweep if false, gaussSouthwell will only return the parameters with
+     * expectedDecrease >= threshold
+     * @param threshold see fullSweep
+     * @return const std::vector<unsigned int>& indices of the parameters
+     */
+    const std::vector<unsigned int> &getOrder(const unsigned int nParameters,
+                                              const arma::rowvec &expectedDecrease,
+                                              const bool fullSweep,
+                                              const double threshold)
+    {
+      if (order.size() != nParameters)
+        initialize(nParameters);
+
+      switch (coordinateOrder)
+      {
+      case randomOrder:
+        rng.shuffle(order);
+        return (order);
+      case cyclic:
+        return (order);
+      case permutationPool:
+        currentPermutation = (currentPermutation + 1) % pool.size();
+        return (pool.at(currentPermutation));
+      case gaussSouthwell:
+      {
+        // update the parameters with the largest expected decrease first
+        active.clear();
+        for (unsigned int j : order)
+        {
+          if (fullSweep || (expectedDecrease.at(j) >= threshold))
+            active.push_back(j);
+        }
+        std::stable_sort(active.begin(), active.end(),
+                         [&expectedDecrease](const unsigned int a, const unsigned int b)
+                         { return (expectedDecrease.at(a) > expectedDecrease.at(b)); });
+        return (active);
+      }
+      default:
+        error("Unknown coordinate order.");
+      }
+      return (order);
+    }
+
+    /**
+     * @brief returns the coordinate order used by the selector
+     *
+     * @return coordinateOrderGlmnet
+     */
+    coordinateOrderGlmnet getCoordinateOrder() const
+    {
+      return (coordinateOrder);
+    }
+
+  private:
+    coordinateOrderGlmnet coordinateOrder;
+    randomNumberGenerator rng;
+    const unsigned int poolSize;
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> active;
+    std::vector<std::vector<unsigned int>> pool;
+    unsigned int currentPermutation = 0;
+
+    void initialize(const unsigned int nParameters)
+    {
+      order.resize(nParameters);
+      for (unsigned int i = 0; i < nParameters; i++)
+        order.at(i) = i;
+
+      if (coordinateOrder == permutationPool)
+      {
+        pool.assign(std::max(poolSize, 1u), order);
+        for (auto &permutation : pool)
+          rng.shuffle(permutation);
+        currentPermutation = 0;
+      }
+    }
+  };
+
+  /**
+   * @brief memory used by the inner iterations of glmnet. Reusing the workspace
+   * between calls avoids allocating memory in each outer iteration.
+   */
+  struct glmnetInnerWorkspace
+  {
+    arma::rowvec expectedDecrease;    ///> expected decrease of the last update of each parameter
+    arma::rowvec HessianDiagonal;     ///> diagonal of the Hessian
+    unsigned int parallelUpdates = 1; ///> number of coordinates updated simultaneously
+    std::unique_ptr<threadPool> pool; ///> threads used for the simultaneous updates
+    std::vector<double> blockUpdates; ///> updates of the coordinates in the current block
+  };
+
   /**
    * @brief The glmnet optimizer has an outer and an inner optimization loop. This function implements
    * the inner optimization loop which returns the step direction.
@@ -117,77 +319,183 @@ namespace lessSEM
    * @param maxIterIn Maximal number of inner iterations
    * @param breakInner Stopping criterion for inner iterations
    * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
-   * @return arma::rowvec with parameters
+   * @param selector selects the order in which the parameters are updated
+   * @param workspace memory used in the inner iterations. If workspace.parallelUpdates > 1, blocks of
+   * coordinates are updated simultaneously (see below).
+   * @param stepDirection will be overwritten with the step direction
+   *
+   * Parallel updates follow Shotgun:
+   * Bradley, J. K., Kyrola, A., Bickson, D., & Guestrin, C. (2011). Parallel coordinate descent for
+   * L1-regularized loss minimization. Proceedings of the 28th International Conference on Machine Learning, 321–328.
+   * The update order is split into blocks of workspace.parallelUpdates coordinates. The updates of all coordinates in
+   * a block are computed from the same step direction (possibly on different threads) and are then added in the
+   * update order. The result therefore only depends on the block size, not on the number of threads or their timing.
+   * Simultaneous updates may diverge if the coordinates are strongly coupled in the Hessian. If the largest expected
+   * decrease of a sweep exceeds that of the previous sweep, the remaining sweeps update one coordinate at a time.
+   * The getZ function of the penalty must not change the state of the penalty (true for all built-in penalties).
    */
   template <typename nonsmoothPenalty,
             typename tuning>
-  inline arma::rowvec glmnetInner(const arma::rowvec &parameters_kMinus1,
-                                  const arma::rowvec &gradients_kMinus1,
-                                  const arma::mat &Hessian,
-                                  nonsmoothPenalty &penalty_,
-                                  const tuning &tuningParameters,
-                                  const int maxIterIn,
-                                  const double breakInner,
-                                  const int verbose)
+  inline void glmnetInner(const arma::rowvec &parameters_kMinus1,
+                          const arma::rowvec &gradients_kMinus1,
+                          const arma::mat &Hessian,
+                          nonsmoothPenalty &penalty_,
+                          const tuning &tuningParameters,
+                          const int maxIterIn,
+                          const double breakInner,
+                          const int verbose,
+                          coordinateSelector &selector,
+                          glmnetInnerWorkspace &workspace,
+                          arma::rowvec &stepDirection)
   {
-    arma::rowvec stepDirection = parameters_kMinus1;
-    stepDirection.fill(0.0);
-    arma::rowvec z = parameters_kMinus1;
-    z.fill(0.0);
-    // arma::rowvec parameters_k = parameters_kMinus1;
-    // parameters_k.fill(0.0);
-    arma::colvec HessTimesZ(Hessian.n_rows, arma::fill::zeros);
-    arma::mat HessDiag(Hessian.n_rows, Hessian.n_cols, arma::fill::zeros); //,
-                                                                           // zChange(1, 1, arma::fill::zeros);
-    double z_j;
-
-    HessDiag.diag() = Hessian.diag();
-
-    // the order in which parameters are updated should be random
-    numericVector randOrder(stepDirection.n_elem);
-    numericVector sampleFrom(stepDirection.n_elem);
-    for (unsigned int i = 0; i < stepDirection.n_elem; i++)
-      sampleFrom.at(i) = i;
+    LESSTIMATE_PROFILE_SCOPE("glmnet::inner");
+    stepDirection.zeros(parameters_kMinus1.n_elem);
+    // The expected decrease H_jj * z_j^2 of the last update of each parameter
+    // is used for the stopping criterion and by the Gauss-Southwell rule. We
+    // start with infinity to make sure that each parameter is updated.
+    arma::rowvec &expectedDecrease = workspace.expectedDecrease;
+    expectedDecrease.set_size(parameters_kMinus1.n_elem);
+    expectedDecrease.fill(arma::datum::inf);
+    arma::rowvec &HessianDiagonal = workspace.HessianDiagonal;
+    HessianDiagonal.set_size(parameters_kMinus1.n_elem);
+    for (unsigned int j = 0; j < parameters_kMinus1.n_elem; j++)
+      HessianDiagonal.at(j) = Hessian.at(j, j);
+    double z_j, maxDecrease;
+
+    // Gauss-Southwell only updates the parameters that still change; before stopping,
+    // we make sure that none of the other parameters changes either
+    bool fullSweep = true;
+
+    bool parallel = (workspace.parallelUpdates > 1) && workspace.pool;
+    const unsigned int blockSize = workspace.parallelUpdates;
+    diagnostics *fitDiagnostics = diagnostics::active();
+    double previousMaxDecrease = arma::datum::inf;
+    if (parallel)
+      workspace.blockUpdates.resize(blockSize);
 
     for (int it = 0; it < maxIterIn; it++)
     {
+      const std::vector<unsigned int> &updateOrder = selector.getOrder(stepDirection.n_elem,
+                                                                       expectedDecrease,
+                                                                       fullSweep,
+                                                                       breakInner);
+      maxDecrease = 0.0;
 
-      // reset direction z
-      z.fill(arma::fill::zeros);
-      // z_old.fill(arma::fill::zeros);
-
-      // iterate over parameters in random order
-      randOrder = sample(sampleFrom, stepDirection.n_elem, false);
+      if (parallel)
+      {
+        for (unsigned int start = 0; start < updateOrder.size(); start += blockSize)
+        {
+          const unsigned int nUpdates = std::min(blockSize, (unsigned int)updateOrder.size() - start);
+
+          // all updates of the block are based on the same step direction
+          workspace.pool->parallelFor(
+              nUpdates,
+              [&](const unsigned int i, const unsigned int chunk)
+              {
+                // the workers report to the collector of the fit
+                diagnosticsScope diagnosticsScope_(fitDiagnostics);
+                workspace.blockUpdates.at(i) = penalty_.getZ(
+                    updateOrder.at(start + i),
+                    parameters_kMinus1,
+                    gradients_kMinus1,
+                    stepDirection,
+                    Hessian,
+                    tuningParameters);
+              });
+
+          for (unsigned int i = 0; i < nUpdates; i++)
+          {
+            const unsigned int j = updateOrder.at(start + i);
+            z_j = workspace.blockUpdates.at(i);
+            stepDirection.at(j) += z_j;
+
+            expectedDecrease.at(j) = HessianDiagonal.at(j) * z_j * z_j;
+            if (!arma::is_finite(expectedDecrease.at(j)))
+              expectedDecrease.at(j) = arma::datum::inf;
+            maxDecrease = std::max(maxDecrease, expectedDecrease.at(j));
+          }
+        }
 
-      for (unsigned int p = 0; p < stepDirection.n_elem; p++)
+        // the simultaneous updates do not converge; continue with one coordinate at a time
+        if (maxDecrease > previousMaxDecrease)
+        {
+          if (verbose != 0)
+            print << "Parallel inner updates did not converge. Updating one coordinate at a time.\n";
+          parallel = false;
+        }
+        previousMaxDecrease = maxDecrease;
+      }
+      else
       {
-        // get the update to the parameter:
-        z_j = penalty_.getZ(
-            randOrder.at(p),
-            parameters_kMinus1,
-            gradients_kMinus1,
-            stepDirection,
-            Hessian,
-            tuningParameters);
-        z.col(randOrder.at(p)) = z_j;
-        stepDirection.col(randOrder.at(p)) += z_j;
+        for (unsigned int j : updateOrder)
+        {
+          // get the update to the parameter:
+          z_j = penalty_.getZ(
+              j,
+              parameters_kMinus1,
+              gradients_kMinus1,
+              stepDirection,
+              Hessian,
+              tuningParameters);
+          stepDirection.at(j) += z_j;
+
+          expectedDecrease.at(j) = HessianDiagonal.at(j) * z_j * z_j;
+          if (!arma::is_finite(expectedDecrease.at(j)))
+            expectedDecrease.at(j) = arma::datum::inf;
+          maxDecrease = std::max(maxDecrease, expectedDecrease.at(j));
+        }
       }
 
       // check inner stopping criterion:
-      HessTimesZ = HessDiag * arma::pow(arma::trans(z), 2);
-
-      // zChange = z*arma::trans(z_old);
-      // if(useMultipleConvergenceCriteria & (zChange(0,0) < breakInner)){
-      //   break;
-      // }
-
-      if (HessTimesZ.max() < breakInner)
+      if (maxDecrease < breakInner)
       {
-        break;
+        if (fullSweep)
+          break;
+        fullSweep = true;
+        continue;
       }
-      // z_old = z;
+
+      fullSweep = selector.getCoordinateOrder() != gaussSouthwell;
     }
+  }
 
+  /**
+   * @brief The glmnet optimizer has an outer and an inner optimization loop. This function implements
+   * the inner optimization loop which returns the step direction. See above for details.
+   * @param parameters_kMinus1 parameter estimates from previous iteration k-1
+   * @param gradients_kMinus1 gradients from previous iteration
+   * @param Hessian Hessian_kMinus1 Hessian from previous iteration
+   * @param maxIterIn Maximal number of inner iterations
+   * @param breakInner Stopping criterion for inner iterations
+   * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
+   * @param selector selects the order in which the parameters are updated
+   * @return arma::rowvec with parameters
+   */
+  template <typename nonsmoothPenalty,
+            typename tuning>
+  inline arma::rowvec glmnetInner(const arma::rowvec &parameters_kMinus1,
+                                  const arma::rowvec &gradients_kMinus1,
+                                  const arma::mat &Hessian,
+                                  nonsmoothPenalty &penalty_,
+                                  const tuning &tuningParameters,
+                                  const int maxIterIn,
+                                  const double breakInner,
+                                  const int verbose,
+                                  coordinateSelector &selector)
+  {
+    glmnetInnerWorkspace workspace;
+    arma::rowvec stepDirection;
+    glmnetInner(parameters_kMinus1,
+                gradients_kMinus1,
+                Hessian,
+                penalty_,
+                tuningParameters,
+                maxIterIn,
+                breakInner,
+                verbose,
+                selector,
+                workspace,
+                stepDirection);
     return (stepDirection);
   }
 
@@ -214,11 +522,16 @@ namespace lessSEM
    * @param gamma Controls the gamma parameter in Yuan, G.-X., Ho, C.-H., & Lin, C.-J. (2012). An improved GLMNET for l1-regularized logistic regression. The Journal of Machine Learning Research, 13, 1999–2030. https://doi.org/10.1145/2020408.2020421. Defaults to 0.
    * @param maxIterLine Maximal number of iterations for the line search procedure
    * @param verbose 0 prints no additional information, > 0 prints GLMNET iterations
-   * @return vector with updated parameters (parameters_k)
+   * @param lineSearch_ backtracking or interpolation. See lineSearchType.
+   * @param stepSize_k step size accepted in the previous outer iteration (used by the interpolation to find
+   * the first trial step size). Will be overwritten with the step size accepted in this line search.
+   * @param parameters_k will be overwritten with the updated parameters
+   * @param speculative if not nullptr, the fits of the backtracking step sizes are evaluated concurrently. The
+   * evaluator must have been prepared with model_. Ignored by the interpolation.
    */
   template <typename nonsmoothPenalty, typename smoothPenalty,
             typename tuning>
-  inline arma::rowvec glmnetLineSearch(
+  inline void glmnetLineSearch(
       model &model_,
       nonsmoothPenalty &penalty_,
       smoothPenalty &smoothPenalty_,
@@ -235,14 +548,16 @@ namespace lessSEM
       const double sigma,
       const double gamma,
       const int maxIterLine,
-      const int verbose)
+      const int verbose,
+      const lineSearchType lineSearch_,
+      double &stepSize_k,
+      arma::rowvec &parameters_k,
+      speculativeEvaluator *speculative = nullptr)
   {
+    LESSTIMATE_PROFILE_SCOPE("glmnet::lineSearch");
+    const labelHandle labels(parameterLabels);
 
-    arma::rowvec gradients_k(gradients_kMinus1.n_rows);
-    gradients_k.fill(arma::datum::nan);
-    arma::rowvec parameters_k(gradients_kMinus1.n_rows);
-    parameters_k.fill(arma::datum::nan);
-    numericVector randomNumber;
+    arma::rowvec gradients_k;
 
     double fit_k; // new fit value of differentiable part
     double p_k;   // new penalty value
@@ -258,28 +573,38 @@ namespace lessSEM
     // penalty
     double f_0 = fit_kMinus1 + pen_0;
     // needed for convergence criterion (see Yuan et al. (2012), Eq. 20)
-    double pen_d = penalty_.getValue(parameters_kMinus1 + direction,
+    parameters_k = parameters_kMinus1 + direction;
+    double pen_d = penalty_.getValue(parameters_k,
                                      parameterLabels,
                                      tuningParameters);
+    parameters_k.fill(arma::datum::nan);
 
-    double currentStepSize;
-    // a step size of >= 1 would result in no change or in an increasing step
-    // size
-    if (stepSize >= 1)
-    {
-      currentStepSize = .9;
-    }
-    else
-    {
-      currentStepSize = stepSize;
-    }
-
-    randomNumber = unif(1, 0.0, 1.0);
-    if (randomNumber.at(0) < 0.25)
-    {
-      numericVector tmp = unif(1, .5, .99);
-      currentStepSize = tmp.at(0);
-    }
+    // The right hand side of the line search criterion does not depend on the step size and
+    // is therefore only computed once.
+    // see Equation 20 in Yuan, G.-X., Ho, C.-H., & Lin, C.-J. (2012).
+    // An improved GLMNET for l1-regularized logistic regression.
+    // The Journal of Machine Learning Research, 13, 1999–2030.
+    // https://doi.org/10.1145/2020408.2020421
+    double compareTo = arma::dot(gradients_kMinus1, direction) + // gradients and direction typically show
+                       // in the same direction -> positive
+                       pen_d - pen_0;
+    // gamma is set to zero by Yuan et al. (2012)
+    if (gamma != 0.0)
+      compareTo += gamma * arma::as_scalar(direction * Hessian_kMinus1 * arma::trans(direction)); // always positive
+
+    if (lineSearch_ == strongWolfe)
+      error("The strongWolfe line search requires a differentiable objective and is only available for bfgsOptim.");
+
+    // compareTo takes the role of the directional derivative in the interpolation;
+    // this requires a descent direction. Otherwise, we fall back to backtracking.
+    const bool interpolate = (lineSearch_ == interpolation) && (compareTo < 0.0);
+    // the backtracking step sizes are known in advance and can be evaluated speculatively
+    const bool speculate = (speculative != nullptr) && !interpolate;
+
+    double currentStepSize = interpolate ? initialTrialStepSize(stepSize_k, stepSize) : 1.0;
+    double previousStepSize = 0.0;
+    double phi_previous = 0.0;
+    bool hasPrevious = false;
 
     bool converged = false;
 
@@ -287,13 +612,25 @@ namespace lessSEM
     {
 
       // set step size
-      currentStepSize = std::pow(stepSize, iteration); // starts with 1 and
+      if (!interpolate)
+        currentStepSize = std::pow(stepSize, iteration); // starts with 1 and
       // then decreases with each iteration
 
+      if (speculate && (iteration % speculative->size() == 0))
+      {
+        const unsigned int nTrials = std::min(speculative->size(),
+                                              (unsigned int)(maxIterLine - iteration));
+        for (unsigned int trial = 0; trial < nTrials; trial++)
+          speculative->trialParameters.at(trial) = parameters_kMinus1 +
+                                                   std::pow(stepSize, iteration + trial) * direction;
+        speculative->evaluateFits(nTrials, labels);
+      }
+
       parameters_k = parameters_kMinus1 + currentStepSize * direction;
 
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
+      fit_k = (speculate ? speculative->fit(iteration % speculative->size())
+                         : LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k,
+                                                                                labels))) +
               smoothPenalty_.getValue(parameters_k,
                                       parameterLabels,
                                       tuningParameters);
@@ -301,6 +638,8 @@ namespace lessSEM
       if (!arma::is_finite(fit_k))
       {
         // skip to next iteration and try a smaller step size
+        currentStepSize *= stepSize;
+        hasPrevious = false;
         continue;
       }
 
@@ -316,311 +655,628 @@ namespace lessSEM
 
       // test line search criterion. g(stepSize) must show a large enough decrease
       // to be accepted
-      // see Equation 20 in Yuan, G.-X., Ho, C.-H., & Lin, C.-J. (2012).
-      // An improved GLMNET for l1-regularized logistic regression.
-      // The Journal of Machine Learning Research, 13, 1999–2030.
-      // https://doi.org/10.1145/2020408.2020421
-
-      arma::mat compareTo =
-          gradients_kMinus1 * arma::trans(direction) + // gradients and direction typically show
-          // in the same direction -> positive
-          gamma * (direction * Hessian_kMinus1 * arma::trans(direction)) + // always positive
-          pen_d - pen_0;
-      // gamma is set to zero by Yuan et al. (2012)
       // if sigma is 0, no decrease is necessary
-
-      converged = f_k - f_0 <= sigma * currentStepSize * compareTo(0, 0);
+      converged = f_k - f_0 <= sigma * currentStepSize * compareTo;
 
       if (converged)
       {
         // check if gradients can be computed at the new location;
         // this can often cause issues
-        gradients_k = model_.gradients(parameters_k,
-                                       parameterLabels);
+        gradients_k = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                       labels));
 
         if (!arma::is_finite(gradients_k))
         {
           // go to next iteration and test smaller step size
+          currentStepSize *= stepSize;
+          hasPrevious = false;
           continue;
         }
         // else
         break;
       }
 
+      if (interpolate)
+      {
+        const double nextStepSize = interpolateStepSize(currentStepSize,
+                                                        f_k - f_0,
+                                                        previousStepSize,
+                                                        phi_previous,
+                                                        hasPrevious,
+                                                        compareTo);
+        previousStepSize = currentStepSize;
+        phi_previous = f_k - f_0;
+        hasPrevious = true;
+        currentStepSize = nextStepSize;
+      }
+
     } // end line search
 
-    return (parameters_k);
+    stepSize_k = currentStepSize;
   }
 
-  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
-  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
-  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
-  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
-  // second function call can be easier when coming from R.
-
   /**
-   * @brief Optimize a model using the glmnet procedure.
+   * @brief Given a step direction "direction", the line search procedure will find an adequate
+   * step length s in this direction. The new parameter values are then given by
+   * parameters_k = parameters_kMinus1 + s*direction. See above for details on the arguments.
    *
-   * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
-   * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
-   * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
-   * @param model_ the model object derived from the model class in model.h
-   * @param startingValuesRcpp an Rcpp numeric vector with starting values
-   * @param penalty_ a penalty derived from the penalty class in penalty.h
-   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
-   * @param tuningParameters tuning parameters for the penalty functions. Note that both penalty functions must
-   * take the same tuning parameters.
-   * @param control_ settings for the glmnet optimizer.
-   * @return fit result
+   * @return vector with updated parameters (parameters_k)
    */
   template <typename nonsmoothPenalty, typename smoothPenalty,
             typename tuning>
-  inline lessSEM::fitResults glmnet(model &model_,
-                                    numericVector startingValuesRcpp,
-                                    nonsmoothPenalty &penalty_,
-                                    smoothPenalty &smoothPenalty_,
-                                    const tuning &tuningParameters,
-                                    const controlGLMNET &control_ = controlGlmnetDefault())
+  inline arma::rowvec glmnetLineSearch(
+      model &model_,
+      nonsmoothPenalty &penalty_,
+      smoothPenalty &smoothPenalty_,
+      const arma::rowvec &parameters_kMinus1,
+      const stringVector &parameterLabels,
+      const arma::rowvec &direction,
+      const double fit_kMinus1,
+      const arma::rowvec &gradients_kMinus1,
+      const arma::mat &Hessian_kMinus1,
+
+      const tuning &tuningParameters,
+
+      const double stepSize,
+      const double sigma,
+      const double gamma,
+      const int maxIterLine,
+      const int verbose)
   {
+    arma::rowvec parameters_k(parameters_kMinus1.n_elem);
+    double stepSize_k = 1.0;
+    glmnetLineSearch(model_,
+                     penalty_,
+                     smoothPenalty_,
+                     parameters_kMinus1,
+                     parameterLabels,
+                     direction,
+                     fit_kMinus1,
+                     gradients_kMinus1,
+                     Hessian_kMinus1,
+                     tuningParameters,
+                     stepSize,
+                     sigma,
+                     gamma,
+                     maxIterLine,
+                     verbose,
+                     backtracking,
+                     stepSize_k,
+                     parameters_k);
+    return (parameters_k);
+  }
 
-    if (control_.verbose != 0)
+  /**
+   * @brief computes the residual of the optimality conditions used by the kkt convergence criterion:
+   * max_j |H_jj * z_j|, where z_j is the step of the inner iteration for parameter j starting at the
+   * current parameters. z_j is zero if and only if parameter j is (coordinate-wise) optimal.
+   *
+   * @param penalty_ a penalty derived from the penalty class in penalty.h
+   * @param parameters current parameter values
+   * @param gradients gradients of the differentiable part at the current parameters
+   * @param Hessian Hessian (approximation) at the current parameters
+   * @param tuningParameters tuning parameters for the penalty function
+   * @param zeroDirection workspace; will be set to zero
+   * @return double
+   */
+  template <typename nonsmoothPenalty, typename tuning>
+  inline double glmnetKKTResidual(nonsmoothPenalty &penalty_,
+                                  const arma::rowvec &parameters,
+                                  const arma::rowvec &gradients,
+                                  const arma::mat &Hessian,
+                                  const tuning &tuningParameters,
+                                  arma::rowvec &zeroDirection)
+  {
+    zeroDirection.zeros(parameters.n_elem);
+    double residual = 0.0;
+    for (unsigned int j = 0; j < parameters.n_elem; j++)
     {
-      print << "Optimizing with glmnet.\n";
+      const double z_j = penalty_.getZ(j,
+                                       parameters,
+                                       gradients,
+                                       zeroDirection,
+                                       Hessian,
+                                       tuningParameters);
+      const double residual_j = std::abs(Hessian.at(j, j) * z_j);
+      if (!arma::is_finite(residual_j))
+        return (arma::datum::inf);
+      residual = std::max(residual, residual_j);
     }
+    return (residual);
+  }
 
-    // separate labels and values
-    arma::rowvec startingValues = toArmaVector(startingValuesRcpp);
-    stringVector parameterLabels = startingValuesRcpp.names();
-
-    // prepare parameter vectors
-    arma::rowvec parameters_k = startingValues,
-                 parameters_kMinus1 = startingValues;
-    arma::rowvec direction(startingValues.n_elem);
+  /**
+   * @brief glmnet optimizer which owns all memory used in the optimization. When the same
+   * object is used to optimize a model repeatedly (e.g., for many tuning parameters or
+   * different starting values), the memory allocated in the first optimization is reused.
+   *
+   * Example:
+   *
+   * lessSEM::glmnetOptimizer optimizer(control);
+   * lessSEM::fitResults fitResults_;
+   * for (double lambda : lambdas)
+   * {
+   *   tp.lambda = lambda;
+   *   optimizer.optimize(model, startingValues, labels, lasso, ridge, tp, fitResults_);
+   *   startingValues = fitResults_.parameterValues;
+   * }
+   */
+  class glmnetOptimizer
+  {
+  public:
+    /**
+     * @brief Construct a new glmnet optimizer
+     *
+     * @param control_ settings for the glmnet optimizer.
+     */
+    glmnetOptimizer(const controlGLMNET &control_ = controlGlmnetDefault()) : control(control_),
+                                                                              selector(control_.coordinateOrder, control_.seed) {}
+
+    /**
+     * @brief change the settings of the optimizer. The memory is kept.
+     *
+     * @param control_ settings for the glmnet optimizer.
+     */
+    void setControl(const controlGLMNET &control_)
+    {
+      control = control_;
+    }
 
-    // prepare fit elements
-    // fit of the smooth part of the fit function
-    double fit_k = model_.fit(parameters_k,
-                              parameterLabels) +
-                   smoothPenalty_.getValue(parameters_k,
-                                           parameterLabels,
-                                           tuningParameters);
-    double fit_kMinus1 = model_.fit(parameters_kMinus1,
-                                    parameterLabels) +
-                         smoothPenalty_.getValue(parameters_kMinus1,
-                                                 parameterLabels,
-                                                 tuningParameters);
-    // add non-differentiable part
-    double penalizedFit_k = fit_k +
-                            penalty_.getValue(parameters_k,
-                                              parameterLabels,
-                                              tuningParameters);
-
-    double penalizedFit_kMinus1 = fit_kMinus1 +
-                                  penalty_.getValue(parameters_kMinus1,
-                                                    parameterLabels,
-                                                    tuningParameters);
-
-    // the following vector will save the fits of all iterations:
-    arma::rowvec fits(control_.maxIterOut + 1);
-    fits.fill(NA_REAL);
-    fits(0) = penalizedFit_kMinus1;
-
-    // prepare gradient elements
-    // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
-    // of the model and the smooth penalty function (e.g., ridge)
-    arma::rowvec gradients_k = model_.gradients(parameters_k,
-                                                parameterLabels) +
-                               smoothPenalty_.getGradients(parameters_k,
-                                                           parameterLabels,
-                                                           tuningParameters); // ridge part
-    arma::rowvec gradients_kMinus1 = model_.gradients(parameters_kMinus1,
-                                                      parameterLabels) +
-                                     smoothPenalty_.getGradients(parameters_kMinus1,
-                                                                 parameterLabels,
-                                                                 tuningParameters); // ridge part
-
-    // prepare Hessian elements
-    arma::mat Hessian_k(startingValues.n_elem, startingValues.n_elem, arma::fill::zeros),
-        Hessian_kMinus1(startingValues.n_elem, startingValues.n_elem, arma::fill::zeros);
-    if ((control_.initialHessian.n_cols == 1) && (control_.initialHessian.n_rows == 1))
+    /**
+     * @brief returns the settings of the optimizer
+     *
+     * @return const controlGLMNET&
+     */
+    const controlGLMNET &getControl() const
     {
-      // Hessian comes from default initializer and has to be redefined
-      double hessianValue = control_.initialHessian(0, 0);
-      Hessian_k.diag().fill(hessianValue);
-      Hessian_kMinus1.diag().fill(hessianValue);
+      return (control);
     }
-    else
+
+    /**
+     * @brief By default, the copies of the model used by the speculative line search (see
+     * controlGLMNET.speculativeTrials) are created at the beginning of each optimization. If reuse is
+     * true, the copies are reused in all following optimizations of the same model object. The model
+     * must then not change between two optimizations (e.g., new data) unless invalidateModelCopies is called.
+     *
+     * @param reuse reuse the copies of the model across optimizations
+     */
+    void setReuseModelCopies(const bool reuse)
     {
-      Hessian_k = control_.initialHessian;
-      Hessian_kMinus1 = control_.initialHessian;
+      reuseModelCopies = reuse;
     }
 
-    // breaking flags
-    bool breakOuter = false; // if true, the outer iteration is exited
+    /**
+     * @brief removes the copies of the model used by the speculative line search. The next
+     * optimization creates new copies.
+     */
+    void invalidateModelCopies()
+    {
+      if (speculativeEvaluator_)
+        speculativeEvaluator_->invalidate();
+    }
 
-    // outer iteration
-    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    /**
+     * @brief Optimize a model using the glmnet procedure. See glmnet for details on the arguments.
+     *
+     * @param fitResults_ will be overwritten with the fit results. Passing the same object in each
+     * call avoids allocating memory for the results.
+     */
+    template <typename nonsmoothPenalty, typename smoothPenalty,
+              typename tuning>
+    void optimize(model &model_,
+                  const arma::rowvec &startingValues,
+                  const stringVector &parameterLabels,
+                  nonsmoothPenalty &penalty_,
+                  smoothPenalty &smoothPenalty_,
+                  const tuning &tuningParameters,
+                  fitResults &fitResults_)
     {
+      LESSTIMATE_PROFILE_SCOPE("glmnet::optimize");
+      const controlGLMNET &control_ = control;
+
+      // problems are counted and summarized once at the end of the fit (see diagnostics.h)
+      diagnostics diagnostics_(control_.verbose != 0);
+      diagnosticsScope diagnosticsScope_(&diagnostics_);
+
+      if (control_.progress != nullptr)
+        control_.progress->startFit();
+
+      if (control_.verbose != 0)
+      {
+        print << "Optimizing with glmnet.\n";
+      }
+
+      // the models only receive a handle to the labels; this avoids copying them
+      const labelHandle labels(parameterLabels);
 
-      // check if user wants to stop the computation:
+      // the coordinate selector starts from the same state in each optimization
+      selector.reset(control_.coordinateOrder, control_.seed);
+
+      // simultaneous updates of the coordinates in the inner iterations
+      innerWorkspace.parallelUpdates = std::max(control_.parallelInnerUpdates, 1u);
+      if (innerWorkspace.parallelUpdates > 1)
+      {
 #if USE_R
-      Rcpp::checkUserInterrupt();
+        const unsigned int nThreads = 1;
+#else
+        const unsigned int nThreads = std::min(innerWorkspace.parallelUpdates,
+                                               std::max(std::thread::hardware_concurrency(), 1u));
 #endif
+        if (!innerWorkspace.pool || (innerWorkspace.pool->size() != nThreads))
+          innerWorkspace.pool.reset(new threadPool(nThreads));
+      }
 
-      // the gradients will be used by the inner iteration to compute the new
-      // parameters
-      gradients_kMinus1 = model_.gradients(parameters_kMinus1, parameterLabels) +
-                          smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, tuningParameters); // ridge part
+      // step size accepted in the previous outer iteration
+      double stepSize_k = 1.0;
 
-      // find step direction
-      direction = glmnetInner(parameters_kMinus1,
-                              gradients_kMinus1,
-                              Hessian_kMinus1,
-                              penalty_,
-                              tuningParameters,
-                              control_.maxIterIn,
-                              control_.breakInner,
-                              control_.verbose);
-
-      // find length of step in direction
-      parameters_k = glmnetLineSearch(model_,
-                                      penalty_,
-                                      smoothPenalty_,
-                                      parameters_kMinus1,
-                                      parameterLabels,
-                                      direction,
-                                      fit_kMinus1,
-                                      gradients_kMinus1,
-                                      Hessian_kMinus1,
-
-                                      tuningParameters,
-
-                                      control_.stepSize,
-                                      control_.sigma,
-                                      control_.gamma,
-                                      control_.maxIterLine,
-                                      control_.verbose);
-
-      // get gradients of differentiable part
-      gradients_k = model_.gradients(parameters_k,
-                                     parameterLabels) +
-                    smoothPenalty_.getGradients(parameters_k,
-                                                parameterLabels,
-                                                tuningParameters);
-      // fit of the smooth part of the fit function
-      fit_k = model_.fit(parameters_k,
-                         parameterLabels) +
-              smoothPenalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
-      // add non-differentiable part
-      penalizedFit_k = fit_k +
-                       penalty_.getValue(parameters_k,
-                                         parameterLabels,
-                                         tuningParameters);
+      // speculative evaluation of the backtracking step sizes
+      speculativeEvaluator *speculative = nullptr;
+      if ((control_.speculativeTrials > 1) && (control_.lineSearch == backtracking))
+      {
+        if (!speculativeEvaluator_ || (speculativeEvaluator_->size() != control_.speculativeTrials))
+          speculativeEvaluator_.reset(new speculativeEvaluator(control_.speculativeTrials));
+        if (speculativeEvaluator_->prepare(model_, reuseModelCopies))
+          speculative = speculativeEvaluator_.get();
+      }
 
-      fits(outer_iteration + 1) = penalizedFit_k;
+      // prepare parameter vectors
+      parameters_k = startingValues;
+      parameters_kMinus1 = startingValues;
+      direction.zeros(startingValues.n_elem);
 
-      // print fit info
-      if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
+      // prepare fit elements
+      // fit of the smooth part of the fit function
+      double fit_kMinus1 = LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_kMinus1,
+                                                                                labels)) +
+                           smoothPenalty_.getValue(parameters_kMinus1,
+                                                   parameterLabels,
+                                                   tuningParameters);
+      double fit_k = fit_kMinus1;
+      // add non-differentiable part
+      double penalizedFit_kMinus1 = fit_kMinus1 +
+                                    penalty_.getValue(parameters_kMinus1,
+                                                      parameterLabels,
+                                                      tuningParameters);
+      double penalizedFit_k = penalizedFit_kMinus1;
+
+      // the following vector will save the fits of all iterations:
+      fits.set_size(control_.maxIterOut + 1);
+      fits.fill(NA_REAL);
+      fits(0) = penalizedFit_kMinus1;
+
+      // prepare gradient elements
+      // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
+      // of the model and the smooth penalty function (e.g., ridge)
+      gradients_kMinus1 = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_kMinus1,
+                                                                                           labels)) +
+                          smoothPenalty_.getGradients(parameters_kMinus1,
+                                                      parameterLabels,
+                                                      tuningParameters); // ridge part
+      gradients_k = gradients_kMinus1;
+
+      // prepare Hessian elements
+      const bool scaleHessian = (control_.initialHessian.n_elem == 1) &&
+                                (control_.hessianScaling != noHessianScaling);
+      if ((control_.initialHessian.n_cols == 1) && (control_.initialHessian.n_rows == 1))
+      {
+        // Hessian comes from default initializer and has to be redefined
+        Hessian_kMinus1.zeros(startingValues.n_elem, startingValues.n_elem);
+        Hessian_kMinus1.diag().fill(control_.initialHessian(0, 0));
+      }
+      else
       {
-        print << "Fit in iteration outer_iteration "
-              << outer_iteration + 1
-              << ": "
-              << penalizedFit_k
-              << "\n"
-              << parameters_k
-              << "\n";
+        Hessian_kMinus1 = control_.initialHessian;
       }
+      Hessian_k = Hessian_kMinus1;
+
+      // the kkt criterion is relative to the residual at the starting values
+      double kktTolerance = 0.0;
+      if (control_.convergenceCriterion == convergenceCriteriaGlmnet::kkt)
+        kktTolerance = control_.breakKKTAbsolute +
+                       control_.breakKKTRelative * glmnetKKTResidual(penalty_,
+                                                                     parameters_kMinus1,
+                                                                     gradients_kMinus1,
+                                                                     Hessian_kMinus1,
+                                                                     tuningParameters,
+                                                                     zeroDirection);
+
+      // the duality gap requires the weights of the lasso and ridge penalties
+      double dualityGap_k = arma::datum::nan;
+      double unpenalizedResidual = 0.0;
+      if (control_.convergenceCriterion == dualityGap)
+      {
+        if (!l1PenaltyWeights(penalty_, tuningParameters, startingValues.n_elem, l1Weights) ||
+            !l2PenaltyWeights(smoothPenalty_, tuningParameters, startingValues.n_elem, l2Weights))
+          error("The dualityGap convergence criterion is only available for lasso and elastic net penalties.");
+      }
+
+      // breaking flags
+      bool breakOuter = false; // if true, the outer iteration is exited
 
-      // Approximate Hessian using BFGS
-      Hessian_k = lessSEM::BFGS(
-          parameters_kMinus1,
-          gradients_kMinus1,
-          Hessian_kMinus1,
-          parameters_k,
-          gradients_k,
-          true,
-          .001,
-          control_.verbose == -99);
-
-      // check convergence
-      if (control_.convergenceCriterion == GLMNET)
+      // outer iteration
+      for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
       {
-        arma::mat HessDiag = arma::eye(Hessian_k.n_rows,
-                                       Hessian_k.n_cols);
-        HessDiag.fill(0.0);
-        HessDiag.diag() = Hessian_k.diag();
-        try
+        LESSTIMATE_PROFILE_SCOPE("glmnet::outerIteration");
+
+        // check if user wants to stop the computation:
+#if USE_R
+        Rcpp::checkUserInterrupt();
+#endif
+
+        // find step direction
+        glmnetInner(parameters_kMinus1,
+                    gradients_kMinus1,
+                    Hessian_kMinus1,
+                    penalty_,
+                    tuningParameters,
+                    control_.maxIterIn,
+                    control_.breakInner,
+                    control_.verbose,
+                    selector,
+                    innerWorkspace,
+                    direction);
+
+        // find length of step in direction
+        glmnetLineSearch(model_,
+                         penalty_,
+                         smoothPenalty_,
+                         parameters_kMinus1,
+                         parameterLabels,
+                         direction,
+                         fit_kMinus1,
+                         gradients_kMinus1,
+                         Hessian_kMinus1,
+
+                         tuningParameters,
+
+                         control_.stepSize,
+                         control_.sigma,
+                         control_.gamma,
+                         control_.maxIterLine,
+                         control_.verbose,
+                         control_.lineSearch,
+                         stepSize_k,
+                         parameters_k,
+                         speculative);
+
+        // get gradients of differentiable part
+        gradients_k = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                       labels)) +
+                      smoothPenalty_.getGradients(parameters_k,
+                                                  parameterLabels,
+                                                  tuningParameters);
+        // fit of the smooth part of the fit function
+        fit_k = LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k,
+                                                                     labels)) +
+                smoothPenalty_.getValue(parameters_k,
+                                        parameterLabels,
+                                        tuningParameters);
+        // add non-differentiable part
+        penalizedFit_k = fit_k +
+                         penalty_.getValue(parameters_k,
+                                           parameterLabels,
+                                           tuningParameters);
+
+        fits(outer_iteration + 1) = penalizedFit_k;
+
+        // print fit info
+        if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
         {
-          breakOuter = max(HessDiag * arma::pow(arma::trans(direction), 2)) < control_.breakOuter;
+          print << "Fit in iteration outer_iteration "
+                << outer_iteration + 1
+                << ": "
+                << penalizedFit_k
+                << "\n"
+                << parameters_k
+                << "\n";
         }
-        catch (...)
+
+        // The initial Hessian is typically badly scaled; after the first
+        // step, the curvature information in the gradients is used to rescale it.
+        if (scaleHessian && (outer_iteration == 0))
+          scaleInitialHessian(control_.hessianScaling,
+                              parameters_kMinus1,
+                              gradients_kMinus1,
+                              parameters_k,
+                              gradients_k,
+                              Hessian_kMinus1);
+
+        // Approximate Hessian using BFGS
+        updateBFGS(
+            parameters_kMinus1,
+            gradients_kMinus1,
+            Hessian_kMinus1,
+            parameters_k,
+            gradients_k,
+            true,
+            .001,
+            control_.verbose == -99,
+            Hessian_k,
+            HessianTimesD);
+
+        // check convergence
+        if (control_.convergenceCriterion == GLMNET)
         {
-          error("Error while computing convergence criterion");
+          breakOuter = maxDiagonalDecrease(Hessian_k, direction) < control_.breakOuter;
         }
-      }
-      if (control_.convergenceCriterion == fitChange)
-      {
-        try
+        if (control_.convergenceCriterion == fitChange)
         {
-          breakOuter = std::abs(fits(outer_iteration + 1) -
-                                fits(outer_iteration)) <
-                       control_.breakOuter;
+          try
+          {
+            breakOuter = std::abs(fits(outer_iteration + 1) -
+                                  fits(outer_iteration)) <
+                         control_.breakOuter;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-        catch (...)
+        if (control_.convergenceCriterion == gradients)
         {
-          error("Error while computing convergence criterion");
+          try
+          {
+            arma::rowvec subGradients = penalty_.getSubgradients(
+                parameters_k,
+                gradients_k,
+                tuningParameters);
+
+            // check if all gradients are below the convergence criterion:
+            breakOuter = arma::sum(arma::abs(subGradients) < control_.breakOuter) ==
+                         subGradients.n_elem;
+          }
+          catch (...)
+          {
+            error("Error while computing convergence criterion");
+          }
         }
-      }
-      if (control_.convergenceCriterion == gradients)
-      {
-        try
+        if (control_.convergenceCriterion == convergenceCriteriaGlmnet::kkt)
         {
-          arma::rowvec subGradients = penalty_.getSubgradients(
-              parameters_k,
-              gradients_k,
-              tuningParameters);
+          breakOuter = glmnetKKTResidual(penalty_,
+                                         parameters_k,
+                                         gradients_k,
+                                         Hessian_k,
+                                         tuningParameters,
+                                         zeroDirection) <= kktTolerance;
+        }
+        if (control_.convergenceCriterion == dualityGap)
+        {
+          dualityGap_k = computeDualityGap(model_,
+                                           parameters_k,
+                                           fit_k,
+                                           gradients_k,
+                                           l1Weights,
+                                           l2Weights,
+                                           1.0,
+                                           unpenalizedResidual);
+          if (!arma::is_finite(dualityGap_k))
+            error("The dualityGap convergence criterion requires a model implementing dualFit.");
+          breakOuter = (dualityGap_k < control_.breakOuter) &&
+                       (unpenalizedResidual < control_.breakOuter);
+        }
 
-          // check if all gradients are below the convergence criterion:
-          breakOuter = arma::sum(arma::abs(subGradients) < control_.breakOuter) ==
-                       subGradients.n_elem;
+        // report the progress; stops if the fit was cancelled
+        if (control_.progress != nullptr)
+        {
+          control_.progress->report(outer_iteration + 1, penalizedFit_k, parameters_k);
+          if (control_.progress->cancelled())
+            break;
         }
-        catch (...)
+
+        if (breakOuter)
         {
-          error("Error while computing convergence criterion");
+          break;
         }
-      }
 
-      if (breakOuter)
+        // for next iteration: save current values as previous values.
+        // The assignments copy into the existing memory.
+        fit_kMinus1 = fit_k;
+        penalizedFit_kMinus1 = penalizedFit_k;
+        parameters_kMinus1 = parameters_k;
+        gradients_kMinus1 = gradients_k;
+        Hessian_kMinus1 = Hessian_k;
+
+      } // end outer iteration
+
+      // fits cancelled by the user are not reported as convergence failures
+      if (!breakOuter && !((control_.progress != nullptr) && control_.progress->cancelled()))
       {
-        break;
+        reportDiagnostic(outerIterationsNotConverged);
       }
 
-      // for next iteration: save current values as previous values
-      fit_kMinus1 = fit_k;
-      penalizedFit_kMinus1 = penalizedFit_k;
-      parameters_kMinus1 = parameters_k;
-      gradients_kMinus1 = gradients_k;
-      Hessian_kMinus1 = Hessian_k;
-
-    } // end outer iteration
+      fitResults_.convergence = breakOuter;
+      fitResults_.fit = penalizedFit_k;
+      fitResults_.fits = fits;
+      fitResults_.parameterValues = parameters_k;
+      fitResults_.Hessian = Hessian_k;
+      fitResults_.dualityGap = dualityGap_k;
+      fitResults_.warningCounts = diagnostics_.getCounts();
+      diagnostics_.summarize();
+
+      if (control_.progress != nullptr)
+        control_.progress->finishFit();
+    }
 
-    if (!breakOuter)
+    /**
+     * @brief Optimize a model using the glmnet procedure. See glmnet for details on the arguments.
+     *
+     * @return fit result
+     */
+    template <typename nonsmoothPenalty, typename smoothPenalty,
+              typename tuning>
+    fitResults optimize(model &model_,
+                        const arma::rowvec &startingValues,
+                        const stringVector &parameterLabels,
+                        nonsmoothPenalty &penalty_,
+                        smoothPenalty &smoothPenalty_,
+                        const tuning &tuningParameters)
     {
-      warn("Outer iterations did not converge");
+      fitResults fitResults_;
+      optimize(model_,
+               startingValues,
+               parameterLabels,
+               penalty_,
+               smoothPenalty_,
+               tuningParameters,
+               fitResults_);
+      return (fitResults_);
     }
 
-    fitResults fitResults_;
-
-    fitResults_.convergence = breakOuter;
-    fitResults_.fit = penalizedFit_k;
-    fitResults_.fits = fits;
-    fitResults_.parameterValues = parameters_k;
-    fitResults_.Hessian = Hessian_k;
+  private:
+    controlGLMNET control;
+    coordinateSelector selector;
+    glmnetInnerWorkspace innerWorkspace;
+    arma::rowvec parameters_k, parameters_kMinus1;
+    arma::rowvec direction;
+    arma::rowvec gradients_k, gradients_kMinus1;
+    arma::mat Hessian_k, Hessian_kMinus1;
+    arma::colvec HessianTimesD;
+    arma::rowvec zeroDirection;
+    arma::rowvec l1Weights, l2Weights;
+    arma::rowvec fits;
+    std::unique_ptr<speculativeEvaluator> speculativeEvaluator_;
+    bool reuseModelCopies = false;
+  };
 
-    return (fitResults_);
+  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
+  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
+  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
+  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
+  // second function call can be easier when coming from R.
 
+  /**
+   * @brief Optimize a model using the glmnet procedure.
+   *
+   * @tparam nonsmoothPenalty class of type nonsmoothPenalty (e.g., lasso, scad, lsp)
+   * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
+   * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
+   * @param model_ the model object derived from the model class in model.h
+   * @param startingValues an arma::rowvec numeric vector with starting values
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty_ a penalty derived from the penalty class in penalty.h
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningParameters tuning parameters for the penalty functions. Note that both penalty functions must
+   * take the same tuning parameters.
+   * @param control_ settings for the glmnet optimizer.
+   * @return fit result
+   */
+  template <typename nonsmoothPenalty, typename smoothPenalty,
+            typename tuning>
+  inline lessSEM::fitResults glmnet(model &model_,
+                                    const arma::rowvec &startingValues,
+                                    const stringVector &parameterLabels,
+                                    nonsmoothPenalty &penalty_,
+                                    smoothPenalty &smoothPenalty_,
+                                    const tuning &tuningParameters,
+                                    const controlGLMNET &control_ = controlGlmnetDefault())
+  {
+    glmnetOptimizer optimizer(control_);
+    return (optimizer.optimize(model_,
+                               startingValues,
+                               parameterLabels,
+                               penalty_,
+                               smoothPenalty_,
+                               tuningParameters));
   } // end glmnet
 
   /**
@@ -630,8 +1286,7 @@ namespace lessSEM
    * @tparam smoothPenalty class of type smooth penalty (e.g., ridge)
    * @tparam tuning tuning parameters used by both, the nonsmootPenalty and the smoothPenalty
    * @param model_ the model object derived from the model class in model.h
-   * @param startingValues an arma::rowvec vector with starting values
-   * @param parameterLabels a stringVector with parameter labels
+   * @param startingValuesRcpp numericVector with starting values. The names are used as parameter labels
    * @param penalty_ a penalty derived from the penalty class in penalty.h
    * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
    * @param tuningParameters tuning parameters for the penalty functions. Note that both penalty functions must
@@ -642,19 +1297,17 @@ namespace lessSEM
   template <typename nonsmoothPenalty, typename smoothPenalty,
             typename tuning>
   inline lessSEM::fitResults glmnet(model &model_,
-                                    arma::rowvec startingValues,
-                                    stringVector parameterLabels,
+                                    numericVector startingValuesRcpp,
                                     nonsmoothPenalty &penalty_,
                                     smoothPenalty &smoothPenalty_,
                                     const tuning &tuningParameters,
                                     const controlGLMNET &control_ = controlGlmnetDefault())
   {
-    numericVector startingValuesNumVec = toNumericVector(startingValues);
-    startingValuesNumVec.names() = parameterLabels;
 
     return (
         glmnet(model_,
-               startingValuesNumVec,
+               toArmaVectorView(startingValuesRcpp),
+               startingValuesRcpp.names(),
                penalty_,
                smoothPenalty_,
                tuningParameters,
@@ -31,7 +31,7 @@ namespace lessSEM
          * @return double
          */
         double getValue(const arma::rowvec &parameterValues,
-                        const stringVector &parameterLabels,
+                        const labelHandle parameterLabels,
                         const tuningParametersEnetGlmnet &tuningParameters)
             override
         {
@@ -70,17 +70,38 @@ namespace lessSEM
             const arma::mat &Hessian,
             const tuningParametersEnetGlmnet &tuningParameters)
         {
+            return (getZ(whichPar,
+                         parameters_kMinus1,
+                         gradient,
+                         stepDirection,
+                         Hessian,
+                         tuningParameters.alpha.at(whichPar) *
+                             tuningParameters.lambda.at(whichPar) *
+                             tuningParameters.weights.at(whichPar)));
+        }
 
-            double tuning = tuningParameters.alpha.at(whichPar) *
-                            tuningParameters.lambda.at(whichPar) *
-                            tuningParameters.weights.at(whichPar);
-
+        /**
+         * @brief computes the step direction for a single parameter j given the tuning parameter
+         * of this parameter. The state of the penalty is not changed; the function can therefore be
+         * called for different parameters at the same time (e.g., by the mixed penalty or the parallel
+         * inner iterations of glmnet).
+         *
+         * @param tuning alpha * lambda * weight of parameter j
+         */
+        double getZ(
+            unsigned int whichPar,
+            const arma::rowvec &parameters_kMinus1,
+            const arma::rowvec &gradient,
+            const arma::rowvec &stepDirection,
+            const arma::mat &Hessian,
+            const double tuning)
+        {
             double parameterValue_j = arma::as_scalar(parameters_kMinus1.col(whichPar));
 
             // compute derivative elements:
             double d_j = arma::as_scalar(stepDirection.col(whichPar));
-            arma::colvec hessianXdirection = Hessian * arma::trans(stepDirection);
-            double hessianXdirection_j = arma::as_scalar(hessianXdirection.row(whichPar));
+            // only element j of Hessian * direction is required
+            double hessianXdirection_j = arma::dot(Hessian.row(whichPar), stepDirection);
             double H_jj = arma::as_scalar(Hessian.row(whichPar).col(whichPar));
             double g_j = arma::as_scalar(gradient.col(whichPar));
 
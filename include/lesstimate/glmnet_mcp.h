@@ -3,6 +3,7 @@
 #include "common_headers.h"
 
 #include "penalty.h"
+#include "diagnostics.h"
 
 // IMPORTANT: MCP for glmnet is currently not very stable. We recommend
 // using ista instead!
@@ -49,7 +50,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMcpGlmnet &tuningParameters)
         override
     {
@@ -149,20 +150,48 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMcpGlmnet &tuningParameters)
     {
+      return (getZ(whichPar,
+                   parameters_kMinus1,
+                   gradient,
+                   stepDirection,
+                   Hessian,
+                   tuningParameters.weights.at(whichPar),
+                   tuningParameters.lambda,
+                   tuningParameters.theta));
+    }
 
-      double lambda = tuningParameters.weights.at(whichPar) * tuningParameters.lambda;
-      double theta = tuningParameters.theta;
+    /**
+     * @brief computes the step direction for a single parameter j given the tuning parameters
+     * of this parameter. The state of the penalty is not changed; the function can therefore be
+     * called for different parameters at the same time (e.g., by the mixed penalty or the parallel
+     * inner iterations of glmnet).
+     *
+     * @param weight weight of parameter j
+     * @param lambda_ tuning parameter lambda (not yet multiplied with the weight)
+     * @param theta tuning parameter theta
+     */
+    double getZ(
+        unsigned int whichPar,
+        const arma::rowvec &parameters_kMinus1,
+        const arma::rowvec &gradient,
+        const arma::rowvec &stepDirection,
+        const arma::mat &Hessian,
+        const double weight,
+        const double lambda_,
+        const double theta)
+    {
+      double lambda = weight * lambda_;
 
       double parameterValue_j = arma::as_scalar(parameters_kMinus1.col(whichPar));
 
       // compute derivative elements:
       double d_j = arma::as_scalar(stepDirection.col(whichPar));
-      arma::colvec hessianXdirection = Hessian * arma::trans(stepDirection);
-      double hessianXdirection_j = arma::as_scalar(hessianXdirection.row(whichPar));
+      // only element j of Hessian * direction is required
+      double hessianXdirection_j = arma::dot(Hessian.row(whichPar), stepDirection);
       double H_jj = arma::as_scalar(Hessian.row(whichPar).col(whichPar));
       double g_j = arma::as_scalar(gradient.col(whichPar));
 
-      if (tuningParameters.weights.at(whichPar) == 0)
+      if (weight == 0)
       {
         // No regularization
         return (-(g_j + hessianXdirection_j) / H_jj);
@@ -177,7 +206,7 @@ namespace lessSEM
 
       if (H_jj - (1 / theta) <= 0)
       {
-        warn("One of the subproblems is not positive definite. Using a small hack... This may work or may fail. We recommend using method = 'ista' for mcp.");
+        reportDiagnostic(mcpNotPositiveDefinite);
         // We will make the function positive definite by replacing the Hessian approximation. This seems to work in practice...
         H_jj += (1 / theta) + .001;
       }
@@ -48,7 +48,7 @@ namespace lessSEM
      * @return double
      */
     virtual double getValue(const arma::rowvec &parameterValues,
-                            const stringVector &parameterLabels,
+                            const labelHandle parameterLabels,
                             const tuningParametersMixedGlmnet &tuningParameters) = 0;
     
     /**
@@ -113,7 +113,7 @@ namespace lessSEM
   class penaltyMixedGlmnetNone: public penaltyMixedGlmnetBase{
     
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters) override {
                       return(0.0);
                     }
@@ -126,8 +126,8 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMixedGlmnet &tuningParameters) override{
           
-          arma::colvec hessianXdirection = Hessian * arma::trans(stepDirection);
-          double hessianXdirection_j = arma::as_scalar(hessianXdirection.row(whichPar));
+          // only element j of Hessian * direction is required
+          double hessianXdirection_j = arma::dot(Hessian.row(whichPar), stepDirection);
           double H_jj = arma::as_scalar(Hessian.row(whichPar).col(whichPar));
           double g_j = arma::as_scalar(gradient.col(whichPar));
           
@@ -142,7 +142,7 @@ namespace lessSEM
     tuningParametersCappedL1Glmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters) override {
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
@@ -158,16 +158,16 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMixedGlmnet &tuningParameters) override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
-          
+          // the tuning parameters are passed as scalars; this avoids copying the
+          // weights and does not change the state of the penalty
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
                           gradient,
                           stepDirection,
                           Hessian,
-                          tp));
+                          tuningParameters.weights.at(whichPar),
+                          tuningParameters.lambda.at(whichPar),
+                          tuningParameters.theta.at(whichPar)));
         }
   };
   
@@ -176,7 +176,7 @@ namespace lessSEM
     tuningParametersEnetGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters) override {
                       tp.alpha = tuningParameters.alpha(0);
                       tp.lambda = tuningParameters.lambda(0);
@@ -192,16 +192,16 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMixedGlmnet &tuningParameters) override{
           
-          tp.alpha = tuningParameters.alpha;
-          tp.lambda = tuningParameters.lambda;
-          tp.weights = tuningParameters.weights;
-          
+          // the tuning parameters are passed as scalars; this avoids copying the
+          // tuning parameter vectors and does not change the state of the penalty
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
                           gradient,
                           stepDirection,
                           Hessian,
-                          tp));
+                          tuningParameters.alpha.at(whichPar) *
+                            tuningParameters.lambda.at(whichPar) *
+                            tuningParameters.weights.at(whichPar)));
         }
   };
   
@@ -210,7 +210,7 @@ namespace lessSEM
     tuningParametersLspGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters) override {
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
@@ -226,16 +226,16 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMixedGlmnet &tuningParameters) override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
-          
+          // the tuning parameters are passed as scalars; this avoids copying the
+          // weights and does not change the state of the penalty
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
                           gradient,
                           stepDirection,
                           Hessian,
-                          tp));
+                          tuningParameters.weights.at(whichPar),
+                          tuningParameters.lambda.at(whichPar),
+                          tuningParameters.theta.at(whichPar)));
         }
   };
   
@@ -244,7 +244,7 @@ namespace lessSEM
     tuningParametersMcpGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters) override {
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
@@ -260,16 +260,16 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMixedGlmnet &tuningParameters) override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
-          
+          // the tuning parameters are passed as scalars; this avoids copying the
+          // weights and does not change the state of the penalty
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
                           gradient,
                           stepDirection,
                           Hessian,
-                          tp));
+                          tuningParameters.weights.at(whichPar),
+                          tuningParameters.lambda.at(whichPar),
+                          tuningParameters.theta.at(whichPar)));
         }
   };
   
@@ -278,7 +278,7 @@ namespace lessSEM
     tuningParametersScadGlmnet tp;
     
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters) override {
                       tp.lambda = tuningParameters.lambda(0);
                       tp.theta = tuningParameters.theta(0);
@@ -294,16 +294,16 @@ namespace lessSEM
         const arma::mat &Hessian,
         const tuningParametersMixedGlmnet &tuningParameters) override{
           
-          tp.lambda = tuningParameters.lambda(whichPar);
-          tp.theta = tuningParameters.theta(whichPar);
-          tp.weights = tuningParameters.weights;
-          
+          // the tuning parameters are passed as scalars; this avoids copying the
+          // weights and does not change the state of the penalty
           return(pen.getZ(whichPar,
                           parameters_kMinus1,
                           gradient,
                           stepDirection,
                           Hessian,
-                          tp));
+                          tuningParameters.weights.at(whichPar),
+                          tuningParameters.lambda.at(whichPar),
+                          tuningParameters.theta.at(whichPar)));
         }
   };
   
@@ -321,7 +321,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersMixedGlmnet &tuningParameters)
     override
     {
@@ -333,11 +333,9 @@ namespace lessSEM
         tpSinglePenalty.theta = tuningParameters.theta(it);
         tpSinglePenalty.weights = tuningParameters.weights(it);
         
-        arma::rowvec parameterValue(1);
         parameterValue(0) = parameterValues(it);
-        stringVector parameterLabel(1);
-        parameterLabel.at(0) = parameterLabels.at(it);
         
+        // none of the penalties uses the labels; we therefore do not copy them
         penVal += pen->getValue(parameterValue,
                                 parameterLabel,
                                 tpSinglePenalty);
@@ -368,17 +366,14 @@ namespace lessSEM
         const tuningParametersMixedGlmnet &tuningParameters)
     {
       
-      tpSinglePenalty.alpha = tuningParameters.alpha;
-      tpSinglePenalty.lambda = tuningParameters.lambda;
-      tpSinglePenalty.theta = tuningParameters.theta;
-      tpSinglePenalty.weights = tuningParameters.weights;
-      
+      // the penalties index the tuning parameters with whichPar; we can therefore
+      // pass them on without copying
       double z = penalties.at(whichPar)->getZ(whichPar,
                                       parameters_kMinus1,
                                       gradient,
                                       stepDirection,
                                       Hessian,
-                                      tpSinglePenalty);
+                                      tuningParameters);
         
       return(z);
       
@@ -403,6 +398,9 @@ namespace lessSEM
     // we often need the tuning parameters for a single parameter. These are
     // stored here:
     tuningParametersMixedGlmnet tpSinglePenalty;
+    // value and (empty) label of a single parameter
+    arma::rowvec parameterValue = arma::rowvec(1);
+    stringVector parameterLabel = stringVector(1);
     
   };
   
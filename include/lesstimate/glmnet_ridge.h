@@ -33,7 +33,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersEnetGlmnet &tuningParameters) override
     {
       // if ridge is not used:
@@ -66,7 +66,7 @@ namespace lessSEM
      * @return arma::rowvec
      */
     arma::rowvec getGradients(const arma::rowvec &parameterValues,
-                              const stringVector &parameterLabels,
+                              const labelHandle parameterLabels,
                               const tuningParametersEnetGlmnet &tuningParameters) override
     {
 
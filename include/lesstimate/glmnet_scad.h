@@ -48,7 +48,7 @@ namespace lessSEM
          * @return double
          */
         double getValue(const arma::rowvec &parameterValues,
-                        const stringVector &parameterLabels,
+                        const labelHandle parameterLabels,
                         const tuningParametersScadGlmnet &tuningParameters)
             override
         {
@@ -158,19 +158,48 @@ namespace lessSEM
             const arma::mat &Hessian,
             const tuningParametersScadGlmnet &tuningParameters)
         {
-            double lambda = tuningParameters.weights.at(whichPar) * tuningParameters.lambda;
-            double theta = tuningParameters.theta;
+            return (getZ(whichPar,
+                         parameters_kMinus1,
+                         gradient,
+                         stepDirection,
+                         Hessian,
+                         tuningParameters.weights.at(whichPar),
+                         tuningParameters.lambda,
+                         tuningParameters.theta));
+        }
+
+        /**
+         * @brief computes the step direction for a single parameter j given the tuning parameters
+         * of this parameter. The state of the penalty is not changed; the function can therefore be
+         * called for different parameters at the same time (e.g., by the mixed penalty or the parallel
+         * inner iterations of glmnet).
+         *
+         * @param weight weight of parameter j
+         * @param lambda_ tuning parameter lambda (not yet multiplied with the weight)
+         * @param theta tuning parameter theta
+         */
+        double getZ(
+            unsigned int whichPar,
+            const arma::rowvec &parameters_kMinus1,
+            const arma::rowvec &gradient,
+            const arma::rowvec &stepDirection,
+            const arma::mat &Hessian,
+            const double weight,
+            const double lambda_,
+            const double theta)
+        {
+            double lambda = weight * lambda_;
 
             double parameterValue_j = arma::as_scalar(parameters_kMinus1.col(whichPar));
 
             // compute derivative elements:
             double d_j = arma::as_scalar(stepDirection.col(whichPar));
-            arma::colvec hessianXdirection = Hessian * arma::trans(stepDirection);
-            double hessianXdirection_j = arma::as_scalar(hessianXdirection.row(whichPar));
+            // only element j of Hessian * direction is required
+            double hessianXdirection_j = arma::dot(Hessian.row(whichPar), stepDirection);
             double H_jj = arma::as_scalar(Hessian.row(whichPar).col(whichPar));
             double g_j = arma::as_scalar(gradient.col(whichPar));
 
-            if (tuningParameters.weights.at(whichPar) == 0)
+            if (weight == 0)
             {
                 // No regularization
                 return (-(g_j + hessianXdirection_j) / H_jj);
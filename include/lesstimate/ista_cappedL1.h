@@ -25,6 +25,50 @@ namespace lessSEM
     double theta; ///> threshold parameter; any parameter above this threshold will only receive the constant penalty lambda_i*theta, all below will get lambda_i*parameterValue_i
   };
 
+  /**
+   * @brief proximal operator of the cappedL1 penalty for a single parameter
+   *
+   * @param u_k parameter value after the gradient step
+   * @param lambda_i parameter-specific lambda (alpha * lambda * weight)
+   * @param theta threshold parameter
+   * @param L step size
+   * @return double updated parameter
+   */
+  inline double cappedL1Proximal(const double u_k,
+                                 const double lambda_i,
+                                 const double theta,
+                                 const double L)
+  {
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+
+    const double abs_u_k = std::abs(u_k);
+
+    const double x_1 = sign * std::max(abs_u_k, theta);
+    const double x_2 = sign * std::min(theta,
+                                       std::max(abs_u_k - lambda_i / L, 0.0));
+    // h_1 and h_2 will always be positive. The minimum is therefore
+    // 0 which is also the value we get if either x_1 or x_2 are
+    // equivalent to the proposed parameter u_k in descend-direction.
+    // This is the case if the absolute value of the
+    // proposed parameter is above the threshold theta -> x_1 = u_k.
+    // => IF |u_k| > THETA, WE ALWAYS SELECT u_k
+    // If the proposed parameter |u_k| is below the threshold theta
+    // x_2 comes into play. x_2 is at minimum equal to theta (upper bound)
+    // and otherwise equal to std::max(abs_u_k - lambda_i/L, 0.0)
+    // which is the proximal operator of the lasso penalty
+    // => IF |u_k| > THETA, WE ALWAYS TAKE THE NORMAL LASSO UPDATE
+    const double h_1 = .5 * std::pow(x_1 - u_k, 2) +
+                       (lambda_i / L) * std::min(std::abs(x_1), theta);
+    const double h_2 = .5 * std::pow(x_2 - u_k, 2) +
+                       (lambda_i / L) * std::min(std::abs(x_2), theta);
+
+    if (h_1 <= h_2)
+      return (x_1);
+    return (x_2);
+  }
+
   /**
    * @brief proximal operator for the cappedL1 penalty function
    *
@@ -45,62 +89,52 @@ namespace lessSEM
      */
     arma::rowvec getParameters(const arma::rowvec &parameterValues,
                                const arma::rowvec &gradientValues,
-                               const stringVector &parameterLabels,
+                               const labelHandle parameterLabels,
                                const double L,
                                const tuningParametersCappedL1 &tuningParameters)
         override
     {
-
-      // step in descending direction with step size (1/L):
-      arma::rowvec u_k = parameterValues - gradientValues / L;
-
       arma::rowvec parameters_kp1(parameterValues.n_elem);
-      parameters_kp1.fill(arma::datum::nan);
+      getParametersInPlace(parameterValues,
+                           gradientValues,
+                           parameterLabels,
+                           L,
+                           tuningParameters,
+                           parameters_kp1);
+      return parameters_kp1;
+    }
 
-      double lambda_i, x_1, x_2, h_1, h_2, abs_u_k;
-      int sign;
+    /**
+     * @brief update the parameter vector in place
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @param parameters_kp1 will be overwritten with the updated parameters. May be the same
+     * object as parameterValues
+     */
+    void getParametersInPlace(const arma::rowvec &parameterValues,
+                              const arma::rowvec &gradientValues,
+                              const labelHandle parameterLabels,
+                              const double L,
+                              const tuningParametersCappedL1 &tuningParameters,
+                              arma::rowvec &parameters_kp1)
+        override
+    {
+      parameters_kp1.set_size(parameterValues.n_elem);
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
-
-        lambda_i = tuningParameters.alpha *
-                   tuningParameters.lambda *
-                   tuningParameters.weights.at(p);
-
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        abs_u_k = std::abs(u_k.at(p));
-
-        x_1 = sign * std::max(abs_u_k, tuningParameters.theta);
-        x_2 = sign * std::min(tuningParameters.theta,
-                              std::max(abs_u_k - lambda_i / L, 0.0));
-        // h_1 and h_2 will always be positive. The minimum is therefore
-        // 0 which is also the value we get if either x_1 or x_2 are
-        // equivalent to the proposed parameter u_k in descend-direction.
-        // This is the case if the absolute value of the
-        // proposed parameter is above the threshold theta -> x_1 = u_k.
-        // => IF |u_k| > THETA, WE ALWAYS SELECT u_k
-        // If the proposed parameter |u_k| is below the threshold theta
-        // x_2 comes into play. x_2 is at minimum equal to theta (upper bound)
-        // and otherwise equal to std::max(abs_u_k - lambda_i/L, 0.0)
-        // which is the proximal operator of the lasso penalty
-        // => IF |u_k| > THETA, WE ALWAYS TAKE THE NORMAL LASSO UPDATE
-        h_1 = .5 * std::pow(x_1 - u_k.at(p), 2) +
-              (lambda_i / L) * std::min(std::abs(x_1), tuningParameters.theta);
-        h_2 = .5 * std::pow(x_2 - u_k.at(p), 2) +
-              (lambda_i / L) * std::min(std::abs(x_2), tuningParameters.theta);
-
-        if (h_1 <= h_2)
-        {
-          parameters_kp1.at(p) = x_1;
-        }
-        else
-        {
-          parameters_kp1.at(p) = x_2;
-        }
+        // step in descending direction with step size (1/L):
+        const double u_k = parameterValues.at(p) - gradientValues.at(p) / L;
+        parameters_kp1.at(p) = cappedL1Proximal(u_k,
+                                                tuningParameters.alpha *
+                                                    tuningParameters.lambda *
+                                                    tuningParameters.weights.at(p),
+                                                tuningParameters.theta,
+                                                L);
       }
-      return parameters_kp1;
     }
   };
 
@@ -131,7 +165,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersCappedL1 &tuningParameters)
         override
     {
@@ -7,6 +7,11 @@
 #include "proximalOperator.h"
 #include "penalty.h"
 #include "smoothPenalty.h"
+#include "duality_gap.h"
+#include "speculative_evaluation.h"
+#include "profiling.h"
+#include "diagnostics.h"
+#include "fit_progress.h"
 
 // The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
 // user supplies a C++ class with methods fit and gradients which is used
@@ -75,6 +80,25 @@ namespace lessSEM
       "barzilaiBorwein",
       "stochasticBarzilaiBorwein"};
 
+  // convCritOuterIsta
+  //
+  // Convergence criteria for the outer iterations of the ista optimizer.
+  // fitChangeCrit: the optimization stops if the change in fit from one
+  // iteration to the next is smaller than breakOuter
+  // dualityGapCrit: the optimization stops if the duality gap, which bounds the
+  // distance of the penalized fit to the optimum, is smaller than breakOuter. Only
+  // available for models implementing dualFit (e.g., the regression models in
+  // sparse_models.h) with lasso or elastic net penalties. Unpenalized parameters
+  // must additionally have gradients smaller than breakOuter. See duality_gap.h.
+  enum convCritOuterIsta
+  {
+    fitChangeCrit,
+    dualityGapCrit
+  };
+  const std::vector<std::string> convCritOuterIsta_txt = {
+      "fitChangeCrit",
+      "dualityGapCrit"};
+
   // control
   //
   // Settings for the ista optimizer.
@@ -97,6 +121,17 @@ namespace lessSEM
   // sampleSize: can be used to scale the fitting function down
   // verbose: if set to a value > 0, the fit every verbose iterations
   // is printed.
+  // seed: seed of the random number generator used by the optimizer (e.g., for
+  // stochasticBarzilaiBorwein)
+  // convCritOuter: convergence criterion of the outer iterations. See convCritOuterIsta
+  // speculativeTrials: number of step sizes of the inner iterations which are evaluated
+  // concurrently on copies of the model (see speculative_evaluation.h). 0 and 1 evaluate
+  // the step sizes sequentially. Requires a model implementing clone(). If the fit only
+  // depends on the parameter values, the results are identical to those of the sequential
+  // search; models with internal state may differ in the last digits. The copies are created
+  // in each optimization (see istaOptimizer::setReuseModelCopies).
+  // progress: if not a nullptr, the optimizer reports its progress after each outer iteration
+  // and stops if the fit is cancelled (see fit_progress.h). The object must outlive the optimization.
   struct control
   {
     double L0;
@@ -110,6 +145,10 @@ namespace lessSEM
     stepSizeInheritance stepSizeIn;
     int sampleSize;
     int verbose;
+    unsigned int seed;
+    convCritOuterIsta convCritOuter;
+    unsigned int speculativeTrials;
+    fitProgress *progress;
   };
   // the name "control" dates back to when there was no glmnet optimizer and is
   // kept for backwards compatability. For consistency, we also define a more
@@ -133,7 +172,11 @@ namespace lessSEM
         .1,                  // sigma
         istaStepInheritance, // stepSizeInheritance
         1,                   // sample size
-        0                    // verbose
+        0,                   // verbose
+        0,                   // seed
+        fitChangeCrit,       // convCritOuter
+        0,                   // speculativeTrials
+        nullptr              // progress
     };
     return (defaultIs);
   }
@@ -143,323 +186,566 @@ namespace lessSEM
     return (controlDefault());
   }
 
-  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
-  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
-  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
-  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
-  // second function call can be easier when coming from R.
-
-  // ista
+  // istaOptimizer
   //
-  // Implements (variants of) the ista optimizer.
+  // ista optimizer which owns all memory used in the optimization. When the same
+  // object is used to optimize a model repeatedly (e.g., for many tuning parameters or
+  // different starting values), the memory allocated in the first optimization is reused.
   //
-  // @param model_ the model object derived from the model class in model.h
-  // @param startingValuesRcpp an Rcpp numeric vector with starting values
-  // @parma proximalOperator_ a proximal operator for the penalty function
-  // @param
-  // @param penalty_ a penalty derived from the penalty class in penalty.h
-  // @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
-  // @param tuningParameters tuning parameters for the penalty function
-  // @parma smoothTuningParameters tuning parameters for the smooth penalty function
-  // @param control_ settings for the ista optimizer.
-  // @return fit result
-  template <typename T, typename U> // T is the type of the tuning parameters
-  inline lessSEM::fitResults ista(
-      model &model_,
-      numericVector startingValuesRcpp,
-      proximalOperator<T> &proximalOperator_, // proximalOperator takes the tuning parameters
-      // as input -> <T>
-      penalty<T> &penalty_,             // penalty takes the tuning parameters
-      smoothPenalty<U> &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
-      // as input -> <U>
-      const T &tuningParameters,       // tuning parameters are of type T
-      const U &smoothTuningParameters, // tuning parameters are of type U
-      const control &control_ = controlDefault())
+  // Example:
+  //
+  // lessSEM::istaOptimizer optimizer(control);
+  // lessSEM::fitResults fitResults_;
+  // for (double lambda : lambdas)
+  // {
+  //   tp.lambda = lambda;
+  //   optimizer.optimize(model, startingValues, labels, proxOp, lasso, ridge, tp, smoothTp, fitResults_);
+  //   startingValues = fitResults_.parameterValues;
+  // }
+  class istaOptimizer
   {
-    if (control_.verbose != 0)
+  public:
+    // @param control_ settings for the ista optimizer.
+    istaOptimizer(const control &control_ = controlDefault()) : settings(control_) {}
+
+    // change the settings of the optimizer. The memory is kept.
+    // @param control_ settings for the ista optimizer.
+    void setControl(const control &control_)
     {
-      print << "Optimizing with ista.\n"
-            << "Using "
-            << convCritInnerIsta_txt.at(control_.convCritInner)
-            << " as inner convergence criterion\n"
-            << "Using "
-            << stepSizeInheritance_txt.at(control_.stepSizeIn)
-            << " as step size inheritance\n"
-            << "Tuning parameters: \n eta = "
-            << control_.eta
-            << "\n"
-            << " accelerate = "
-            << control_.accelerate
-            << "\n"
-            << " sigma = "
-            << control_.sigma
-            << "\n"
-            << " breakOuter = "
-            << control_.breakOuter
-            << std::endl;
+      settings = control_;
     }
-    // separate labels and values
-    const arma::rowvec startingValues = toArmaVector(startingValuesRcpp);
-    const stringVector parameterLabels = startingValuesRcpp.names();
-
-    // prepare parameter vectors
-    arma::rowvec parameters_k = startingValues,
-                 parameters_kMinus1 = startingValues,
-                 parameters_kMinus2 = startingValues,
-                 y_k = startingValues; // required for acceleration
-    // the following elements will be required to judge the breaking condition
-    arma::rowvec parameterChange(startingValues.n_elem);
-    arma::rowvec gradientChange(startingValues.n_elem); // necessary for Barzilai Borwein
-    arma::mat quadr, parchTimeGrad;
-    numericVector randomNumber; // for stochastic Barzilai Borwein
-
-    // prepare fit elements
-    double fit_k = (1.0 / control_.sampleSize) * model_.fit(startingValues, parameterLabels) +
-                   smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters), // ridge penalty part
-        fit_kMinus1 = (1.0 / control_.sampleSize) * model_.fit(startingValues, parameterLabels) +
-                      smoothPenalty_.getValue(parameters_kMinus1, parameterLabels, smoothTuningParameters), // ridge penalty part,
-        penalty_k = 0.0;
-    double penalizedFit_k, penalizedFit_kMinus1;
-    arma::rowvec gradients_k, gradients_kMinus1, gradient_y_k;
 
-    penalizedFit_k = fit_k +
-                     penalty_.getValue(parameters_k, parameterLabels, tuningParameters); // lasso penalty part
-
-    penalizedFit_kMinus1 = fit_kMinus1 +
-                           penalty_.getValue(parameters_kMinus1, parameterLabels, tuningParameters); // lasso penalty part
-
-    // the following vector will save the fits of all iterations:
-    arma::rowvec fits(control_.maxIterOut + 1);
-    fits.fill(arma::datum::nan);
-    fits(0) = penalizedFit_kMinus1;
-
-    // prepare gradient elements
-    // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
-    // of the model and the smooth penalty function (e.g., ridge)
-    gradients_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_k, parameterLabels) +
-                  smoothPenalty_.getGradients(parameters_k, parameterLabels, smoothTuningParameters); // ridge part
-    gradients_kMinus1 = (1.0 / control_.sampleSize) * model_.gradients(parameters_kMinus1, parameterLabels) +
-                        smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, smoothTuningParameters); // ridge part
-    // for acceleration:
-    gradient_y_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_kMinus1, parameterLabels) +
-                   smoothPenalty_.getGradients(parameters_kMinus1, parameterLabels, smoothTuningParameters); // ridge part
-
-    // breaking flags
-    bool breakInner = false, // if true, the inner iteration is exited
-        breakOuter = false;  // if true, the outer iteration is exited
-
-    // initialize step size
-    double L_kMinus1 = control_.L0, L_k = control_.L0;
-
-    // outer iteration
-    for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+    // @return the settings of the optimizer
+    const control &getControl() const
     {
+      return (settings);
+    }
 
-      // check if user wants to stop the computation:
-#if USE_R
-      Rcpp::checkUserInterrupt();
-#endif
+    // By default, the copies of the model used by the speculative step sizes (see
+    // control.speculativeTrials) are created at the beginning of each optimization. If reuse
+    // is true, the copies are reused in all following optimizations of the same model object.
+    // The model must then not change between two optimizations (e.g., new data) unless
+    // invalidateModelCopies is called.
+    // @param reuse reuse the copies of the model across optimizations
+    void setReuseModelCopies(const bool reuse)
+    {
+      reuseModelCopies = reuse;
+    }
+
+    // removes the copies of the model used by the speculative step sizes. The next
+    // optimization creates new copies.
+    void invalidateModelCopies()
+    {
+      if (speculativeEvaluator_)
+        speculativeEvaluator_->invalidate();
+    }
 
-      for (int inner_iteration = 0; inner_iteration < control_.maxIterIn; inner_iteration++)
+    // optimize
+    //
+    // Optimize a model using the ista procedure. See ista for details on the arguments.
+    //
+    // @param fitResults_ will be overwritten with the fit results. Passing the same object in each
+    // call avoids allocating memory for the results.
+    template <typename T, typename U> // T is the type of the tuning parameters
+    void optimize(
+        model &model_,
+        const arma::rowvec &startingValues,
+        const stringVector &parameterLabels,
+        proximalOperator<T> &proximalOperator_, // proximalOperator takes the tuning parameters
+        // as input -> <T>
+        penalty<T> &penalty_,             // penalty takes the tuning parameters
+        smoothPenalty<U> &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
+        // as input -> <U>
+        const T &tuningParameters,       // tuning parameters are of type T
+        const U &smoothTuningParameters, // tuning parameters are of type U
+        fitResults &fitResults_)
+    {
+      LESSTIMATE_PROFILE_SCOPE("ista::optimize");
+      const control &control_ = settings;
+
+      // problems are counted and summarized once at the end of the fit (see diagnostics.h)
+      diagnostics diagnostics_(control_.verbose != 0);
+      diagnosticsScope diagnosticsScope_(&diagnostics_);
+
+      if (control_.progress != nullptr)
+        control_.progress->startFit();
+
+      if (control_.verbose != 0)
       {
-        // inner iteration: reduce step size until the convergence criterion is met
-        L_k = std::pow(control_.eta, inner_iteration) * L_kMinus1;
+        print << "Optimizing with ista.\n"
+              << "Using "
+              << convCritInnerIsta_txt.at(control_.convCritInner)
+              << " as inner convergence criterion\n"
+              << "Using "
+              << stepSizeInheritance_txt.at(control_.stepSizeIn)
+              << " as step size inheritance\n"
+              << "Tuning parameters: \n eta = "
+              << control_.eta
+              << "\n"
+              << " accelerate = "
+              << control_.accelerate
+              << "\n"
+              << " sigma = "
+              << control_.sigma
+              << "\n"
+              << " breakOuter = "
+              << control_.breakOuter
+              << std::endl;
+      }
 
-        if (control_.accelerate)
-        {
-          // with acceleration:
-          // apply proximal operator to get new parameters for given step size
-          // see Parikh, N., & Boyd, S. (2013). Proximal Algorithms. Foundations
-          // and Trends in Optimization, 1(3), 123–231. p. 152
-
-          y_k = parameters_kMinus1 +
-                (inner_iteration / (inner_iteration + 3)) * (parameters_kMinus1 - parameters_kMinus2);
-          gradient_y_k = (1.0 / control_.sampleSize) * model_.gradients(y_k,
-                                                                        parameterLabels) +
-                         smoothPenalty_.getGradients(y_k,
-                                                     parameterLabels,
-                                                     smoothTuningParameters);
-          parameters_k = proximalOperator_.getParameters(
-              y_k,
-              gradient_y_k,
-              parameterLabels,
-              L_k,
-              tuningParameters);
-        }
-        else
-        {
+      // the models only receive a handle to the labels; this avoids copying them
+      const labelHandle labels(parameterLabels);
+
+      // prepare parameter vectors
+      parameters_k = startingValues;
+      parameters_kMinus1 = startingValues;
+      parameters_kMinus2 = startingValues;
+      y_k = startingValues; // required for acceleration
+      // the following elements will be required to judge the breaking condition
+      parameterChange.set_size(startingValues.n_elem);
+      gradientChange.set_size(startingValues.n_elem); // necessary for Barzilai Borwein
+      double quadr, parchTimeGrad;
+      randomNumberGenerator rng(control_.seed); // for stochastic Barzilai Borwein
+
+      // prepare fit elements
+      // parameters_k and parameters_kMinus1 are both the starting values; the model is therefore only evaluated once
+      double fit_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(startingValues, labels)) +
+                     smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters), // ridge penalty part
+          fit_kMinus1 = fit_k,
+          penalty_k = 0.0;
+      double penalizedFit_k, penalizedFit_kMinus1;
+
+      penalizedFit_k = fit_k +
+                       penalty_.getValue(parameters_k, parameterLabels, tuningParameters); // lasso penalty part
+
+      penalizedFit_kMinus1 = fit_kMinus1 +
+                             penalty_.getValue(parameters_kMinus1, parameterLabels, tuningParameters); // lasso penalty part
+
+      // the following vector will save the fits of all iterations:
+      fits.set_size(control_.maxIterOut + 1);
+      fits.fill(arma::datum::nan);
+      fits(0) = penalizedFit_kMinus1;
+
+      // prepare gradient elements
+      // NOTE: We combine the gradients of the smooth functions (the log-Likelihood)
+      // of the model and the smooth penalty function (e.g., ridge)
+      gradients_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k, labels)) +
+                    smoothPenalty_.getGradients(parameters_k, parameterLabels, smoothTuningParameters); // ridge part
+      gradients_kMinus1 = gradients_k;
+      // for acceleration:
+      gradient_y_k = gradients_k;
 
-          // apply proximal operator to get new parameters for given step size
-          parameters_k = proximalOperator_.getParameters(
-              parameters_kMinus1,
-              gradients_kMinus1,
-              parameterLabels,
-              L_k,
-              tuningParameters);
-        }
+      // the duality gap requires the weights of the lasso and ridge penalties
+      double dualityGap_k = arma::datum::nan;
+      double unpenalizedResidual = 0.0;
+      if (control_.convCritOuter == dualityGapCrit)
+      {
+        if (!l1PenaltyWeights(penalty_, tuningParameters, startingValues.n_elem, l1Weights) ||
+            !l2PenaltyWeights(smoothPenalty_, smoothTuningParameters, startingValues.n_elem, l2Weights))
+          error("The dualityGapCrit convergence criterion is only available for lasso and elastic net penalties.");
+      }
 
-        // compute new fit; if this fit is non-finite, we can jump to the next
-        // iteration
-        fit_k = (1.0 / control_.sampleSize) * model_.fit(parameters_k, parameterLabels) +
-                smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters); // ridge penalty part
+      // speculative evaluation of the step sizes in the inner iterations
+      speculativeEvaluator *speculative = nullptr;
+      if (control_.speculativeTrials > 1)
+      {
+        if (!speculativeEvaluator_ || (speculativeEvaluator_->size() != control_.speculativeTrials))
+          speculativeEvaluator_.reset(new speculativeEvaluator(control_.speculativeTrials));
+        if (speculativeEvaluator_->prepare(model_, reuseModelCopies))
+          speculative = speculativeEvaluator_.get();
+      }
 
-        if (!arma::is_finite(fit_k))
-          continue;
+      // breaking flags
+      bool breakInner = false, // if true, the inner iteration is exited
+          breakOuter = false;  // if true, the outer iteration is exited
 
-        // fit_k is only part of the fit we are interested in. We also need
-        // the penalty values:
-        penalty_k = penalty_.getValue(parameters_k,
-                                      parameterLabels,
-                                      tuningParameters);
+      // initialize step size
+      double L_kMinus1 = control_.L0, L_k = control_.L0;
 
-        penalizedFit_k = fit_k +
-                         penalty_k; // lasso part
+      // outer iteration
+      for (int outer_iteration = 0; outer_iteration < control_.maxIterOut; outer_iteration++)
+      {
+        LESSTIMATE_PROFILE_SCOPE("ista::outerIteration");
 
-        if (!arma::is_finite(penalizedFit_k))
-          continue;
+        // check if user wants to stop the computation:
+#if USE_R
+        Rcpp::checkUserInterrupt();
+#endif
+
+        for (int inner_iteration = 0; inner_iteration < control_.maxIterIn; inner_iteration++)
+        {
+          LESSTIMATE_PROFILE_SCOPE("ista::innerIteration");
+          // inner iteration: reduce step size until the convergence criterion is met
+          L_k = std::pow(control_.eta, inner_iteration) * L_kMinus1;
+
+          if (speculative != nullptr)
+          {
+            // the step sizes of the next trials are known in advance; their parameters are
+            // computed and their fits are evaluated concurrently
+            if (inner_iteration % speculative->size() == 0)
+              prepareTrials(model_,
+                            labels,
+                            parameterLabels,
+                            proximalOperator_,
+                            smoothPenalty_,
+                            tuningParameters,
+                            smoothTuningParameters,
+                            inner_iteration,
+                            L_kMinus1,
+                            *speculative);
+            parameters_k = speculative->trialParameters.at(inner_iteration % speculative->size());
+          }
+          else if (control_.accelerate)
+          {
+            // with acceleration:
+            // apply proximal operator to get new parameters for given step size
+            // see Parikh, N., & Boyd, S. (2013). Proximal Algorithms. Foundations
+            // and Trends in Optimization, 1(3), 123–231. p. 152
+
+            y_k = parameters_kMinus1 +
+                  (inner_iteration / (inner_iteration + 3)) * (parameters_kMinus1 - parameters_kMinus2);
+            gradient_y_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(y_k,
+                                                                                                                          labels)) +
+                           smoothPenalty_.getGradients(y_k,
+                                                       parameterLabels,
+                                                       smoothTuningParameters);
+            proximalOperator_.getParametersInPlace(
+                y_k,
+                gradient_y_k,
+                parameterLabels,
+                L_k,
+                tuningParameters,
+                parameters_k);
+          }
+          else
+          {
+
+            // apply proximal operator to get new parameters for given step size
+            proximalOperator_.getParametersInPlace(
+                parameters_kMinus1,
+                gradients_kMinus1,
+                parameterLabels,
+                L_k,
+                tuningParameters,
+                parameters_k);
+          }
+
+          // compute new fit; if this fit is non-finite, we can jump to the next
+          // iteration
+          fit_k = (1.0 / control_.sampleSize) * ((speculative != nullptr) ? speculative->fit(inner_iteration % speculative->size())
+                                                                          : LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k, labels))) +
+                  smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters); // ridge penalty part
+
+          if (!arma::is_finite(fit_k))
+            continue;
 
-        // to test the convergence criterion, we offer different criteria
+          // fit_k is only part of the fit we are interested in. We also need
+          // the penalty values:
+          penalty_k = penalty_.getValue(parameters_k,
+                                        parameterLabels,
+                                        tuningParameters);
 
-        if (control_.convCritInner == istaCrit)
+          penalizedFit_k = fit_k +
+                           penalty_k; // lasso part
+
+          if (!arma::is_finite(penalizedFit_k))
+            continue;
+
+          // to test the convergence criterion, we offer different criteria
+
+          if (control_.convCritInner == istaCrit)
+          {
+            // ISTA:
+            // The approximated fit based on the quadratic approximation
+            // h(parameters_k) := fit(parameters_k) +
+            // (parameters_k-parameters_kMinus1)*gradients_k^T +
+            // (L/2)*(parameters_k-parameters_kMinus1)^2 +
+            // penalty(parameters_k)
+            // is compared to the exact fit
+            parameterChange = parameters_k - parameters_kMinus1;
+            quadr = arma::dot(parameterChange, parameterChange);           // always positive
+            parchTimeGrad = arma::dot(parameterChange, gradients_kMinus1); // can be
+            // positive or negative
+
+            breakInner = penalizedFit_k <= (fit_kMinus1 +
+                                            parchTimeGrad +
+                                            (L_k / 2.0) * quadr +
+                                            penalty_k);
+          }
+          else if (control_.convCritInner == gistCrit)
+          {
+
+            // GIST:
+            // the exact fit is compared to
+            // h(parameters_k) := fit(parameters_k) +
+            // penalty(parameters_kMinus1) +
+            // L*(sigma/2)*(parameters_k-parameters_kMinus1)^2
+            //
+            parameterChange = parameters_k - parameters_kMinus1;
+            quadr = arma::dot(parameterChange, parameterChange); // always positive
+
+            breakInner = penalizedFit_k <= (penalizedFit_kMinus1 -
+                                            L_k * (control_.sigma / 2.0) * quadr);
+          }
+
+          if (breakInner)
+          {
+            // compute gradients at new position
+            gradients_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                                                         labels)) +
+                          smoothPenalty_.getGradients(parameters_k,
+                                                      parameterLabels,
+                                                      smoothTuningParameters); // ridge part
+
+            // if any of the gradients is non-finite, we can skip to a
+            // smaller step size
+            if (!arma::is_finite(gradients_k))
+              continue;
+
+            // if everything worked out fine, we break the inner iteration
+            break;
+
+          } // end break inner
+        }   // end inner iteration
+
+        // print fit info
+        if ((control_.verbose > 0) && (outer_iteration % control_.verbose == 0))
         {
-          // ISTA:
-          // The approximated fit based on the quadratic approximation
-          // h(parameters_k) := fit(parameters_k) +
-          // (parameters_k-parameters_kMinus1)*gradients_k^T +
-          // (L/2)*(parameters_k-parameters_kMinus1)^2 +
-          // penalty(parameters_k)
-          // is compared to the exact fit
-          parameterChange = parameters_k - parameters_kMinus1;
-          quadr = parameterChange * arma::trans(parameterChange);           // always positive
-          parchTimeGrad = parameterChange * arma::trans(gradients_kMinus1); // can be
-          // positive or negative
-
-          breakInner = penalizedFit_k <= (fit_kMinus1 +
-                                          parchTimeGrad(0, 0) +
-                                          (L_k / 2.0) * quadr(0, 0) +
-                                          penalty_k);
+          print << "Fit in iteration outer_iteration " << outer_iteration + 1 << ": " << penalizedFit_k << " (" << fit_k << " + " << penalty_k << ")" << std::endl;
+          print << parameters_k << std::endl;
         }
-        else if (control_.convCritInner == gistCrit)
+
+        if ((!breakInner) && (control_.verbose < 0))
         {
+          reportDiagnostic(innerIterationsFailed);
+          L_kMinus1 = control_.L0;
+          continue;
+        }
 
-          // GIST:
-          // the exact fit is compared to
-          // h(parameters_k) := fit(parameters_k) +
-          // penalty(parameters_kMinus1) +
-          // L*(sigma/2)*(parameters_k-parameters_kMinus1)^2
-          //
-          parameterChange = parameters_k - parameters_kMinus1;
-          quadr = parameterChange * arma::trans(parameterChange); // always positive
+        gradients_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_k,
+                                                                                                                     labels)) +
+                      smoothPenalty_.getGradients(parameters_k,
+                                                  parameterLabels,
+                                                  smoothTuningParameters); // ridge part
 
-          breakInner = penalizedFit_k <= (penalizedFit_kMinus1 -
-                                          L_k * (control_.sigma / 2.0) * quadr(0, 0));
+        fits(outer_iteration + 1) = penalizedFit_k;
+
+        // check outer breaking condition
+        if (control_.convCritOuter == dualityGapCrit)
+        {
+          dualityGap_k = computeDualityGap(model_,
+                                           parameters_k,
+                                           fit_k,
+                                           gradients_k,
+                                           l1Weights,
+                                           l2Weights,
+                                           control_.sampleSize,
+                                           unpenalizedResidual);
+          if (!arma::is_finite(dualityGap_k))
+            error("The dualityGapCrit convergence criterion requires a model implementing dualFit.");
+          breakOuter = (dualityGap_k < control_.breakOuter) &&
+                       (unpenalizedResidual < control_.breakOuter);
+        }
+        else
+        {
+          breakOuter = std::abs(fits(outer_iteration + 1) - fits(outer_iteration)) < control_.breakOuter;
         }
 
-        if (breakInner)
+        // report the progress; stops if the fit was cancelled
+        if (control_.progress != nullptr)
         {
-          // compute gradients at new position
-          gradients_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_k,
-                                                                       parameterLabels) +
-                        smoothPenalty_.getGradients(parameters_k,
-                                                    parameterLabels,
-                                                    smoothTuningParameters); // ridge part
-
-          // if any of the gradients is non-finite, we can skip to a
-          // smaller step size
-          if (!arma::is_finite(gradients_k))
-            continue;
+          control_.progress->report(outer_iteration + 1, control_.sampleSize * penalizedFit_k, parameters_k); // rescale for -2log-Likelihood
+          if (control_.progress->cancelled())
+            break;
+        }
 
-          // if everything worked out fine, we break the inner iteration
+        if (breakOuter)
+        {
           break;
+        }
 
-        } // end break inner
-      }   // end inner iteration
+        // define new initial step size
+        if (control_.stepSizeIn == initial)
+        {
 
-      // print fit info
-      if ((control_.verbose > 0) && (outer_iteration % control_.verbose == 0))
-      {
-        print << "Fit in iteration outer_iteration " << outer_iteration + 1 << ": " << penalizedFit_k << " (" << fit_k << " + " << penalty_k << ")" << std::endl;
-        print << parameters_k << std::endl;
-      }
+          L_kMinus1 = control_.L0;
+        }
+        else if (control_.stepSizeIn == barzilaiBorwein ||
+                 control_.stepSizeIn == stochasticBarzilaiBorwein)
+        {
 
-      if ((!breakInner) && (control_.verbose < 0))
-      {
-        warn("Inner iterations did not improve the fit --> resetting L.");
-        L_kMinus1 = control_.L0;
-        continue;
-      }
+          parameterChange = parameters_k - parameters_kMinus1;
+          gradientChange = gradients_k - gradients_kMinus1;
 
-      gradients_k = (1.0 / control_.sampleSize) * model_.gradients(parameters_k,
-                                                                   parameterLabels) +
-                    smoothPenalty_.getGradients(parameters_k,
-                                                parameterLabels,
-                                                smoothTuningParameters); // ridge part
+          quadr = arma::dot(parameterChange, parameterChange);
+          parchTimeGrad = arma::dot(parameterChange, gradientChange);
 
-      fits(outer_iteration + 1) = penalizedFit_k;
+          L_kMinus1 = parchTimeGrad / quadr;
 
-      // check outer breaking condition
-      breakOuter = std::abs(fits(outer_iteration + 1) - fits(outer_iteration)) < control_.breakOuter;
+          if (L_kMinus1 < 1e-10 || L_kMinus1 > 1e10)
+            L_kMinus1 = control_.L0;
 
-      if (breakOuter)
-      {
-        break;
-      }
+          if ((control_.stepSizeIn == stochasticBarzilaiBorwein) &&
+              (rng.uniform() < 0.25))
+          {
+            L_kMinus1 = control_.L0; // reset with 25% probability
+          }
+        }
+        else if (control_.stepSizeIn == istaStepInheritance)
+        {
 
-      // define new initial step size
-      if (control_.stepSizeIn == initial)
-      {
+          L_kMinus1 = L_k;
+        }
+        else
+        {
+          error("Unknown step inheritance.");
+        }
 
-        L_kMinus1 = control_.L0;
+        // for next iteration: save current values as previous values.
+        // The assignments copy into the existing memory.
+        fit_kMinus1 = fit_k;
+        penalizedFit_kMinus1 = penalizedFit_k;
+        parameters_kMinus2 = parameters_kMinus1;
+        parameters_kMinus1 = parameters_k;
+        gradients_kMinus1 = gradients_k;
       }
-      else if (control_.stepSizeIn == barzilaiBorwein ||
-               control_.stepSizeIn == stochasticBarzilaiBorwein)
-      {
 
-        parameterChange = parameters_k - parameters_kMinus1;
-        gradientChange = gradients_k - gradients_kMinus1;
+      fitResults_.convergence = breakOuter;
+      fitResults_.fit = control_.sampleSize * penalizedFit_k; // rescale for -2log-Likelihood
+      fitResults_.fits = control_.sampleSize * fits;          // rescale for -2log-Likelihood
+      fitResults_.parameterValues = parameters_k;
+      fitResults_.dualityGap = control_.sampleSize * dualityGap_k; // rescale for -2log-Likelihood
+      fitResults_.warningCounts = diagnostics_.getCounts();
+      diagnostics_.summarize();
 
-        quadr = (parameterChange)*arma::trans(parameterChange);
-        parchTimeGrad = parameterChange * arma::trans(gradientChange);
+      if (control_.progress != nullptr)
+        control_.progress->finishFit();
 
-        L_kMinus1 = parchTimeGrad(0, 0) / quadr(0, 0);
+    }
 
-        if (L_kMinus1 < 1e-10 || L_kMinus1 > 1e10)
-          L_kMinus1 = control_.L0;
+    // optimize
+    //
+    // Optimize a model using the ista procedure. See ista for details on the arguments.
+    //
+    // @return fit result
+    template <typename T, typename U> // T is the type of the tuning parameters
+    fitResults optimize(
+        model &model_,
+        const arma::rowvec &startingValues,
+        const stringVector &parameterLabels,
+        proximalOperator<T> &proximalOperator_,
+        penalty<T> &penalty_,
+        smoothPenalty<U> &smoothPenalty_,
+        const T &tuningParameters,
+        const U &smoothTuningParameters)
+    {
+      fitResults fitResults_;
+      optimize(model_,
+               startingValues,
+               parameterLabels,
+               proximalOperator_,
+               penalty_,
+               smoothPenalty_,
+               tuningParameters,
+               smoothTuningParameters,
+               fitResults_);
+      return (fitResults_);
+    }
 
-        randomNumber = unif(1, 0.0, 1.0);
-        if ((control_.stepSizeIn == stochasticBarzilaiBorwein) &&
-            (randomNumber.at(0) < 0.25))
+  private:
+    control settings;
+    arma::rowvec parameters_k, parameters_kMinus1, parameters_kMinus2, y_k;
+    arma::rowvec parameterChange, gradientChange;
+    arma::rowvec gradients_k, gradients_kMinus1, gradient_y_k;
+    arma::rowvec l1Weights, l2Weights;
+    arma::rowvec fits;
+    std::unique_ptr<speculativeEvaluator> speculativeEvaluator_;
+    bool reuseModelCopies = false;
+
+    // computes the parameters of the trials inner_iteration, ..., inner_iteration + speculative.size() - 1
+    // exactly as in the sequential inner iterations and evaluates their fits concurrently
+    template <typename T, typename U>
+    void prepareTrials(model &model_,
+                       const labelHandle labels,
+                       const stringVector &parameterLabels,
+                       proximalOperator<T> &proximalOperator_,
+                       smoothPenalty<U> &smoothPenalty_,
+                       const T &tuningParameters,
+                       const U &smoothTuningParameters,
+                       const int inner_iteration,
+                       const double L_kMinus1,
+                       speculativeEvaluator &speculative)
+    {
+      const control &control_ = settings;
+      const unsigned int nTrials = std::min(speculative.size(),
+                                            (unsigned int)(control_.maxIterIn - inner_iteration));
+      // the sequential iterations would stop at the first trial for which the gradients fail
+      unsigned int failedTrial = nTrials;
+      std::exception_ptr failure = nullptr;
+
+      if (control_.accelerate)
+      {
+        // the gradients at the extrapolated points are required by the proximal operator
+        for (unsigned int trial = 0; trial < nTrials; trial++)
         {
-          L_kMinus1 = control_.L0; // reset with 25% probability
+          const int iteration = inner_iteration + (int)trial;
+          speculative.trialParameters.at(trial) = parameters_kMinus1 +
+                                                  (iteration / (iteration + 3)) * (parameters_kMinus1 - parameters_kMinus2);
         }
+        speculative.evaluateGradients(nTrials, labels);
       }
-      else if (control_.stepSizeIn == istaStepInheritance)
-      {
 
-        L_kMinus1 = L_k;
-      }
-      else
+      for (unsigned int trial = 0; trial < nTrials; trial++)
       {
-        error("Unknown step inheritance.");
+        const double L_trial = std::pow(control_.eta, inner_iteration + (int)trial) * L_kMinus1;
+        if (control_.accelerate)
+        {
+          y_k = speculative.trialParameters.at(trial);
+          try
+          {
+            speculative.gradients(trial);
+          }
+          catch (...)
+          {
+            failedTrial = trial;
+            failure = std::current_exception();
+            break;
+          }
+          gradient_y_k = (1.0 / control_.sampleSize) * speculative.gradients(trial) +
+                         smoothPenalty_.getGradients(y_k,
+                                                     parameterLabels,
+                                                     smoothTuningParameters);
+          proximalOperator_.getParametersInPlace(
+              y_k,
+              gradient_y_k,
+              parameterLabels,
+              L_trial,
+              tuningParameters,
+              speculative.trialParameters.at(trial));
+        }
+        else
+        {
+          proximalOperator_.getParametersInPlace(
+              parameters_kMinus1,
+              gradients_kMinus1,
+              parameterLabels,
+              L_trial,
+              tuningParameters,
+              speculative.trialParameters.at(trial));
+        }
       }
 
-      // for next iteration: save current values as previous values
-      fit_kMinus1 = fit_k;
-      penalizedFit_kMinus1 = penalizedFit_k;
-      parameters_kMinus2 = parameters_kMinus1;
-      parameters_kMinus1 = parameters_k;
-      gradients_kMinus1 = gradients_k;
+      speculative.evaluateFits(failedTrial, labels);
+      if (failure)
+        speculative.setException(failedTrial, failure);
     }
+  };
 
-    fitResults fitResults_;
-
-    fitResults_.convergence = breakOuter;
-    fitResults_.fit = control_.sampleSize * penalizedFit_k; // rescale for -2log-Likelihood
-    fitResults_.fits = control_.sampleSize * fits;          // rescale for -2log-Likelihood
-    fitResults_.parameterValues = parameters_k;
-
-    return (fitResults_);
-  }
+  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
+  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
+  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
+  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
+  // second function call can be easier when coming from R.
 
   // ista
   //
@@ -479,8 +765,46 @@ namespace lessSEM
   template <typename T, typename U> // T is the type of the tuning parameters
   inline lessSEM::fitResults ista(
       model &model_,
-      arma::rowvec startingValues,
-      stringVector parameterLabels,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      proximalOperator<T> &proximalOperator_, // proximalOperator takes the tuning parameters
+      // as input -> <T>
+      penalty<T> &penalty_,             // penalty takes the tuning parameters
+      smoothPenalty<U> &smoothPenalty_, // smoothPenalty takes the smooth tuning parameters
+      // as input -> <U>
+      const T &tuningParameters,       // tuning parameters are of type T
+      const U &smoothTuningParameters, // tuning parameters are of type U
+      const control &control_ = controlDefault())
+  {
+    istaOptimizer optimizer(control_);
+    return (optimizer.optimize(model_,
+                               startingValues,
+                               parameterLabels,
+                               proximalOperator_,
+                               penalty_,
+                               smoothPenalty_,
+                               tuningParameters,
+                               smoothTuningParameters));
+  }
+
+  // ista
+  //
+  // Implements (variants of) the ista optimizer.
+  //
+  // @param model_ the model object derived from the model class in model.h
+  // @param startingValuesRcpp numericVector with starting values. The names are used as parameter labels
+  // @parma proximalOperator_ a proximal operator for the penalty function
+  // @param
+  // @param penalty_ a penalty derived from the penalty class in penalty.h
+  // @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+  // @param tuningParameters tuning parameters for the penalty function
+  // @parma smoothTuningParameters tuning parameters for the smooth penalty function
+  // @param control_ settings for the ista optimizer.
+  // @return fit result
+  template <typename T, typename U> // T is the type of the tuning parameters
+  inline lessSEM::fitResults ista(
+      model &model_,
+      numericVector startingValuesRcpp,
       proximalOperator<T> &proximalOperator_, // proximalOperator takes the tuning parameters
       // as input -> <T>
       penalty<T> &penalty_,             // penalty takes the tuning parameters
@@ -490,13 +814,12 @@ namespace lessSEM
       const U &smoothTuningParameters, // tuning parameters are of type U
       const control &control_ = controlDefault())
   {
-    numericVector startingValuesNumVec = toNumericVector(startingValues);
-    startingValuesNumVec.names() = parameterLabels;
 
     return (
         ista(
             model_,
-            startingValuesNumVec,
+            toArmaVectorView(startingValuesRcpp),
+            startingValuesRcpp.names(),
             proximalOperator_, // proximalOperator takes the tuning parameters
             // as input -> <T>
             penalty_,       // penalty takes the tuning parameters
@@ -9,6 +9,24 @@
 namespace lessSEM
 {
 
+  /**
+   * @brief proximal operator of the lasso penalty for a single parameter
+   *
+   * @param u_k parameter value after the gradient step
+   * @param lambda_i parameter-specific lambda (alpha * lambda * weight)
+   * @param L step size
+   * @return double updated parameter
+   */
+  inline double lassoProximal(const double u_k,
+                              const double lambda_i,
+                              const double L)
+  {
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+    return (sign * std::max(0.0, std::abs(u_k) - lambda_i / L));
+  }
+
   /**
    * @brief proximal operator for the lasso penalty function
    *
@@ -29,33 +47,51 @@ namespace lessSEM
      */
     arma::rowvec getParameters(const arma::rowvec &parameterValues,
                                const arma::rowvec &gradientValues,
-                               const stringVector &parameterLabels,
+                               const labelHandle parameterLabels,
                                const double L,
                                const tuningParametersEnet &tuningParameters)
         override
     {
-
-      arma::rowvec u_k = parameterValues - gradientValues / L;
-
       arma::rowvec parameters_kp1(parameterValues.n_elem);
-      parameters_kp1.fill(arma::datum::nan);
+      getParametersInPlace(parameterValues,
+                           gradientValues,
+                           parameterLabels,
+                           L,
+                           tuningParameters,
+                           parameters_kp1);
+      return parameters_kp1;
+    }
 
-      double lambda_i;
-      int sign;
+    /**
+     * @brief update the parameter vector in place
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @param parameters_kp1 will be overwritten with the updated parameters. May be the same
+     * object as parameterValues
+     */
+    void getParametersInPlace(const arma::rowvec &parameterValues,
+                              const arma::rowvec &gradientValues,
+                              const labelHandle parameterLabels,
+                              const double L,
+                              const tuningParametersEnet &tuningParameters,
+                              arma::rowvec &parameters_kp1)
+        override
+    {
+      parameters_kp1.set_size(parameterValues.n_elem);
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
-
-        lambda_i = tuningParameters.alpha *
-                   tuningParameters.lambda *
-                   tuningParameters.weights.at(p);
-
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-        parameters_kp1.at(p) = sign *
-                               std::max(0.0, std::abs(u_k.at(p)) - lambda_i / L);
+        // step in descending direction with step size (1/L):
+        const double u_k = parameterValues.at(p) - gradientValues.at(p) / L;
+        parameters_kp1.at(p) = lassoProximal(u_k,
+                                             tuningParameters.alpha *
+                                                 tuningParameters.lambda *
+                                                 tuningParameters.weights.at(p),
+                                             L);
       }
-      return parameters_kp1;
     }
   };
 
@@ -83,7 +119,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersEnet &tuningParameters)
         override
     {
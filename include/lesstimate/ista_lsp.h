@@ -45,6 +45,57 @@ namespace lessSEM
         std::log(1.0 + std::abs(par) / theta));
   }
 
+  /**
+   * @brief proximal operator of the lsp penalty for a single (regularized) parameter
+   *
+   * @param u_k parameter value after the gradient step
+   * @param lambda lambda tuning parameter value
+   * @param theta theta tuning parameter value
+   * @param L step size
+   * @return double updated parameter
+   */
+  inline double lspProximal(const double u_k,
+                            const double lambda,
+                            const double theta,
+                            const double L)
+  {
+    const double abs_u_k = std::abs(u_k);
+    double x = 0.0;
+
+    const double tempValue = std::pow(L, 2) *
+                                 std::pow(abs_u_k - theta, 2) -
+                             4.0 * L * (lambda - L * abs_u_k * theta);
+
+    if (tempValue >= 0)
+    {
+      double C[3] = {0.0, 0.0, 0.0};
+      C[1] = std::max(
+          (L * (abs_u_k - theta) + std::sqrt(tempValue)) / (2 * L),
+          0.0);
+      C[2] = std::max(
+          (L * (abs_u_k - theta) - std::sqrt(tempValue)) / (2 * L),
+          0.0);
+
+      double xVec[3];
+      for (int c = 0; c < 3; c++)
+      {
+        xVec[c] = .5 * std::pow(C[c] - abs_u_k, 2) +
+                  (1.0 / L) *
+                      lambda *
+                      std::log(1.0 + C[c] / theta);
+      }
+
+      x = C[std::distance(std::begin(xVec),
+                          std::min_element(std::begin(xVec), std::end(xVec)))];
+    }
+
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+
+    return (sign * x);
+  }
+
   /**
    * @brief proximal operator for the lsp penalty function
    *
@@ -65,72 +116,56 @@ namespace lessSEM
      */
     arma::rowvec getParameters(const arma::rowvec &parameterValues,
                                const arma::rowvec &gradientValues,
-                               const stringVector &parameterLabels,
+                               const labelHandle parameterLabels,
                                const double L,
                                const tuningParametersLSP &tuningParameters)
         override
     {
-
-      arma::rowvec u_k = parameterValues - gradientValues / L;
-
       arma::rowvec parameters_kp1(parameterValues.n_elem);
-      parameters_kp1.fill(arma::datum::nan);
-
-      double x, abs_u_k;
-      std::vector<double> C(3, 0.0);
-      std::vector<double> xVec(3, 0.0);
-      double tempValue;
-      int sign;
+      getParametersInPlace(parameterValues,
+                           gradientValues,
+                           parameterLabels,
+                           L,
+                           tuningParameters,
+                           parameters_kp1);
+      return parameters_kp1;
+    }
 
+    /**
+     * @brief update the parameter vector in place
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @param parameters_kp1 will be overwritten with the updated parameters. May be the same
+     * object as parameterValues
+     */
+    void getParametersInPlace(const arma::rowvec &parameterValues,
+                              const arma::rowvec &gradientValues,
+                              const labelHandle parameterLabels,
+                              const double L,
+                              const tuningParametersLSP &tuningParameters,
+                              arma::rowvec &parameters_kp1)
+        override
+    {
+      parameters_kp1.set_size(parameterValues.n_elem);
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
+        // step in descending direction with step size (1/L):
+        const double u_k = parameterValues.at(p) - gradientValues.at(p) / L;
         if (tuningParameters.weights.at(p) == 0.0)
         {
           // unregularized parameter
-          parameters_kp1.at(p) = u_k.at(p);
+          parameters_kp1.at(p) = u_k;
           continue;
         }
-
-        abs_u_k = std::abs(u_k.at(p));
-
-        tempValue = std::pow(L, 2) *
-                        std::pow(abs_u_k - tuningParameters.theta, 2) -
-                    4.0 * L * (tuningParameters.lambda - L * abs_u_k * tuningParameters.theta);
-
-        if (tempValue >= 0)
-        {
-          C.at(1) = std::max(
-              (L * (abs_u_k - tuningParameters.theta) + std::sqrt(tempValue)) / (2 * L),
-              0.0);
-          C.at(2) = std::max(
-              (L * (abs_u_k - tuningParameters.theta) - std::sqrt(tempValue)) / (2 * L),
-              0.0);
-
-          for (int c = 0; c < 3; c++)
-          {
-
-            xVec.at(c) = .5 * std::pow(C.at(c) - abs_u_k, 2) +
-                         (1.0 / L) *
-                             tuningParameters.lambda *
-                             std::log(1.0 + C.at(c) / tuningParameters.theta);
-          }
-
-          x = C.at(std::distance(std::begin(xVec),
-                                 std::min_element(xVec.begin(), xVec.end())));
-        }
-        else
-        {
-
-          x = 0.0;
-        }
-
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        parameters_kp1.at(p) = sign * x;
+        parameters_kp1.at(p) = lspProximal(u_k,
+                                           tuningParameters.lambda,
+                                           tuningParameters.theta,
+                                           L);
       }
-      return parameters_kp1;
     }
   };
 
@@ -160,7 +195,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersLSP &tuningParameters)
         override
     {
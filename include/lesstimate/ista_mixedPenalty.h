@@ -49,21 +49,42 @@ class proximalOperatorMixedBase {
 public:
   virtual arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) = 0;
+  
+  /**
+   * @brief update a single parameter without allocating memory
+   * 
+   * @param u_k parameter value after the gradient step
+   * @param L step size
+   * @param tuningParameters tuning parameters of all parameters
+   * @param i index of the parameter in the tuning parameters
+   * @return double updated parameter
+   */
+  virtual double getParameter(const double u_k,
+                              const double L,
+                              const tuningParametersMixedPenalty &tuningParameters,
+                              const unsigned int i) = 0;
 };
 
 class proximalOperatorMixedNone: public proximalOperatorMixedBase{
 public:
   arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) override{
                                arma::rowvec u_k = parameterValues - gradientValues / L;
                                return(u_k);
                              }
+  
+  double getParameter(const double u_k,
+                      const double L,
+                      const tuningParametersMixedPenalty &tuningParameters,
+                      const unsigned int i) override{
+    return(u_k);
+  }
 };
 
 
@@ -71,7 +92,7 @@ class proximalOperatorMixedCappedL1: public proximalOperatorMixedBase{
 public:
   arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) override{
                                
@@ -90,6 +111,19 @@ public:
                                  )
                                );
                              }
+  
+  double getParameter(const double u_k,
+                      const double L,
+                      const tuningParametersMixedPenalty &tuningParameters,
+                      const unsigned int i) override{
+    return(cappedL1Proximal(u_k,
+                            tuningParameters.alpha(i) *
+                              tuningParameters.lambda(i) *
+                              tuningParameters.weights(i),
+                            tuningParameters.theta(i),
+                            L));
+  }
+  
 private: 
   tuningParametersCappedL1 tp;
   proximalOperatorCappedL1 proxOp;
@@ -99,7 +133,7 @@ class proximalOperatorMixedLasso: public proximalOperatorMixedBase{
 public:
   arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) override{
                                
@@ -117,6 +151,18 @@ public:
                                )
                                );
                              }
+  
+  double getParameter(const double u_k,
+                      const double L,
+                      const tuningParametersMixedPenalty &tuningParameters,
+                      const unsigned int i) override{
+    return(lassoProximal(u_k,
+                         tuningParameters.alpha(i) *
+                           tuningParameters.lambda(i) *
+                           tuningParameters.weights(i),
+                         L));
+  }
+  
 private: 
   tuningParametersEnet tp;
   proximalOperatorLasso proxOp;
@@ -126,7 +172,7 @@ class proximalOperatorMixedLsp: public proximalOperatorMixedBase{
 public:
   arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) override{
                                
@@ -144,6 +190,20 @@ public:
                                  )
                                );
                              }
+  
+  double getParameter(const double u_k,
+                      const double L,
+                      const tuningParametersMixedPenalty &tuningParameters,
+                      const unsigned int i) override{
+    // unregularized parameter
+    if(tuningParameters.weights(i) == 0.0)
+      return(u_k);
+    return(lspProximal(u_k,
+                       tuningParameters.lambda(i),
+                       tuningParameters.theta(i),
+                       L));
+  }
+  
 private: 
   tuningParametersLSP tp;
   proximalOperatorLSP proxOp;
@@ -153,7 +213,7 @@ class proximalOperatorMixedMcp: public proximalOperatorMixedBase{
 public:
   arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) override{
                                
@@ -171,6 +231,20 @@ public:
                                  )
                                );
                              }
+  
+  double getParameter(const double u_k,
+                      const double L,
+                      const tuningParametersMixedPenalty &tuningParameters,
+                      const unsigned int i) override{
+    // unregularized parameter
+    if(tuningParameters.weights(i) == 0.0)
+      return(u_k);
+    return(mcpProximal(u_k,
+                       tuningParameters.lambda(i),
+                       tuningParameters.theta(i),
+                       L));
+  }
+  
 private: 
   tuningParametersMcp tp;
   proximalOperatorMcp proxOp;
@@ -181,7 +255,7 @@ class proximalOperatorMixedScad: public proximalOperatorMixedBase{
 public:
   arma::rowvec getParameters(const arma::rowvec &parameterValues,
                              const arma::rowvec &gradientValues,
-                             const stringVector &parameterLabels,
+                             const labelHandle parameterLabels,
                              const double L,
                              const tuningParametersMixedPenalty &tuningParameters) override{
                                
@@ -199,6 +273,20 @@ public:
                                  )
                                );
                              }
+  
+  double getParameter(const double u_k,
+                      const double L,
+                      const tuningParametersMixedPenalty &tuningParameters,
+                      const unsigned int i) override{
+    // unregularized parameter
+    if(tuningParameters.weights(i) == 0.0)
+      return(u_k);
+    return(scadProximal(u_k,
+                       tuningParameters.lambda(i),
+                       tuningParameters.theta(i),
+                       L));
+  }
+  
 private: 
   tuningParametersScad tp;
   proximalOperatorScad proxOp;
@@ -211,40 +299,40 @@ public:
   arma::rowvec getParameters(
      const arma::rowvec &parameterValues,
      const arma::rowvec &gradientValues,
-     const stringVector &parameterLabels,
+     const labelHandle parameterLabels,
      const double L,
      const tuningParametersMixedPenalty &tuningParameters) override {
         
-       arma::rowvec parameterValue{0};
-       arma::rowvec gradientValue{0};
-       arma::rowvec parameters_kp1 = parameterValues;
+       arma::rowvec parameters_kp1(parameterValues.n_elem);
+       getParametersInPlace(parameterValues,
+                            gradientValues,
+                            parameterLabels,
+                            L,
+                            tuningParameters,
+                            parameters_kp1);
+       return(parameters_kp1);
+                                       
+     }
+  
+  void getParametersInPlace(
+     const arma::rowvec &parameterValues,
+     const arma::rowvec &gradientValues,
+     const labelHandle parameterLabels,
+     const double L,
+     const tuningParametersMixedPenalty &tuningParameters,
+     arma::rowvec &parameters_kp1) override {
        
-       int it = 0;
+       parameters_kp1.set_size(parameterValues.n_elem);
+       
+       unsigned int it = 0;
        for(auto& proxOp: proxOps){
-         tpSinglePenalty.alpha = tuningParameters.alpha(it);
-         tpSinglePenalty.lambda = tuningParameters.lambda(it);
-         tpSinglePenalty.theta = tuningParameters.theta(it);
-         tpSinglePenalty.weights = tuningParameters.weights(it);
-         
-         parameterValue(0) = parameterValues(it);
-         gradientValue(0) = gradientValues(it);
-         
-         parameters_kp1(it) = arma::as_scalar(proxOp->getParameters(
-                                                        parameterValue,
-                                                        gradientValue,
-                                                        parameterLabels,
-                                                        L,
-                                                        tpSinglePenalty)
-                                                );
+         // step in descending direction with step size (1/L):
+         const double u_k = parameterValues.at(it) - gradientValues.at(it) / L;
+         parameters_kp1.at(it) = proxOp->getParameter(u_k, L, tuningParameters, it);
          it++;
        }
-       
-       return(parameters_kp1);
-                                       
      }
   
-private:
-  tuningParametersMixedPenalty tpSinglePenalty;
 };
 
 /**
@@ -263,14 +351,14 @@ public:
    * @return double
    */
   virtual double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) = 0;
 };
 
 class penaltyMixedNone: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
-                        const stringVector &parameterLabels,
+                        const labelHandle parameterLabels,
                         const tuningParametersMixedPenalty &tuningParameters) override{
                                return(0.0);
                              }
@@ -280,7 +368,7 @@ public:
 class penaltyMixedCappedL1: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) override{
                                
                                tp.alpha = tuningParameters.alpha(0);
@@ -304,7 +392,7 @@ private:
 class penaltyMixedLasso: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) override{
                                
                                tp.alpha = tuningParameters.alpha(0);
@@ -327,7 +415,7 @@ private:
 class penaltyMixedLsp: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) override{
                                
                                tp.lambda = tuningParameters.lambda(0);
@@ -350,7 +438,7 @@ private:
 class penaltyMixedMcp: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) override{
                                
                                tp.lambda = tuningParameters.lambda(0);
@@ -374,7 +462,7 @@ private:
 class penaltyMixedScad: public penaltyMixedPenaltyBase{
 public:
   double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) override{
                                
                                tp.lambda = tuningParameters.lambda(0);
@@ -399,7 +487,7 @@ public:
   std::vector<std::unique_ptr<penaltyMixedPenaltyBase>> penalties;
   
   double getValue(const arma::rowvec &parameterValues,
-                  const stringVector &parameterLabels,
+                  const labelHandle parameterLabels,
                   const tuningParametersMixedPenalty &tuningParameters) override{
         
         double penaltyValue = 0.0;
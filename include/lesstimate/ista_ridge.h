@@ -34,7 +34,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersEnet &tuningParameters) override
     {
       // if ridge is not used:
@@ -67,7 +67,7 @@ namespace lessSEM
      * @return arma::rowvec
      */
     arma::rowvec getGradients(const arma::rowvec &parameterValues,
-                              const stringVector &parameterLabels,
+                              const labelHandle parameterLabels,
                               const tuningParametersEnet &tuningParameters) override
     {
 
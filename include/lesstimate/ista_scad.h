@@ -75,6 +75,81 @@ namespace lessSEM
     return 0.0;
   }
 
+  /**
+   * @brief proximal operator of the scad penalty for a single (regularized) parameter
+   *
+   * @param u_k parameter value after the gradient step
+   * @param lambda lambda tuning parameter value
+   * @param theta theta tuning parameter value
+   * @param L step size
+   * @return double updated parameter
+   */
+  inline double scadProximal(const double u_k,
+                             const double lambda,
+                             const double theta,
+                             const double L)
+  {
+    const double thetaXlambda = theta * lambda;
+
+    int sign = (u_k > 0);
+    if (u_k < 0)
+      sign = -1;
+
+    const double abs_u_k = std::abs(u_k);
+
+    double x[4]; // to save the minima of the
+    // three different regions of the penalty function
+
+    // assume that the solution is found in
+    // |x| <= lambda. In this region, the
+    // scad penalty is identical to the lasso, so
+    // we can use the same minimizer as for the lasso
+    // with the additional bound that
+
+    // identical to Gong et al. (2013)
+    x[0] = sign * std::min(
+                      lambda,
+                      std::max(
+                          0.0,
+                          abs_u_k - lambda / L));
+
+    // assume that lambda <= |u| <= theta*lambda
+    // The following differs from Gong et al. (2013)
+
+    const double v = 1.0 - 1.0 / (L * (theta - 1.0)); // used repeatedly;
+    // only computed for convenience
+
+    x[1] = std::min(
+        thetaXlambda,
+        std::max(
+            lambda,
+            (u_k / v) - (thetaXlambda) / (L * (theta - 1.0) * v)));
+
+    x[2] = std::max(
+        -thetaXlambda,
+        std::min(
+            -lambda,
+            (u_k / v) + (thetaXlambda) / (L * (theta - 1.0) * v)));
+
+    // assume that |u| >= lambda*theta
+    // identical to Gong et al. (2013)
+
+    x[3] = sign * std::max(
+                      thetaXlambda,
+                      abs_u_k);
+
+    double h[4]; // to save the function values of the
+    // four possible minima saved in x
+    for (int i = 0; i < 4; i++)
+    {
+      h[i] = .5 * std::pow(x[i] - u_k, 2) + // distance between parameters
+             (1.0 / L) * scadPenalty(x[i], lambda, theta);
+    }
+
+    return (x[std::distance(std::begin(h),
+                            std::min_element(std::begin(h), std::end(h)))]);
+  }
+
   /**
    * @brief proximal operator for the scad penalty function
    *
@@ -95,90 +170,56 @@ namespace lessSEM
      */
     arma::rowvec getParameters(const arma::rowvec &parameterValues,
                                const arma::rowvec &gradientValues,
-                               const stringVector &parameterLabels,
+                               const labelHandle parameterLabels,
                                const double L,
                                const tuningParametersScad &tuningParameters)
         override
     {
-
-      arma::rowvec u_k = parameterValues - gradientValues / L;
-
       arma::rowvec parameters_kp1(parameterValues.n_elem);
-      parameters_kp1.fill(arma::datum::nan);
-
-      double abs_u_k, v;
-      std::vector<double> x(4, 0.0); // to save the minima of the
-      // three different regions of the penalty function
-      std::vector<double> h(4, 0.0); // to save the function values of the
-      // four possible minima saved in x
-      int sign; // sign of u_k
-      double thetaXlambda = tuningParameters.theta * tuningParameters.lambda;
+      getParametersInPlace(parameterValues,
+                           gradientValues,
+                           parameterLabels,
+                           L,
+                           tuningParameters,
+                           parameters_kp1);
+      return parameters_kp1;
+    }
 
+    /**
+     * @brief update the parameter vector in place
+     *
+     * @param parameterValues current parameter values
+     * @param gradientValues current gradient values
+     * @param parameterLabels parameter labels
+     * @param L step size
+     * @param tuningParameters tuning parameters of the penalty function
+     * @param parameters_kp1 will be overwritten with the updated parameters. May be the same
+     * object as parameterValues
+     */
+    void getParametersInPlace(const arma::rowvec &parameterValues,
+                              const arma::rowvec &gradientValues,
+                              const labelHandle parameterLabels,
+                              const double L,
+                              const tuningParametersScad &tuningParameters,
+                              arma::rowvec &parameters_kp1)
+        override
+    {
+      parameters_kp1.set_size(parameterValues.n_elem);
       for (unsigned int p = 0; p < parameterValues.n_elem; p++)
       {
-
+        // step in descending direction with step size (1/L):
+        const double u_k = parameterValues.at(p) - gradientValues.at(p) / L;
         if (tuningParameters.weights.at(p) == 0.0)
         {
           // unregularized parameter
-          parameters_kp1.at(p) = u_k.at(p);
+          parameters_kp1.at(p) = u_k;
           continue;
         }
-
-        sign = (u_k.at(p) > 0);
-        if (u_k.at(p) < 0)
-          sign = -1;
-
-        abs_u_k = std::abs(u_k.at(p));
-
-        // assume that the solution is found in
-        // |x| <= lambda. In this region, the
-        // scad penalty is identical to the lasso, so
-        // we can use the same minimizer as for the lasso
-        // with the additional bound that
-
-        // identical to Gong et al. (2013)
-        x.at(0) = sign * std::min(
-                             tuningParameters.lambda,
-                             std::max(
-                                 0.0,
-                                 abs_u_k - tuningParameters.lambda / L));
-
-        // assume that lambda <= |u| <= theta*lambda
-        // The following differs from Gong et al. (2013)
-
-        v = 1.0 - 1.0 / (L * (tuningParameters.theta - 1.0)); // used repeatedly;
-        // only computed for convenience
-
-        x.at(1) = std::min(
-            thetaXlambda,
-            std::max(
-                tuningParameters.lambda,
-                (u_k.at(p) / v) - (thetaXlambda) / (L * (tuningParameters.theta - 1.0) * v)));
-
-        x.at(2) = std::max(
-            -thetaXlambda,
-            std::min(
-                -tuningParameters.lambda,
-                (u_k.at(p) / v) + (thetaXlambda) / (L * (tuningParameters.theta - 1.0) * v)));
-
-        // assume that |u| >= lambda*theta
-        // identical to Gong et al. (2013)
-
-        x.at(3) = sign * std::max(
-                             thetaXlambda,
-                             abs_u_k);
-
-        for (int i = 0; i < 4; i++)
-        {
-          h.at(i) = .5 * std::pow(x.at(i) - u_k.at(p), 2) + // distance between parameters
-                    (1.0 / L) * scadPenalty(x.at(i), tuningParameters.lambda, tuningParameters.theta);
-        }
-
-        parameters_kp1.at(p) = x.at(std::distance(std::begin(h),
-                                                  std::min_element(h.begin(), h.end())));
+        parameters_kp1.at(p) = scadProximal(u_k,
+                                            tuningParameters.lambda,
+                                            tuningParameters.theta,
+                                            L);
       }
-
-      return parameters_kp1;
     }
   };
 
@@ -212,7 +253,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersScad &tuningParameters)
         override
     {
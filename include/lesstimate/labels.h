@@ -0,0 +1,123 @@
+#ifndef LABELS_H
+#define LABELS_H
+#include "common_headers.h"
+
+// The parameter labels are passed to every call of fit and gradients. Copying
+// a stringVector allocates one string per parameter; this adds up for models
+// with thousands of parameters. The optimizers therefore only pass a
+// labelHandle (a single pointer) to the models (fitFast, gradientsFast, and
+// minibatchGradients), the penalties, and the proximal operators. The labels are
+// stored once by the caller (or a labelTable) and never rebuilt. Models which do not
+// use the labels should override fitFast and gradientsFast (see model.h); for all
+// other models, the stringVector is handed over as before.
+
+namespace lessSEM
+{
+  /**
+   * @brief read-only reference to the labels of the parameters. Copying a handle
+   * costs one pointer; the labels themselves are never copied. The labels must outlive
+   * the handle (this is the case for all handles created by the optimizers).
+   */
+  class labelHandle
+  {
+  public:
+    /**
+     * @brief Construct a new label handle. The conversion is implicit so that functions taking
+     * a labelHandle can be called with a stringVector. The stringVector must outlive the handle.
+     *
+     * @param labels_ labels of the parameters
+     */
+    labelHandle(const stringVector &labels_) : labels(&labels_) {}
+
+    /**
+     * @brief returns the labels as stringVector. Used to call models which
+     * only implement the fit and gradients methods with stringVector labels.
+     *
+     * @return const stringVector&
+     */
+    const stringVector &legacy() const
+    {
+      return (*labels);
+    }
+
+    /**
+     * @brief returns the number of labels
+     *
+     * @return unsigned int
+     */
+    unsigned int size() const
+    {
+      return ((unsigned int)labels->size());
+    }
+
+    /**
+     * @brief returns the label of parameter i
+     *
+     * @param i index of the parameter
+     * @return std::string
+     */
+    std::string at(const unsigned int i) const
+    {
+      return (std::string(labels->at(i)));
+    }
+
+  private:
+    const stringVector *labels;
+  };
+
+  /**
+   * @brief owns the labels of the parameters and provides handles to them. The labels
+   * are stored once; all handles refer to the same storage.
+   */
+  class labelTable
+  {
+  public:
+    /**
+     * @brief Construct a new label table
+     *
+     * @param labels_ labels of the parameters
+     */
+    labelTable(stringVector labels_) : labels(std::move(labels_)) {}
+
+    /**
+     * @brief Construct a new label table
+     *
+     * @param labels_ labels of the parameters
+     */
+    labelTable(const std::vector<std::string> &labels_) : labels(toStringVector(labels_)) {}
+
+    labelTable(const labelTable &) = delete;
+    labelTable &operator=(const labelTable &) = delete;
+
+    /**
+     * @brief returns a handle to the labels. The handle is valid as long as the table exists.
+     *
+     * @return labelHandle
+     */
+    labelHandle handle() const
+    {
+      return (labelHandle(labels));
+    }
+
+    /**
+     * @brief returns the position of a label
+     *
+     * @param label label of the parameter
+     * @return int position of the label; -1 if the label does not exist
+     */
+    int find(const std::string &label) const
+    {
+      for (int i = 0; i < (int)labels.size(); i++)
+      {
+        if (std::string(labels.at(i)) == label)
+          return (i);
+      }
+      return (-1);
+    }
+
+  private:
+    const stringVector labels;
+  };
+
+}
+#endif
@@ -0,0 +1,182 @@
+#ifndef LINESEARCH_H
+#define LINESEARCH_H
+#include "common_headers.h"
+
+// Helper functions for the line searches of glmnet and bfgsOptim. The interpolation
+// follows Chapter 3.5 in
+// Nocedal, J., & Wright, S. J. (2006). Numerical Optimization (2nd ed.). Springer.
+
+namespace lessSEM
+{
+
+  /**
+   * Specifies how the step size is found in the line search of glmnet and bfgsOptim.
+   */
+  enum lineSearchType
+  {
+    backtracking,  /** Tries the step sizes 1, stepSize, stepSize^2, ... until the Armijo condition is met.*/
+    interpolation, /** Uses quadratic and cubic interpolation of the fit values at previous trial step sizes to
+                       find the next trial step size. The first trial step size depends on the step size accepted
+                       in the previous outer iteration.*/
+    strongWolfe    /** Only available for bfgsOptim. Uses the gradients at the trial step sizes to find a step size
+                       satisfying the strong Wolfe conditions. The first trial step size depends on the step size
+                       accepted in the previous outer iteration.*/
+  };
+  const std::vector<std::string> lineSearchType_txt = {
+      "backtracking",
+      "interpolation",
+      "strongWolfe"};
+
+  // the curvature condition of the strong Wolfe conditions requires
+  // |phi'(stepSize)| <= wolfeCurvature * |phi'(0)|. 0.9 is the typical choice for
+  // quasi-Newton methods (Nocedal & Wright, 2006, p. 34)
+  const double wolfeCurvature = 0.9;
+
+  /**
+   * @brief returns the first trial step size of the line search. The step is allowed to grow
+   * by one backtracking step relative to the step size accepted in the previous outer iteration,
+   * but never exceeds 1.
+   *
+   * @param previousStepSize step size accepted in the previous outer iteration
+   * @param stepSize backtracking factor (0 < stepSize < 1)
+   * @return double
+   */
+  inline double initialTrialStepSize(const double previousStepSize,
+                                     const double stepSize)
+  {
+    if (!arma::is_finite(previousStepSize) || (previousStepSize <= 0.0))
+      return (1.0);
+    return (std::min(1.0, previousStepSize / stepSize));
+  }
+
+  /**
+   * @brief finds the next trial step size by interpolating phi(stepSize) = f(x + stepSize*d) - f(x).
+   * If only one trial step size is available, a quadratic is fitted to phi(0) = 0, phi'(0) and
+   * phi(currentStepSize); otherwise, a cubic is fitted to phi(0), phi'(0) and the last two trial
+   * values. The result is restricted to [.1*currentStepSize, .5*currentStepSize].
+   *
+   * @param currentStepSize last trial step size
+   * @param phi_current phi(currentStepSize)
+   * @param previousStepSize trial step size before currentStepSize
+   * @param phi_previous phi(previousStepSize)
+   * @param hasPrevious is there a previous trial step size?
+   * @param derivative_0 phi'(0); must be negative
+   * @return double
+   */
+  inline double interpolateStepSize(const double currentStepSize,
+                                    const double phi_current,
+                                    const double previousStepSize,
+                                    const double phi_previous,
+                                    const bool hasPrevious,
+                                    const double derivative_0)
+  {
+    // quadratic interpolation (Nocedal & Wright, 2006, Eq. 3.58)
+    double newStepSize = -derivative_0 * currentStepSize * currentStepSize /
+                         (2.0 * (phi_current - derivative_0 * currentStepSize));
+
+    if (hasPrevious)
+    {
+      // cubic interpolation (Nocedal & Wright, 2006, p. 58)
+      const double t0 = previousStepSize;
+      const double t1 = currentStepSize;
+      const double r0 = phi_previous - derivative_0 * t0;
+      const double r1 = phi_current - derivative_0 * t1;
+      const double denominator = t0 * t0 * t1 * t1 * (t1 - t0);
+      const double a = (t0 * t0 * r1 - t1 * t1 * r0) / denominator;
+      const double b = (-t0 * t0 * t0 * r1 + t1 * t1 * t1 * r0) / denominator;
+      const double discriminant = b * b - 3.0 * a * derivative_0;
+
+      double cubicStepSize = arma::datum::nan;
+      if (a == 0.0)
+        cubicStepSize = -derivative_0 / (2.0 * b);
+      else if (discriminant >= 0.0)
+        cubicStepSize = (-b + std::sqrt(discriminant)) / (3.0 * a);
+
+      if (arma::is_finite(cubicStepSize))
+        newStepSize = cubicStepSize;
+    }
+
+    // safeguard: the step size must decrease, but not too fast
+    if (!arma::is_finite(newStepSize))
+      return (.5 * currentStepSize);
+    return (std::min(std::max(newStepSize, .1 * currentStepSize), .5 * currentStepSize));
+  }
+
+  /**
+   * @brief finds the minimizer of the quadratic interpolating phi(stepSize_1), phi'(stepSize_1)
+   * and phi(stepSize_2). The result is restricted to the inner 80% of the interval between the
+   * step sizes; if the quadratic has no minimizer, the midpoint is returned.
+   *
+   * @param stepSize_1 first step size
+   * @param phi_1 phi(stepSize_1)
+   * @param derivative_1 phi'(stepSize_1)
+   * @param stepSize_2 second step size
+   * @param phi_2 phi(stepSize_2)
+   * @return double
+   */
+  inline double quadraticMinimizerStepSize(const double stepSize_1,
+                                           const double phi_1,
+                                           const double derivative_1,
+                                           const double stepSize_2,
+                                           const double phi_2)
+  {
+    const double lower = std::min(stepSize_1, stepSize_2);
+    const double upper = std::max(stepSize_1, stepSize_2);
+    const double difference = stepSize_2 - stepSize_1;
+    const double curvature = phi_2 - phi_1 - derivative_1 * difference;
+
+    if (!(curvature > 0.0))
+      return (.5 * (lower + upper));
+
+    const double newStepSize = stepSize_1 - derivative_1 * difference * difference / (2.0 * curvature);
+    if (!arma::is_finite(newStepSize))
+      return (.5 * (lower + upper));
+
+    const double margin = .1 * (upper - lower);
+    return (std::min(std::max(newStepSize, lower + margin), upper - margin));
+  }
+
+  /**
+   * @brief finds the minimizer of the cubic interpolating phi and phi' at two step sizes
+   * (Nocedal & Wright, 2006, Eq. 3.59). The result is restricted to the inner 80%
+   * of the interval between the step sizes; if the cubic has no minimizer, the midpoint is returned.
+   *
+   * @param stepSize_1 first step size
+   * @param phi_1 phi(stepSize_1)
+   * @param derivative_1 phi'(stepSize_1)
+   * @param stepSize_2 second step size
+   * @param phi_2 phi(stepSize_2)
+   * @param derivative_2 phi'(stepSize_2)
+   * @return double
+   */
+  inline double cubicMinimizerStepSize(const double stepSize_1,
+                                       const double phi_1,
+                                       const double derivative_1,
+                                       const double stepSize_2,
+                                       const double phi_2,
+                                       const double derivative_2)
+  {
+    const double lower = std::min(stepSize_1, stepSize_2);
+    const double upper = std::max(stepSize_1, stepSize_2);
+    const double midpoint = .5 * (lower + upper);
+
+    const double d1 = derivative_1 + derivative_2 - 3.0 * (phi_1 - phi_2) / (stepSize_1 - stepSize_2);
+    const double radicand = d1 * d1 - derivative_1 * derivative_2;
+    if (radicand < 0.0)
+      return (midpoint);
+
+    const double sign = (stepSize_2 > stepSize_1) ? 1.0 : -1.0;
+    const double d2 = sign * std::sqrt(radicand);
+    const double newStepSize = stepSize_2 - (stepSize_2 - stepSize_1) *
+                                                (derivative_2 + d2 - d1) /
+                                                (derivative_2 - derivative_1 + 2.0 * d2);
+
+    if (!arma::is_finite(newStepSize))
+      return (midpoint);
+
+    const double margin = .1 * (upper - lower);
+    return (std::min(std::max(newStepSize, lower + margin), upper - margin));
+  }
+
+}
+#endif
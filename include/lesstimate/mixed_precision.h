@@ -0,0 +1,250 @@
+#ifndef MIXED_PRECISION_H
+#define MIXED_PRECISION_H
+// For large models, most of the time is spent in the fit and gradients functions
+// of the user model which typically work on large data matrices. These
+// computations can be run in single precision (float) to halve the memory
+// bandwidth. Only the model evaluations are single precision: the optimizers,
+// the penalties, the p x p Hessian of glmnet, the BFGS update and the
+// coordinate descent workspace remain in double precision. For large p with
+// comparatively little data, the Hessian and the inner iterations of glmnet
+// dominate the memory traffic and the single precision stage saves little;
+// ista (which has no Hessian) profits more in this case.
+// The procedure has two stages:
+// 1) optimize the single precision model until the fit no longer changes
+//    noticeably at float precision
+// 2) polish the estimates with the double precision model, starting from the
+//    estimates (and, for glmnet, the Hessian approximation) of stage 1.
+
+#include "common_headers.h"
+#include "model.h"
+#include "simplified_interfaces.h"
+
+namespace lessSEM
+{
+  /**
+   * @brief modelFloat is the single precision counterpart of the model class. The user specified model should
+   * inherit from the modelFloat class and implement the fit and gradients method in single precision.
+   */
+  class modelFloat
+  {
+  public:
+    /**
+     * @brief fit method with arguments parameterValues (arma::frowvec) and parameterLabels (stringVector; see common_headers.h)
+     * specifying the parameter values and the labels of the paramters. The function should return the fit value (float).
+     *
+     * @param parameterValues arma::frowvec with parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @return float
+     */
+    virtual float fit(const arma::frowvec &parameterValues,
+                      const stringVector &parameterLabels) = 0;
+
+    /**
+     * @brief gradients method with arguments parameterValues (arma::frowvec) and parameterLabels (stringVector; see common_headers.h)
+     * specifying the parameter values and the labels of the paramters. The function should return the gradients (arma::frowvec)
+     *
+     * @param parameterValues arma::frowvec with parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @return arma::frowvec gradients
+     */
+    virtual arma::frowvec gradients(const arma::frowvec &parameterValues,
+                                    const stringVector &parameterLabels) = 0;
+  };
+
+  /**
+   * @brief Wraps a modelFloat so that it can be passed to any of the optimizers. The parameters are
+   * cast to single precision before calling the user model and the results are cast back to double precision.
+   */
+  class singlePrecisionModel : public model
+  {
+  public:
+    /**
+     * @brief Construct a new single precision model object
+     *
+     * @param floatModel_ the single precision model
+     */
+    singlePrecisionModel(modelFloat &floatModel_) : floatModel(floatModel_) {}
+
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      parameterValuesFloat = arma::conv_to<arma::frowvec>::from(parameterValues);
+      return ((double)floatModel.fit(parameterValuesFloat, parameterLabels.legacy()));
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      parameterValuesFloat = arma::conv_to<arma::frowvec>::from(parameterValues);
+      return (arma::conv_to<arma::rowvec>::from(floatModel.gradients(parameterValuesFloat, parameterLabels.legacy())));
+    }
+
+  private:
+    modelFloat &floatModel;
+    arma::frowvec parameterValuesFloat;
+  };
+
+  /**
+   * @brief Returns the default settings for the single precision stage of the glmnet optimizer. Because the fit
+   * is only precise to about 7 significant digits, the convergence criterion is less strict than the default.
+   *
+   * @return controlGLMNET
+   */
+  inline controlGLMNET controlGlmnetSinglePrecisionDefault()
+  {
+    controlGLMNET defaultIs = controlGlmnetDefault();
+    defaultIs.breakOuter = 1e-4;
+    defaultIs.breakKKTAbsolute = 1e-4;
+    defaultIs.breakKKTRelative = 1e-4;
+    defaultIs.maxIterOut = 200;
+    return (defaultIs);
+  }
+
+  /**
+   * @brief Returns the default settings for the single precision stage of the ista optimizer. Because the fit
+   * is only precise to about 7 significant digits, the convergence criterion is less strict than the default.
+   *
+   * @return controlIsta
+   */
+  inline controlIsta controlIstaSinglePrecisionDefault()
+  {
+    controlIsta defaultIs = controlIstaDefault();
+    defaultIs.breakOuter = 1e-4;
+    defaultIs.maxIterOut = 200;
+    return (defaultIs);
+  }
+
+  /**
+   * @brief Optimizes the single precision version of a model with glmnet and polishes the estimates
+   * using the double precision version of the model. See fitGlmnet for details on the penalties.
+   * Only the model evaluations are single precision; the Hessian approximation and the inner
+   * iterations use double precision in both stages.
+   *
+   * @param floatModel single precision version of the model. Must inherit from lessSEM::modelFloat!
+   * @param doubleModel double precision version of the model. Must inherit from lessSEM::model!
+   * @param startingValues an arma::rowvec numeric vector with starting values
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty vector with strings indicating the penalty for each parameter.
+   * @param lambda lambda tuning parameter values. One lambda value for each parameter.
+   * @param theta theta tuning parameter values. One theta value for each parameter
+   * @param initialHessian matrix with initial Hessian values.
+   * @param controlSinglePrecision optimizer settings used in the single precision stage
+   * @param controlPolish optimizer settings used in the double precision stage
+   * @param verbose should additional information be printed?
+   * @return fitResults of the double precision stage
+   */
+  inline fitResults fitGlmnetMixedPrecision(
+      modelFloat &floatModel,
+      model &doubleModel,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+      controlGLMNET controlSinglePrecision = controlGlmnetSinglePrecisionDefault(),
+      controlGLMNET controlPolish = controlGlmnetDefault(),
+      const int verbose = 0)
+  {
+    singlePrecisionModel singlePrecisionModel_(floatModel);
+
+    fitResults singlePrecisionResults = fitGlmnet(
+        singlePrecisionModel_,
+        startingValues,
+        parameterLabels,
+        penalty,
+        lambda,
+        theta,
+        initialHessian,
+        controlSinglePrecision,
+        verbose);
+
+    if (verbose)
+      print << "Polishing single precision estimates in double precision." << std::endl;
+
+    // The Hessian approximation of the first stage is a much better
+    // starting point than the initial Hessian
+    arma::mat polishHessian = initialHessian;
+    if (arma::is_finite(singlePrecisionResults.Hessian) &&
+        (singlePrecisionResults.Hessian.n_rows == startingValues.n_elem))
+      polishHessian = singlePrecisionResults.Hessian;
+
+    return (fitGlmnet(
+        doubleModel,
+        singlePrecisionResults.parameterValues,
+        parameterLabels,
+        penalty,
+        lambda,
+        theta,
+        polishHessian,
+        controlPolish,
+        verbose));
+  }
+
+  /**
+   * @brief Optimizes the single precision version of a model with ista and polishes the estimates
+   * using the double precision version of the model. See fitIsta for details on the penalties.
+   *
+   * @param floatModel single precision version of the model. Must inherit from lessSEM::modelFloat!
+   * @param doubleModel double precision version of the model. Must inherit from lessSEM::model!
+   * @param startingValues an arma::rowvec numeric vector with starting values
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty vector with strings indicating the penalty for each parameter.
+   * @param lambda lambda tuning parameter values. One lambda value for each parameter.
+   * @param theta theta tuning parameter values. One theta value for each parameter
+   * @param controlSinglePrecision optimizer settings used in the single precision stage
+   * @param controlPolish optimizer settings used in the double precision stage
+   * @param verbose should additional information be printed?
+   * @return fitResults of the double precision stage
+   */
+  inline fitResults fitIstaMixedPrecision(
+      modelFloat &floatModel,
+      model &doubleModel,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      controlIsta controlSinglePrecision = controlIstaSinglePrecisionDefault(),
+      controlIsta controlPolish = controlIstaDefault(),
+      const int verbose = 0)
+  {
+    singlePrecisionModel singlePrecisionModel_(floatModel);
+
+    fitResults singlePrecisionResults = fitIsta(
+        singlePrecisionModel_,
+        startingValues,
+        parameterLabels,
+        penalty,
+        lambda,
+        theta,
+        controlSinglePrecision,
+        verbose);
+
+    if (verbose)
+      print << "Polishing single precision estimates in double precision." << std::endl;
+
+    return (fitIsta(
+        doubleModel,
+        singlePrecisionResults.parameterValues,
+        parameterLabels,
+        penalty,
+        lambda,
+        theta,
+        controlPolish,
+        verbose));
+  }
+}
+#endif
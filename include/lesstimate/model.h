@@ -2,6 +2,8 @@
 #define MODEL_H
 
 #include "common_headers.h"
+#include <memory>
+#include "labels.h"
 
 namespace lessSEM
 {
@@ -33,6 +35,106 @@ namespace lessSEM
      */
     virtual arma::rowvec gradients(arma::rowvec parameterValues,
                                    stringVector parameterLabels) = 0;
+
+    /**
+     * @brief fit method called by the optimizers. The labels are passed as a handle which avoids copying them.
+     * The default calls fit(arma::rowvec, stringVector) with the labels the handle refers to; because that
+     * method takes its arguments by value, the parameter values and labels are copied once per call (a
+     * shallow copy for Rcpp::StringVector). Models which do not need copies should override this method.
+     * The method has its own name (instead of overloading fit) so that models which only implement
+     * fit(arma::rowvec, stringVector) do not hide it.
+     *
+     * @param parameterValues arma::rowvec with parameter values
+     * @param parameterLabels handle to the parameter labels
+     * @return double
+     */
+    virtual double fitFast(const arma::rowvec &parameterValues,
+                           const labelHandle parameterLabels)
+    {
+      return (fit(parameterValues, parameterLabels.legacy()));
+    }
+
+    /**
+     * @brief gradients method called by the optimizers. The labels are passed as a handle which avoids copying them.
+     * The default copies the parameter values and labels and calls gradients(arma::rowvec, stringVector). Models
+     * which do not need copies should override this method (see fitFast).
+     *
+     * @param parameterValues arma::rowvec with parameter values
+     * @param parameterLabels handle to the parameter labels
+     * @return arma::rowvec gradients
+     */
+    virtual arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                                       const labelHandle parameterLabels)
+    {
+      return (gradients(parameterValues, parameterLabels.legacy()));
+    }
+
+    /**
+     * @brief Optional: number of observations the fit function sums over. This is only
+     * required by the stochastic optimizers (e.g., svrg) which work on subsets of the data.
+     * The default of 0 signals that the model does not support minibatches.
+     *
+     * @return unsigned int number of observations
+     */
+    virtual unsigned int numberOfObservations()
+    {
+      return (0);
+    }
+
+    /**
+     * @brief Optional: gradients of the contribution of the observations
+     * firstObservation, ..., lastObservation - 1 to the fit. Summing the minibatch
+     * gradients over all observations must return the same value as gradients().
+     * Only required by the stochastic optimizers (e.g., svrg).
+     *
+     * @param parameterValues numericVector with parameter values
+     * @param parameterLabels handle to the parameter labels
+     * @param firstObservation index of the first observation in the minibatch
+     * @param lastObservation index of the observation after the last observation in the minibatch
+     * @return arma::rowvec gradients
+     */
+    virtual arma::rowvec minibatchGradients(const arma::rowvec &parameterValues,
+                                            const labelHandle parameterLabels,
+                                            const unsigned int firstObservation,
+                                            const unsigned int lastObservation)
+    {
+      error("minibatchGradients is not implemented for this model.");
+    }
+
+    /**
+     * @brief Optional: dual of the fit function. Only required by the duality gap convergence
+     * criterion (see duality_gap.h). This is only possible for models with fit functions of the
+     * form F(X * parameterValues), where X is a data matrix (e.g., the regression models in
+     * sparse_models.h). Let u be the gradient of F at the linear predictor X * parameterValues.
+     * The function must return -F^*(scale * u), where F^* is the convex conjugate of F.
+     * The default returns NaN, which signals that the dual is not available.
+     *
+     * @param parameterValues numericVector with parameter values
+     * @param scale scaling of the dual point (0 < scale <= 1)
+     * @return double dual fit value
+     */
+    virtual double dualFit(const arma::rowvec &parameterValues,
+                           const double scale)
+    {
+      return (arma::datum::nan);
+    }
+
+    /**
+     * @brief Optional: returns an independent copy of the model. Copies are used when
+     * the model has to be evaluated from multiple threads at once (e.g., for numerical
+     * gradients) because fit and gradients may change the internal state of the model.
+     * The default returns a nullptr, which signals that the model can not be copied; the
+     * model is then only evaluated from a single thread. A typical implementation is
+     * return(std::make_unique<myModel>(*this));
+     *
+     * @return std::unique_ptr<model> copy of the model
+     */
+    virtual std::unique_ptr<model> clone() const
+    {
+      return (nullptr);
+    }
+
+    virtual ~model() = default;
   };
 
 }
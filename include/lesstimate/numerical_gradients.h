@@ -0,0 +1,314 @@
+#ifndef NUMERICAL_GRADIENTS_H
+#define NUMERICAL_GRADIENTS_H
+#include "common_headers.h"
+
+#include <complex>
+#include "model.h"
+#include "parallel.h"
+
+// numericalGradientModel allows for optimizing models which only implement
+// a fit function. The gradients are approximated with finite differences; the
+// perturbed fits are evaluated in parallel on copies of the model (see
+// model::clone). The step sizes follow the recommendations in
+// Nocedal, J., & Wright, S. J. (2006). Numerical Optimization (2nd ed), Ch. 8.
+// Complex step differentiation is described in
+// Martins, J. R. R. A., Sturdza, P., & Alonso, J. J. (2003). The complex-step
+// derivative approximation. ACM Transactions on Mathematical Software, 29(3),
+// 245–262. https://doi.org/10.1145/838250.838251
+
+namespace lessSEM
+{
+  /**
+   * Specifies how the gradients are approximated.
+   */
+  enum finiteDifferences
+  {
+    forwardDifferences, /** (f(x + h) - f(x))/h; requires p+1 fit evaluations, error of order h.*/
+    centralDifferences, /** (f(x + h) - f(x - h))/(2h); requires 2p fit evaluations, error of order h^2.*/
+    complexStep         /** Im(f(x + ih))/h; requires p complex fit evaluations and is exact up to rounding errors.
+                            The model must implement complexStepModel.*/
+  };
+  const std::vector<std::string> finiteDifferences_txt = {
+      "forwardDifferences",
+      "centralDifferences",
+      "complexStep"};
+
+  /**
+   * @brief Optional interface for models that can evaluate the fit function with
+   * complex parameters. The user specified model should inherit from model and complexStepModel.
+   * All operations in fitComplex must be analytic (e.g., no std::abs or comparisons on the
+   * complex values) for the complex step approximation to be valid.
+   */
+  class complexStepModel
+  {
+  public:
+    /**
+     * @brief fit method with complex parameter values.
+     *
+     * @param parameterValues arma::cx_rowvec with parameter values
+     * @param parameterLabels stringVector with parameterLabels
+     * @return std::complex<double> fit value
+     */
+    virtual std::complex<double> fitComplex(const arma::cx_rowvec &parameterValues,
+                                            const stringVector &parameterLabels) = 0;
+
+    virtual ~complexStepModel() = default;
+  };
+
+  /**
+   * @struct controlNumericalGradients
+   * @brief Allows you to adapt the settings of the numerical gradients
+   *
+   * @var differences type of the finite differences. See finiteDifferences.
+   * @var relativeStepSize step size relative to the scale of the parameter (max(|x_j|, 1)).
+   * If set to 0, the step size is chosen based on the type of the finite differences.
+   * @var nThreads number of threads used to evaluate the fit. If set to 0, the number of hardware threads is used.
+   * The model must implement clone() to use more than one thread.
+   */
+  struct controlNumericalGradients
+  {
+    finiteDifferences differences;
+    double relativeStepSize;
+    unsigned int nThreads;
+  };
+
+  /**
+   * @brief Returns the default settings for the numerical gradients
+   *
+   * @return controlNumericalGradients
+   */
+  inline controlNumericalGradients controlNumericalGradientsDefault()
+  {
+    controlNumericalGradients defaultIs = {
+        centralDifferences, // differences
+        0.0,                // relativeStepSize (0 = automatic)
+        0                   // nThreads (0 = hardware threads)
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @brief Wraps a model which only implements a meaningful fit function and approximates the
+   * gradients with finite differences. The wrapped model can then be passed to any of the
+   * optimizers. If the model implements clone(), the p perturbed fits are evaluated in parallel,
+   * each thread working on its own copy of the model. The copies are created when the gradients
+   * are computed for the first time; the model should therefore be fully set up before
+   * calling the optimizer. If the data of the wrapped model changes afterwards, call invalidate()
+   * so that the copies are recreated. Copies of the numericalGradientModel itself (see clone())
+   * evaluate the perturbed fits serially: they are used by callers which already parallelize
+   * over the copies (e.g., batch fitting).
+   */
+  class numericalGradientModel : public model
+  {
+  public:
+    /**
+     * @brief Construct a new numerical gradient model
+     *
+     * @param model_ the model object derived from the model class in model.h. Only fit is used.
+     * @param control_ settings for the numerical gradients
+     */
+    numericalGradientModel(model &model_,
+                           const controlNumericalGradients &control_ = controlNumericalGradientsDefault()) : baseModel(model_),
+                                                                                                             control(control_),
+#if USE_R
+                                                                                                             // Rcpp objects (e.g., the parameter labels) must not
+                                                                                                             // be copied outside of the main thread.
+                                                                                                             pool(1)
+#else
+                                                                                                             pool(control_.nThreads)
+#endif
+    {
+      differences = control.differences;
+      if ((differences == complexStep) && (dynamic_cast<complexStepModel *>(&baseModel) == nullptr))
+      {
+        warn("The model does not implement complexStepModel. Using central differences instead.\n");
+        differences = centralDifferences;
+      }
+    }
+
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      return (baseModel.fitFast(parameterValues, parameterLabels));
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      const unsigned int nParameters = parameterValues.n_elem;
+      arma::rowvec gradients_(nParameters);
+
+      prepareThreads();
+      const unsigned int nChunks = nModels();
+      workspace.resize(nChunks);
+      complexWorkspace.resize(nChunks);
+
+      double fit_x = 0.0;
+      if (differences == forwardDifferences)
+        fit_x = baseModel.fitFast(parameterValues, parameterLabels);
+
+      pool.parallelFor(
+          nParameters,
+          [&](const unsigned int j, const unsigned int chunk)
+          {
+            model &model_ = getModel(chunk);
+            const double scale = std::max(std::abs(parameterValues.at(j)), 1.0);
+
+            if (differences == complexStep)
+            {
+              arma::cx_rowvec &perturbed = complexWorkspace.at(chunk);
+              if (perturbed.n_elem != nParameters)
+                perturbed = arma::conv_to<arma::cx_rowvec>::from(parameterValues);
+
+              const double h = stepSize() * scale;
+              perturbed.at(j) = std::complex<double>(parameterValues.at(j), h);
+              gradients_.at(j) = std::imag(dynamic_cast<complexStepModel &>(model_).fitComplex(perturbed, parameterLabels.legacy())) / h;
+              perturbed.at(j) = std::complex<double>(parameterValues.at(j), 0.0);
+              return;
+            }
+
+            arma::rowvec &perturbed = workspace.at(chunk);
+            if (perturbed.n_elem != nParameters)
+              perturbed = parameterValues;
+
+            // make sure that the step can be represented exactly
+            volatile double stepped = parameterValues.at(j) + stepSize() * scale;
+            const double h = stepped - parameterValues.at(j);
+
+            perturbed.at(j) = parameterValues.at(j) + h;
+            const double fit_plus = model_.fitFast(perturbed, parameterLabels);
+
+            if (differences == forwardDifferences)
+            {
+              gradients_.at(j) = (fit_plus - fit_x) / h;
+            }
+            else
+            {
+              perturbed.at(j) = parameterValues.at(j) - h;
+              gradients_.at(j) = (fit_plus - model_.fitFast(perturbed, parameterLabels)) / (2.0 * h);
+            }
+            perturbed.at(j) = parameterValues.at(j);
+          },
+          nChunks);
+
+      // the workspaces must be reset for the next call because the parameter values change
+      for (arma::rowvec &perturbed : workspace)
+        perturbed.reset();
+      for (arma::cx_rowvec &perturbed : complexWorkspace)
+        perturbed.reset();
+
+      return (gradients_);
+    }
+
+    /**
+     * @brief removes the copies of the wrapped model. They are recreated from the current
+     * state of the wrapped model when the gradients are computed the next time.
+     * Must be called if the data of the wrapped model changes.
+     */
+    void invalidate()
+    {
+      clones.clear();
+      clonesPrepared = false;
+    }
+
+    std::unique_ptr<model> clone() const override
+    {
+      std::unique_ptr<model> baseClone = baseModel.clone();
+      if (!baseClone)
+        return (nullptr);
+      return (std::unique_ptr<model>(new numericalGradientModel(std::move(baseClone), control)));
+    }
+
+  private:
+    model &baseModel;
+    std::unique_ptr<model> ownedModel; // only used by clone()
+    const controlNumericalGradients control;
+    finiteDifferences differences;
+    threadPool pool;
+    std::vector<std::unique_ptr<model>> clones;
+    bool clonesPrepared = false;
+    std::vector<arma::rowvec> workspace;
+    std::vector<arma::cx_rowvec> complexWorkspace;
+
+    numericalGradientModel(std::unique_ptr<model> ownedModel_,
+                           const controlNumericalGradients &control_) : numericalGradientModel(*ownedModel_, serialControl(control_))
+    {
+      ownedModel = std::move(ownedModel_);
+    }
+
+    // copies run inside the threads of their caller; using a pool of their own
+    // would oversubscribe the hardware
+    static controlNumericalGradients serialControl(controlNumericalGradients control_)
+    {
+      control_.nThreads = 1;
+      return (control_);
+    }
+
+    double stepSize() const
+    {
+      if (control.relativeStepSize > 0.0)
+        return (control.relativeStepSize);
+      switch (differences)
+      {
+      case forwardDifferences:
+        return (std::sqrt(arma::datum::eps));
+      case centralDifferences:
+        return (std::cbrt(arma::datum::eps));
+      case complexStep:
+        // there is no subtractive cancellation; the step can be (almost) arbitrarily small
+        return (1e-20);
+      default:
+        error("Unknown finite differences.");
+      }
+      return (0.0);
+    }
+
+    // the calling thread uses the original model; all other threads use a copy
+    void prepareThreads()
+    {
+      if (clonesPrepared)
+        return;
+      clonesPrepared = true;
+      for (unsigned int i = 1; i < pool.size(); i++)
+      {
+        std::unique_ptr<model> modelCopy = baseModel.clone();
+        if (!modelCopy)
+        {
+          if (control.nThreads != 1)
+            warn("The model does not implement clone(). The numerical gradients are computed with a single thread.\n");
+          clones.clear();
+          return;
+        }
+        if ((differences == complexStep) && (dynamic_cast<complexStepModel *>(modelCopy.get()) == nullptr))
+          error("The copy of the model returned by clone() does not implement complexStepModel.");
+        clones.push_back(std::move(modelCopy));
+      }
+    }
+
+    unsigned int nModels() const
+    {
+      return (clones.size() + 1);
+    }
+
+    model &getModel(const unsigned int chunk)
+    {
+      if (chunk == 0)
+        return (baseModel);
+      return (*clones.at(chunk - 1));
+    }
+  };
+
+}
+#endif
@@ -0,0 +1,262 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include "common_headers.h"
+
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+
+// A small persistent thread pool. The threads are started once and wait for
+// tasks; this avoids the cost of creating new threads in each iteration of
+// an optimizer.
+//
+// Note: When using R, the tasks must not call any function of the R API
+// (including Rcpp::Rcout and Rcpp::checkUserInterrupt) because R is
+// single threaded.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief persistent pool of worker threads. Tasks are either submitted
+   * individually (submit) or as a parallel loop (parallelFor).
+   */
+  class threadPool
+  {
+  public:
+    /**
+     * @brief Construct a new thread pool
+     *
+     * @param nThreads_ total number of threads, including the thread calling parallelFor. If
+     * set to 0, the number of hardware threads is used.
+     */
+    threadPool(const unsigned int nThreads_ = 0)
+    {
+      nThreads = (nThreads_ > 0) ? nThreads_ : std::max(std::thread::hardware_concurrency(), 1u);
+      // the calling thread also works on the loops, so we only need nThreads - 1 workers
+      for (unsigned int i = 0; i + 1 < nThreads; i++)
+        workers.emplace_back([this]
+                             { workerLoop(); });
+    }
+
+    threadPool(const threadPool &) = delete;
+    threadPool &operator=(const threadPool &) = delete;
+
+    ~threadPool()
+    {
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        stopping = true;
+      }
+      queueCondition.notify_all();
+      for (std::thread &worker : workers)
+        worker.join();
+    }
+
+    /**
+     * @brief returns the total number of threads, including the calling thread
+     *
+     * @return unsigned int
+     */
+    unsigned int size() const
+    {
+      return (nThreads);
+    }
+
+    /**
+     * @brief add a task to the queue. If the pool has no worker threads, the task
+     * is executed immediately.
+     *
+     * @param task function to execute
+     * @return std::future<void> can be used to wait for the task. Exceptions thrown by
+     * the task are rethrown when calling get() on the future.
+     */
+    std::future<void> submit(std::function<void()> task)
+    {
+      auto packagedTask = std::make_shared<std::packaged_task<void()>>(std::move(task));
+      std::future<void> result = packagedTask->get_future();
+
+      if (workers.size() == 0)
+      {
+        (*packagedTask)();
+        return (result);
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        tasks.emplace([packagedTask]
+                      { (*packagedTask)(); });
+      }
+      queueCondition.notify_one();
+      return (result);
+    }
+
+    /**
+     * @brief calls body(i, chunk) for i = 0, ..., n-1. The indices are split into at most size()
+     * contiguous chunks; the first chunk is processed by the calling thread. All indices within one
+     * chunk are processed sequentially by the same thread, so chunk can be used to select
+     * per-thread resources (e.g., a copy of the model). The function returns after all indices
+     * have been processed.
+     *
+     * @param n number of indices
+     * @param body function with arguments index and chunk
+     * @param maxChunks maximal number of chunks (e.g., the number of available per-thread resources).
+     * If set to 0, size() is used.
+     */
+    void parallelFor(const unsigned int n,
+                     const std::function<void(unsigned int, unsigned int)> &body,
+                     const unsigned int maxChunks = 0)
+    {
+      if (n == 0)
+        return;
+
+      const unsigned int nChunks = std::min(n, (maxChunks > 0) ? std::min(maxChunks, nThreads) : nThreads);
+      const unsigned int chunkSize = (n + nChunks - 1) / nChunks;
+
+      auto runChunk = [&body, n, chunkSize](const unsigned int chunk)
+      {
+        const unsigned int last = std::min(n, (chunk + 1) * chunkSize);
+        for (unsigned int i = chunk * chunkSize; i < last; i++)
+          body(i, chunk);
+      };
+
+      std::vector<std::future<void>> results;
+      for (unsigned int chunk = 1; chunk < nChunks; chunk++)
+      {
+        if (chunk * chunkSize >= n)
+          break;
+        results.push_back(submit([&runChunk, chunk]
+                                 { runChunk(chunk); }));
+      }
+
+      // make sure that we wait for all chunks before rethrowing any exception
+      std::exception_ptr firstException = nullptr;
+      try
+      {
+        runChunk(0);
+      }
+      catch (...)
+      {
+        firstException = std::current_exception();
+      }
+      for (std::future<void> &result : results)
+      {
+        try
+        {
+          result.get();
+        }
+        catch (...)
+        {
+          if (!firstException)
+            firstException = std::current_exception();
+        }
+      }
+      if (firstException)
+        std::rethrow_exception(firstException);
+    }
+
+    /**
+     * @brief calls body(i, worker) for i = 0, ..., n-1. In contrast to parallelFor, the indices are
+     * handed out one at a time: each worker takes the next unprocessed index as soon as it is done with
+     * the previous one. This balances the load if the costs of the indices differ strongly (e.g., fits
+     * which converge at different speeds). The calling thread is worker 0; worker can be used to select
+     * per-thread resources. The order in which the indices are processed is not deterministic. After an
+     * exception, no new indices are started; the first exception is rethrown.
+     *
+     * @param n number of indices
+     * @param body function with arguments index and worker
+     * @param maxWorkers maximal number of workers (e.g., the number of available per-thread resources).
+     * If set to 0, size() is used.
+     */
+    void parallelForDynamic(const unsigned int n,
+                            const std::function<void(unsigned int, unsigned int)> &body,
+                            const unsigned int maxWorkers = 0)
+    {
+      if (n == 0)
+        return;
+
+      const unsigned int nWorkers = std::min(n, (maxWorkers > 0) ? std::min(maxWorkers, nThreads) : nThreads);
+      std::atomic<unsigned int> nextIndex(0);
+      std::atomic<bool> failed(false);
+
+      auto runWorker = [&body, &nextIndex, &failed, n](const unsigned int worker)
+      {
+        for (unsigned int i = nextIndex++; (i < n) && !failed; i = nextIndex++)
+        {
+          try
+          {
+            body(i, worker);
+          }
+          catch (...)
+          {
+            failed = true;
+            throw;
+          }
+        }
+      };
+
+      std::vector<std::future<void>> results;
+      for (unsigned int worker = 1; worker < nWorkers; worker++)
+        results.push_back(submit([&runWorker, worker]
+                                 { runWorker(worker); }));
+
+      // make sure that we wait for all workers before rethrowing any exception
+      std::exception_ptr firstException = nullptr;
+      try
+      {
+        runWorker(0);
+      }
+      catch (...)
+      {
+        firstException = std::current_exception();
+      }
+      for (std::future<void> &result : results)
+      {
+        try
+        {
+          result.get();
+        }
+        catch (...)
+        {
+          if (!firstException)
+            firstException = std::current_exception();
+        }
+      }
+      if (firstException)
+        std::rethrow_exception(firstException);
+    }
+
+  private:
+    unsigned int nThreads;
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+
+    void workerLoop()
+    {
+      for (;;)
+      {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(queueMutex);
+          queueCondition.wait(lock, [this]
+                              { return (stopping || !tasks.empty()); });
+          if (stopping && tasks.empty())
+            return;
+          task = std::move(tasks.front());
+          tasks.pop();
+        }
+        task();
+      }
+    }
+  };
+
+}
+#endif
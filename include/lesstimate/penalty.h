@@ -1,6 +1,7 @@
 #ifndef PENALTY_H
 #define PENALTY_H
 #include "common_headers.h"
+#include "labels.h"
 
 namespace lessSEM{
 
@@ -21,7 +22,7 @@ public:
    * @return double 
    */
   virtual double getValue(const arma::rowvec& parameterValues,
-                          const stringVector& parameterLabels,
+                          const labelHandle parameterLabels,
                           const T& tuningParameters) = 0;
 };
 }
@@ -0,0 +1,225 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+// the standard headers are included before common_headers.h because the latter defines error as a macro
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <fstream>
+#include <ostream>
+
+#include "common_headers.h"
+
+// Scoped timers for the phases of the optimizers (e.g., the inner iterations and
+// the line search of glmnet, the BFGS updates, and the calls to fit and gradients of
+// the model). The timers are only compiled if LESSTIMATE_PROFILE is defined before
+// including lesstimate:
+//
+// #define LESSTIMATE_PROFILE
+// #include <lesstimate.h>
+// ...
+// lessSEM::profiling::writeChromeTrace("trace.json");
+//
+// The trace can be opened in chrome://tracing or https://ui.perfetto.dev. Each
+// thread records its events into its own buffer; no locks are required while
+// recording. Without LESSTIMATE_PROFILE, the macros expand to nothing (or to the
+// expression itself for LESSTIMATE_PROFILE_CALL) and writeChromeTrace writes an empty trace.
+//
+// Note: writeChromeTrace and clearTrace must not be called while an optimizer is running.
+
+namespace lessSEM
+{
+  namespace profiling
+  {
+    /**
+     * @struct traceEvent
+     * @brief a single timed scope
+     *
+     * @var name name of the scope (must be a string literal)
+     * @var start start in microseconds since the profiler was created
+     * @var duration duration in microseconds
+     */
+    struct traceEvent
+    {
+      const char *name;
+      double start;
+      double duration;
+    };
+
+    /**
+     * @brief events recorded by a single thread
+     */
+    struct threadBuffer
+    {
+      unsigned int threadId;
+      std::vector<traceEvent> events;
+    };
+
+    /**
+     * @brief collects the buffers of all threads which recorded events
+     */
+    class profiler
+    {
+    public:
+      /**
+       * @brief returns the global profiler
+       *
+       * @return profiler&
+       */
+      static profiler &get()
+      {
+        static profiler profiler_;
+        return (profiler_);
+      }
+
+      /**
+       * @brief creates the buffer of a new thread. The buffer is kept after the thread ended.
+       *
+       * @return std::shared_ptr<threadBuffer>
+       */
+      std::shared_ptr<threadBuffer> registerThread()
+      {
+        std::unique_lock<std::mutex> lock(buffersMutex);
+        std::shared_ptr<threadBuffer> buffer = std::make_shared<threadBuffer>();
+        buffer->threadId = (unsigned int)buffers.size();
+        buffers.push_back(buffer);
+        return (buffer);
+      }
+
+      /**
+       * @brief microseconds since the profiler was created
+       *
+       * @return double
+       */
+      double now() const
+      {
+        return (std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count());
+      }
+
+      /**
+       * @brief writes all events in the Chrome trace event format
+       *
+       * @param stream output stream
+       */
+      void writeChromeTrace(std::ostream &stream)
+      {
+        std::unique_lock<std::mutex> lock(buffersMutex);
+        // time stamps are in microseconds; the fixed format avoids the exponential notation for long runs
+        const std::ios::fmtflags flags = stream.flags();
+        const std::streamsize precision = stream.precision();
+        stream.setf(std::ios::fixed);
+        stream.precision(3);
+        stream << "{\"traceEvents\":[";
+        bool first = true;
+        for (const std::shared_ptr<threadBuffer> &buffer : buffers)
+        {
+          for (const traceEvent &event : buffer->events)
+          {
+            if (!first)
+              stream << ",";
+            first = false;
+            stream << "\n{\"name\":\"" << event.name
+                   << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+                   << ",\"ts\":" << event.start
+                   << ",\"dur\":" << event.duration << "}";
+          }
+        }
+        stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        stream.flags(flags);
+        stream.precision(precision);
+      }
+
+      /**
+       * @brief removes all recorded events
+       */
+      void clear()
+      {
+        std::unique_lock<std::mutex> lock(buffersMutex);
+        for (const std::shared_ptr<threadBuffer> &buffer : buffers)
+          buffer->events.clear();
+      }
+
+    private:
+      profiler() : startTime(std::chrono::steady_clock::now()) {}
+
+      const std::chrono::steady_clock::time_point startTime;
+      std::mutex buffersMutex;
+      std::vector<std::shared_ptr<threadBuffer>> buffers;
+    };
+
+    /**
+     * @brief returns the buffer of the calling thread
+     *
+     * @return threadBuffer&
+     */
+    inline threadBuffer &localBuffer()
+    {
+      thread_local std::shared_ptr<threadBuffer> buffer = profiler::get().registerThread();
+      return (*buffer);
+    }
+
+    /**
+     * @brief records the time between construction and destruction
+     */
+    class scopedTimer
+    {
+    public:
+      /**
+       * @brief Construct a new scoped timer
+       *
+       * @param name_ name of the scope (must be a string literal)
+       */
+      explicit scopedTimer(const char *name_) : name(name_), start(profiler::get().now()) {}
+
+      scopedTimer(const scopedTimer &) = delete;
+      scopedTimer &operator=(const scopedTimer &) = delete;
+
+      ~scopedTimer()
+      {
+        localBuffer().events.push_back({name, start, profiler::get().now() - start});
+      }
+
+    private:
+      const char *name;
+      const double start;
+    };
+
+    /**
+     * @brief writes all recorded events to a file in the Chrome trace event format. Without
+     * LESSTIMATE_PROFILE, the trace is empty.
+     *
+     * @param fileName name of the file
+     */
+    inline void writeChromeTrace(const std::string &fileName)
+    {
+      std::ofstream file(fileName);
+      if (!file)
+        error("Could not open " + fileName + ".");
+      profiler::get().writeChromeTrace(file);
+    }
+
+    /**
+     * @brief removes all recorded events
+     */
+    inline void clearTrace()
+    {
+      profiler::get().clear();
+    }
+  }
+}
+
+#define LESSTIMATE_PROFILE_CONCAT_(a, b) a##b
+#define LESSTIMATE_PROFILE_CONCAT(a, b) LESSTIMATE_PROFILE_CONCAT_(a, b)
+
+#ifdef LESSTIMATE_PROFILE
+// times the enclosing scope
+#define LESSTIMATE_PROFILE_SCOPE(name) \
+  ::lessSEM::profiling::scopedTimer LESSTIMATE_PROFILE_CONCAT(lesstimateProfileScope, __LINE__)(name)
+// times the evaluation of an expression and returns its value
+#define LESSTIMATE_PROFILE_CALL(name, ...) \
+  ([&]() -> decltype(auto) { ::lessSEM::profiling::scopedTimer lesstimateProfileCall(name); return __VA_ARGS__; }())
+#else
+#define LESSTIMATE_PROFILE_SCOPE(name)
+#define LESSTIMATE_PROFILE_CALL(name, ...) (__VA_ARGS__)
+#endif
+
+#endif
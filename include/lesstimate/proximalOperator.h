@@ -1,6 +1,7 @@
 #ifndef PROXIMALOPERATOR_H
 #define PROXIMALOPERATOR_H
 #include "common_headers.h"
+#include "labels.h"
 
 namespace lessSEM{
   /**
@@ -23,9 +24,38 @@ public:
  */
   virtual arma::rowvec getParameters(const arma::rowvec& parameterValues, 
                                             const arma::rowvec& gradientValues,
-                                            const stringVector& parameterLabels,
+                                            const labelHandle parameterLabels,
                                             const double L,
                                             const T& tuningParameters) = 0;
+
+/**
+ * @brief write the parameters after updating with the proximal operator into 
+ * parameters_kp1. The optimizers use this function to avoid allocating memory in
+ * each iteration. The default implementation calls the function above; proximal 
+ * operators should override it with an implementation that writes directly into parameters_kp1.
+ * The function has its own name so that proximal operators which only override the function
+ * above do not hide it.
+ * 
+ * @param parameterValues current parameter values
+ * @param gradientValues current gradient values
+ * @param parameterLabels parameter labels
+ * @param L step length
+ * @param tuningParameters tuning parameters of the penalty function 
+ * @param parameters_kp1 will be overwritten with the updated parameters. May be 
+ * the same object as parameterValues
+ */
+  virtual void getParametersInPlace(const arma::rowvec& parameterValues, 
+                                    const arma::rowvec& gradientValues,
+                                    const labelHandle parameterLabels,
+                                    const double L,
+                                    const T& tuningParameters,
+                                    arma::rowvec& parameters_kp1){
+    parameters_kp1 = getParameters(parameterValues,
+                                   gradientValues,
+                                   parameterLabels,
+                                   L,
+                                   tuningParameters);
+  }
 };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,230 @@
+#ifndef REGULARIZATION_PATH_H
+#define REGULARIZATION_PATH_H
+// Regularized models are typically fitted for a sequence of lambda values (the
+// regularization path). The path is fitted from the first to the last lambda;
+// the parameter estimates and the Hessian approximation of each fit are used as
+// starting values for the next fit (warm starts). When the lambda values are
+// decreasing, the estimates change only little between neighboring values and
+// the optimizer converges in few iterations.
+
+#include "common_headers.h"
+
+#include <functional>
+#include "simplified_interfaces.h"
+
+namespace lessSEM
+{
+  /**
+   * @struct pathResults
+   * @brief The results of fitting a regularization path. Each element is stored as a single
+   * array with one entry per lambda value.
+   * @var lambda lambda values
+   * @var fit final fit value (regularized fit) for each lambda
+   * @var convergence 1 if the outer breaking condition was met, 0 otherwise
+   * @var parameterValues matrix with final parameter values. Column i holds the parameters for lambda(i)
+   */
+  struct pathResults
+  {
+    arma::rowvec lambda;
+    arma::colvec fit;
+    arma::uvec convergence;
+    arma::mat parameterValues;
+  };
+
+  /**
+   * @brief Fits a regularization path with the glmnet optimizer and the penalties of fitGlmnet. The
+   * penalties and the optimizer are set up once and reused for all lambda values and for all
+   * models passed to run. An object of this class must only be used by one thread at a time.
+   */
+  class glmnetPath
+  {
+  public:
+    /**
+     * @brief Construct a new glmnet path
+     *
+     * @param numberParameters number of parameters
+     * @param penalty vector with strings indicating the penalty for each parameter. See fitGlmnet.
+     * @param theta theta tuning parameter values. See fitGlmnet.
+     * @param initialHessian matrix with initial Hessian values.
+     * @param controlOptimizer option to change the optimizer settings
+     */
+    glmnetPath(const unsigned int numberParameters,
+               std::vector<std::string> penalty,
+               arma::rowvec theta,
+               arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+               controlGLMNET controlOptimizer = controlGlmnetDefault())
+    {
+      penalty = resizeVector(numberParameters, penalty);
+      theta = resizeVector(numberParameters, theta);
+
+      penalties = stringPenaltyToPenaltyType(penalty);
+
+      // If no Hessian is provided (1x1 matrix), the optimizer starts with a diagonal
+      // matrix and rescales it after the first step (see controlGLMNET.hessianScaling).
+      // The following lambda values are warm started with the Hessian of the previous fit.
+      // check if all elements are of equal length now:
+      std::vector<unsigned int> nElements{
+          (unsigned int)penalties.size(),
+          (unsigned int)theta.n_elem};
+      if (initialHessian.n_elem != 1)
+      {
+        nElements.push_back(initialHessian.n_rows);
+        nElements.push_back(initialHessian.n_cols);
+      }
+
+      if (!allEqual(nElements))
+      {
+        error("penalty, theta, nrow(initialHessian) and ncol(initialHessian) must all be of the same length.");
+      }
+
+      control = controlOptimizer;
+      control.initialHessian = initialHessian;
+      initialHessian_ = initialHessian;
+
+      std::vector<double> weights(numberParameters);
+      for (unsigned int i = 0; i < penalties.size(); i++)
+      {
+        weights.at(i) = (penalties.at(i) != penaltyType::none) ? 1.0 : 0.0;
+      }
+
+      tp.alpha = arma::rowvec(numberParameters, arma::fill::ones);
+      tp.lambda = arma::rowvec(numberParameters, arma::fill::zeros);
+      tp.penaltyType_ = penalties;
+      tp.theta = theta;
+      tp.weights = weights;
+
+      initializeMixedPenaltiesGlmnet(pen,
+                                     penalties);
+    }
+
+    /**
+     * @brief change the seed of the optimizer (see controlGLMNET)
+     *
+     * @param seed seed of the random number generator
+     */
+    void setSeed(const unsigned int seed)
+    {
+      control.seed = seed;
+    }
+
+    /**
+     * @brief fits the regularization path
+     *
+     * @param userModel your model. Must inherit from lessSEM::model!
+     * @param startingValues starting values for the first lambda
+     * @param parameterLabels a lessSEM::stringVector with labels for parameters
+     * @param lambdas lambda values. The same lambda is used for all regularized parameters. The
+     * path is fitted in the order of the lambda values; typically, these are decreasing.
+     * @param onFit called after each fit with the index of the lambda value and the fit results.
+     * The fit results are overwritten in the next step and must be copied if they are needed later.
+     */
+    void run(model &userModel,
+             const arma::rowvec &startingValues,
+             const stringVector &parameterLabels,
+             const arma::rowvec &lambdas,
+             const std::function<void(unsigned int, const fitResults &)> &onFit)
+    {
+      if (startingValues.n_elem != tp.weights.n_elem)
+        error("startingValues must have one element for each parameter.");
+
+      parameters_ = startingValues;
+      control.initialHessian = initialHessian_;
+
+      // each call may pass a new model; the copies of the model used by the speculative
+      // line search are created once per run and reused for all lambda values
+      optimizer.invalidateModelCopies();
+      optimizer.setReuseModelCopies(true);
+
+      for (unsigned int l = 0; l < lambdas.n_elem; l++)
+      {
+        // the remaining lambda values are skipped if the path was cancelled (see fit_progress.h)
+        if ((control.progress != nullptr) && control.progress->cancelled())
+          break;
+
+        tp.lambda.fill(lambdas.at(l));
+        optimizer.setControl(control);
+        optimizer.optimize(userModel,
+                           parameters_,
+                           parameterLabels,
+                           pen,
+                           smoothPen,
+                           tp,
+                           fitResults_);
+
+        onFit(l, fitResults_);
+
+        // warm starts for the next lambda
+        if (fitResults_.parameterValues.is_finite())
+          parameters_ = fitResults_.parameterValues;
+        if (fitResults_.Hessian.is_finite())
+          control.initialHessian = fitResults_.Hessian;
+      }
+    }
+
+  private:
+    std::vector<penaltyType> penalties;
+    controlGLMNET control;
+    arma::mat initialHessian_;
+    tuningParametersMixedGlmnet tp;
+    penaltyMixedGlmnet pen;
+    noSmoothPenalty<tuningParametersMixedGlmnet> smoothPen;
+    glmnetOptimizer optimizer;
+    fitResults fitResults_;
+    arma::rowvec parameters_;
+  };
+
+  /**
+   * @brief Fits a regularization path with the glmnet optimizer. The settings are identical to those of
+   * fitGlmnet, except for lambda.
+   *
+   * @param userModel your model. Must inherit from lessSEM::model!
+   * @param startingValues an arma::rowvec numeric vector with starting values for the first lambda
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty vector with strings indicating the penalty for each parameter. See fitGlmnet.
+   * @param lambdas lambda values. The same lambda is used for all regularized parameters. Typically, these are decreasing.
+   * @param theta theta tuning parameter values. See fitGlmnet.
+   * @param initialHessian matrix with initial Hessian values.
+   * @param controlOptimizer option to change the optimizer settings
+   * @return pathResults
+   */
+  inline pathResults fitGlmnetPath(
+      model &userModel,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      const arma::rowvec &lambdas,
+      arma::rowvec theta,
+      arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+      controlGLMNET controlOptimizer = controlGlmnetDefault())
+  {
+    pathResults pathResults_;
+    pathResults_.lambda = lambdas;
+    // the results of lambda values which are not fitted (e.g., after cancellation) remain NA
+    pathResults_.fit.set_size(lambdas.n_elem);
+    pathResults_.fit.fill(NA_REAL);
+    pathResults_.convergence.zeros(lambdas.n_elem);
+    pathResults_.parameterValues.set_size(startingValues.n_elem, lambdas.n_elem);
+    pathResults_.parameterValues.fill(NA_REAL);
+
+    glmnetPath path(startingValues.n_elem,
+                    penalty,
+                    theta,
+                    initialHessian,
+                    controlOptimizer);
+
+    path.run(userModel,
+             startingValues,
+             parameterLabels,
+             lambdas,
+             [&pathResults_](const unsigned int l, const fitResults &fitResults_)
+             {
+               pathResults_.fit.at(l) = fitResults_.fit;
+               pathResults_.convergence.at(l) = fitResults_.convergence;
+               pathResults_.parameterValues.col(l) = arma::trans(fitResults_.parameterValues);
+             });
+
+    return (pathResults_);
+  }
+
+}
+#endif
@@ -0,0 +1,1297 @@
+#ifndef REVERSE_COMMUNICATION_H
+#define REVERSE_COMMUNICATION_H
+// The optimizers call the fit and gradients functions of the model whenever they
+// need them. Sometimes, the caller wants to stay in control of the evaluations
+// instead (e.g., to evaluate the models of many fits together in one large matrix
+// operation or to run the evaluations on an own job system). The reverse
+// communication interface turns this around: The optimizer posts a request
+// ("evaluate the fit / gradients at these parameters") and returns to the caller.
+// The optimization is resumed when the caller provides the result.
+//
+// Example:
+//
+// std::vector<std::unique_ptr<lessSEM::reverseCommunicationFit>> fits;
+// for (...)
+//   fits.push_back(lessSEM::fitGlmnetReverse(startingValues, labels, penalty, lambda, theta));
+//
+// bool running = true;
+// while (running)
+// {
+//   running = false;
+//   // all fits with an open request can be evaluated together here
+//   for (std::unique_ptr<lessSEM::reverseCommunicationFit> &fit : fits)
+//   {
+//     if (fit->request() == lessSEM::fitRequest)
+//       fit->provideFit(myFit(fit->parameters()));
+//     else if (fit->request() == lessSEM::gradientsRequest)
+//       fit->provideGradients(myGradients(fit->parameters()));
+//     running = running || !fit->done();
+//   }
+// }
+// lessSEM::fitResults fitResults_ = fits.at(0)->result();
+//
+// The ista and glmnet optimizers are implemented as resumable state machines which
+// store the state of their loops between two requests; no threads are used. The fit
+// and the first request are computed in the constructor, provideFit and provideGradients
+// run the optimizer on the calling thread until it posts the next request or is finished.
+// Different fits are independent and can be resumed on different threads; a single fit
+// must only be used by one thread at a time.
+//
+// The steps are the same as those of fitGlmnet and fitIsta. If the fit and the gradients
+// only depend on the parameter values, the results are therefore identical. The fit and
+// the gradients at the step accepted by the line search (glmnet) or the inner iterations
+// (ista) are reused instead of being requested a second time. The following settings are
+// not supported: The duality gap convergence criteria require model::dualFit (error),
+// speculativeTrials is ignored, and the inner iterations of glmnet update one coordinate at
+// a time (parallelInnerUpdates is ignored).
+
+// the standard headers are included before common_headers.h because the latter defines error as a macro
+#include <memory>
+
+#include "common_headers.h"
+#include "simplified_interfaces.h"
+#include "diagnostics.h"
+#include "profiling.h"
+#include "fit_progress.h"
+
+namespace lessSEM
+{
+
+  /**
+   * Evaluation requested by an optimizer
+   */
+  enum evaluationRequest
+  {
+    noRequest,       /** The optimization is finished.*/
+    fitRequest,      /** The fit at parameters() is required. Resume with provideFit.*/
+    gradientsRequest /** The gradients at parameters() are required. Resume with provideGradients.*/
+  };
+  const std::vector<std::string> evaluationRequest_txt = {
+      "noRequest",
+      "fitRequest",
+      "gradientsRequest"};
+
+  /**
+   * @brief a fit which requests the evaluations of the model from the caller. The optimizer
+   * is implemented by the derived classes in step(). Only one thread may use an object of this
+   * class at a time.
+   */
+  class reverseCommunicationFit
+  {
+  public:
+    reverseCommunicationFit(const reverseCommunicationFit &) = delete;
+    reverseCommunicationFit &operator=(const reverseCommunicationFit &) = delete;
+    virtual ~reverseCommunicationFit() = default;
+
+    /**
+     * @brief returns the open request of the optimizer
+     *
+     * @return evaluationRequest
+     */
+    evaluationRequest request() const
+    {
+      return (request_);
+    }
+
+    /**
+     * @brief returns true if the optimization is finished (or failed)
+     *
+     * @return bool
+     */
+    bool done() const
+    {
+      return (request_ == noRequest);
+    }
+
+    /**
+     * @brief returns the parameters at which the optimizer requests the evaluation
+     *
+     * @return const arma::rowvec&
+     */
+    const arma::rowvec &parameters() const
+    {
+      if (done())
+        error("The optimization is finished; there is no open request.");
+      return (parameters_);
+    }
+
+    /**
+     * @brief answers a fitRequest and resumes the optimizer until the next request
+     *
+     * @param fit fit of the model at parameters()
+     */
+    void provideFit(const double fit)
+    {
+      if (request_ != fitRequest)
+        error("The optimizer did not request a fit.");
+      fit_ = fit;
+      resume();
+    }
+
+    /**
+     * @brief answers a gradientsRequest and resumes the optimizer until the next request
+     *
+     * @param gradients gradients of the model at parameters()
+     */
+    void provideGradients(const arma::rowvec &gradients)
+    {
+      if (request_ != gradientsRequest)
+        error("The optimizer did not request gradients.");
+      gradients_ = gradients;
+      resume();
+    }
+
+    /**
+     * @brief returns the results
+     *
+     * @return fitResults
+     */
+    fitResults result() const
+    {
+      if (failed)
+        error("The optimization failed.");
+      if (!done())
+        error("The optimization is not finished.");
+      return (fitResults_);
+    }
+
+  protected:
+    reverseCommunicationFit() = default;
+
+    fitResults fitResults_;
+
+    /**
+     * @brief runs the optimizer until it posts the next request with requestFit or
+     * requestGradients. Returning without a request finishes the optimization.
+     */
+    virtual void step() = 0;
+
+    /**
+     * @brief computes the first request. Must be called at the end of the constructor of the
+     * class implementing step().
+     */
+    void start()
+    {
+      resume();
+    }
+
+    void requestFit(const arma::rowvec &parameterValues)
+    {
+      request_ = fitRequest;
+      parameters_ = parameterValues;
+    }
+
+    void requestGradients(const arma::rowvec &parameterValues)
+    {
+      request_ = gradientsRequest;
+      parameters_ = parameterValues;
+    }
+
+    double providedFit() const
+    {
+      return (fit_);
+    }
+
+    const arma::rowvec &providedGradients() const
+    {
+      return (gradients_);
+    }
+
+  private:
+    evaluationRequest request_ = noRequest;
+    bool failed = false;
+    arma::rowvec parameters_;
+    double fit_ = 0.0;
+    arma::rowvec gradients_;
+
+    void resume()
+    {
+      request_ = noRequest;
+      try
+      {
+        step();
+      }
+      catch (...)
+      {
+        // errors of the optimizer end the optimization
+        request_ = noRequest;
+        failed = true;
+        throw;
+      }
+    }
+  };
+
+  /**
+   * @brief Reverse communication version of istaOptimizer::optimize. The penalties and tuning parameters
+   * are only referenced and must outlive the fit. See istaOptimizer for details on the arguments.
+   */
+  template <typename T, typename U> // T is the type of the tuning parameters
+  class istaReverseCommunication : public reverseCommunicationFit
+  {
+  public:
+    istaReverseCommunication(const arma::rowvec &startingValues_,
+                             const stringVector &parameterLabels_,
+                             proximalOperator<T> &proximalOperator__,
+                             penalty<T> &penalty__,
+                             smoothPenalty<U> &smoothPenalty__,
+                             const T &tuningParameters_,
+                             const U &smoothTuningParameters_,
+                             const control &control_ = controlDefault()) : startingValues(startingValues_),
+                                                                           parameterLabels(parameterLabels_),
+                                                                           proximalOperator_(proximalOperator__),
+                                                                           penalty_(penalty__),
+                                                                           smoothPenalty_(smoothPenalty__),
+                                                                           tuningParameters(tuningParameters_),
+                                                                           smoothTuningParameters(smoothTuningParameters_),
+                                                                           settings(control_),
+                                                                           diagnostics_(control_.verbose != 0),
+                                                                           rng(control_.seed)
+    {
+      if (settings.convCritOuter == dualityGapCrit)
+        error("The dualityGapCrit convergence criterion requires model::dualFit and is not available with reverse communication.");
+      start();
+    }
+
+  protected:
+    void step() override
+    {
+      LESSTIMATE_PROFILE_SCOPE("ista::reverseCommunication");
+      const control &control_ = settings;
+      diagnosticsScope diagnosticsScope_(&diagnostics_);
+
+      while (true)
+      {
+        switch (state)
+        {
+        case startOptimization:
+          if (control_.progress != nullptr)
+            control_.progress->startFit();
+
+          if (control_.verbose != 0)
+          {
+            print << "Optimizing with ista.\n"
+                  << "Using "
+                  << convCritInnerIsta_txt.at(control_.convCritInner)
+                  << " as inner convergence criterion\n"
+                  << "Using "
+                  << stepSizeInheritance_txt.at(control_.stepSizeIn)
+                  << " as step size inheritance\n"
+                  << "Tuning parameters: \n eta = "
+                  << control_.eta
+                  << "\n"
+                  << " accelerate = "
+                  << control_.accelerate
+                  << "\n"
+                  << " sigma = "
+                  << control_.sigma
+                  << "\n"
+                  << " breakOuter = "
+                  << control_.breakOuter
+                  << std::endl;
+          }
+
+          parameters_k = startingValues;
+          parameters_kMinus1 = startingValues;
+          parameters_kMinus2 = startingValues;
+          y_k = startingValues;
+          parameterChange.set_size(startingValues.n_elem);
+          gradientChange.set_size(startingValues.n_elem);
+
+          requestFit(startingValues);
+          state = initialFit;
+          return;
+
+        case initialFit:
+          fit_k = (1.0 / control_.sampleSize) * providedFit() +
+                  smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters);
+          fit_kMinus1 = fit_k;
+          penalty_k = 0.0;
+          penalizedFit_k = fit_k +
+                           penalty_.getValue(parameters_k, parameterLabels, tuningParameters);
+          penalizedFit_kMinus1 = fit_kMinus1 +
+                                 penalty_.getValue(parameters_kMinus1, parameterLabels, tuningParameters);
+
+          fits.set_size(control_.maxIterOut + 1);
+          fits.fill(arma::datum::nan);
+          fits(0) = penalizedFit_kMinus1;
+
+          requestGradients(parameters_k);
+          state = initialGradients;
+          return;
+
+        case initialGradients:
+          gradients_k = (1.0 / control_.sampleSize) * providedGradients() +
+                        smoothPenalty_.getGradients(parameters_k, parameterLabels, smoothTuningParameters);
+          gradients_kMinus1 = gradients_k;
+          gradient_y_k = gradients_k;
+
+          breakInner = false;
+          breakOuter = false;
+          L_kMinus1 = control_.L0;
+          L_k = control_.L0;
+          outer_iteration = 0;
+          state = outerIteration;
+          break;
+
+        case outerIteration:
+          if (outer_iteration >= control_.maxIterOut)
+          {
+            state = finishOptimization;
+            break;
+          }
+          // check if user wants to stop the computation:
+#if USE_R
+          Rcpp::checkUserInterrupt();
+#endif
+          inner_iteration = 0;
+          innerGradientsAccepted = false;
+          state = innerIteration;
+          break;
+
+        case innerIteration:
+          if (inner_iteration >= control_.maxIterIn)
+          {
+            state = innerIterationsFinished;
+            break;
+          }
+          // inner iteration: reduce step size until the convergence criterion is met
+          L_k = std::pow(control_.eta, inner_iteration) * L_kMinus1;
+
+          if (control_.accelerate)
+          {
+            // the proximal operator is applied at the extrapolated point y_k
+            y_k = parameters_kMinus1 +
+                  (inner_iteration / (inner_iteration + 3)) * (parameters_kMinus1 - parameters_kMinus2);
+            requestGradients(y_k);
+            state = innerGradientsY;
+            return;
+          }
+
+          proximalOperator_.getParametersInPlace(parameters_kMinus1,
+                                                 gradients_kMinus1,
+                                                 parameterLabels,
+                                                 L_k,
+                                                 tuningParameters,
+                                                 parameters_k);
+          requestFit(parameters_k);
+          state = innerFit;
+          return;
+
+        case innerGradientsY:
+          gradient_y_k = (1.0 / control_.sampleSize) * providedGradients() +
+                         smoothPenalty_.getGradients(y_k, parameterLabels, smoothTuningParameters);
+          proximalOperator_.getParametersInPlace(y_k,
+                                                 gradient_y_k,
+                                                 parameterLabels,
+                                                 L_k,
+                                                 tuningParameters,
+                                                 parameters_k);
+          requestFit(parameters_k);
+          state = innerFit;
+          return;
+
+        case innerFit:
+          fit_k = (1.0 / control_.sampleSize) * providedFit() +
+                  smoothPenalty_.getValue(parameters_k, parameterLabels, smoothTuningParameters);
+          state = innerIteration;
+
+          if (!arma::is_finite(fit_k))
+          {
+            inner_iteration++;
+            break;
+          }
+
+          penalty_k = penalty_.getValue(parameters_k,
+                                        parameterLabels,
+                                        tuningParameters);
+          penalizedFit_k = fit_k + penalty_k;
+
+          if (!arma::is_finite(penalizedFit_k))
+          {
+            inner_iteration++;
+            break;
+          }
+
+          // see istaOptimizer::optimize for the convergence criteria
+          if (control_.convCritInner == istaCrit)
+          {
+            parameterChange = parameters_k - parameters_kMinus1;
+            quadr = arma::dot(parameterChange, parameterChange);
+            parchTimeGrad = arma::dot(parameterChange, gradients_kMinus1);
+
+            breakInner = penalizedFit_k <= (fit_kMinus1 +
+                                            parchTimeGrad +
+                                            (L_k / 2.0) * quadr +
+                                            penalty_k);
+          }
+          else if (control_.convCritInner == gistCrit)
+          {
+            parameterChange = parameters_k - parameters_kMinus1;
+            quadr = arma::dot(parameterChange, parameterChange);
+
+            breakInner = penalizedFit_k <= (penalizedFit_kMinus1 -
+                                            L_k * (control_.sigma / 2.0) * quadr);
+          }
+
+          if (breakInner)
+          {
+            requestGradients(parameters_k);
+            state = innerGradients;
+            return;
+          }
+          inner_iteration++;
+          break;
+
+        case innerGradients:
+          gradients_k = (1.0 / control_.sampleSize) * providedGradients() +
+                        smoothPenalty_.getGradients(parameters_k, parameterLabels, smoothTuningParameters);
+
+          // if any of the gradients is non-finite, we skip to a smaller step size
+          if (!arma::is_finite(gradients_k))
+          {
+            inner_iteration++;
+            state = innerIteration;
+            break;
+          }
+          innerGradientsAccepted = true;
+          state = innerIterationsFinished;
+          break;
+
+        case innerIterationsFinished:
+          if ((control_.verbose > 0) && (outer_iteration % control_.verbose == 0))
+          {
+            print << "Fit in iteration outer_iteration " << outer_iteration + 1 << ": " << penalizedFit_k << " (" << fit_k << " + " << penalty_k << ")" << std::endl;
+            print << parameters_k << std::endl;
+          }
+
+          if ((!breakInner) && (control_.verbose < 0))
+          {
+            reportDiagnostic(innerIterationsFailed);
+            L_kMinus1 = control_.L0;
+            outer_iteration++;
+            state = outerIteration;
+            break;
+          }
+
+          // the gradients at the accepted step are already known
+          if (innerGradientsAccepted)
+          {
+            state = outerConvergence;
+            break;
+          }
+          requestGradients(parameters_k);
+          state = outerGradients;
+          return;
+
+        case outerGradients:
+          gradients_k = (1.0 / control_.sampleSize) * providedGradients() +
+                        smoothPenalty_.getGradients(parameters_k, parameterLabels, smoothTuningParameters);
+          state = outerConvergence;
+          break;
+
+        case outerConvergence:
+          fits(outer_iteration + 1) = penalizedFit_k;
+          breakOuter = std::abs(fits(outer_iteration + 1) - fits(outer_iteration)) < control_.breakOuter;
+
+          // report the progress; stops if the fit was cancelled
+          if (control_.progress != nullptr)
+          {
+            control_.progress->report(outer_iteration + 1, control_.sampleSize * penalizedFit_k, parameters_k); // rescale for -2log-Likelihood
+            if (control_.progress->cancelled())
+            {
+              state = finishOptimization;
+              break;
+            }
+          }
+
+          if (breakOuter)
+          {
+            state = finishOptimization;
+            break;
+          }
+
+          // define new initial step size
+          if (control_.stepSizeIn == initial)
+          {
+            L_kMinus1 = control_.L0;
+          }
+          else if (control_.stepSizeIn == barzilaiBorwein ||
+                   control_.stepSizeIn == stochasticBarzilaiBorwein)
+          {
+            parameterChange = parameters_k - parameters_kMinus1;
+            gradientChange = gradients_k - gradients_kMinus1;
+
+            quadr = arma::dot(parameterChange, parameterChange);
+            parchTimeGrad = arma::dot(parameterChange, gradientChange);
+
+            L_kMinus1 = parchTimeGrad / quadr;
+
+            if (L_kMinus1 < 1e-10 || L_kMinus1 > 1e10)
+              L_kMinus1 = control_.L0;
+
+            if ((control_.stepSizeIn == stochasticBarzilaiBorwein) &&
+                (rng.uniform() < 0.25))
+            {
+              L_kMinus1 = control_.L0; // reset with 25% probability
+            }
+          }
+          else if (control_.stepSizeIn == istaStepInheritance)
+          {
+            L_kMinus1 = L_k;
+          }
+          else
+          {
+            error("Unknown step inheritance.");
+          }
+
+          fit_kMinus1 = fit_k;
+          penalizedFit_kMinus1 = penalizedFit_k;
+          parameters_kMinus2 = parameters_kMinus1;
+          parameters_kMinus1 = parameters_k;
+          gradients_kMinus1 = gradients_k;
+          outer_iteration++;
+          state = outerIteration;
+          break;
+
+        case finishOptimization:
+          fitResults_.convergence = breakOuter;
+          fitResults_.fit = control_.sampleSize * penalizedFit_k; // rescale for -2log-Likelihood
+          fitResults_.fits = control_.sampleSize * fits;          // rescale for -2log-Likelihood
+          fitResults_.parameterValues = parameters_k;
+          fitResults_.dualityGap = arma::datum::nan;
+          fitResults_.warningCounts = diagnostics_.getCounts();
+          diagnostics_.summarize();
+
+          if (control_.progress != nullptr)
+            control_.progress->finishFit();
+          state = optimizationFinished;
+          return;
+
+        case optimizationFinished:
+          return;
+        }
+      }
+    }
+
+  private:
+    // position of the optimizer in the loops of istaOptimizer::optimize
+    enum istaState
+    {
+      startOptimization,
+      initialFit,
+      initialGradients,
+      outerIteration,
+      innerIteration,
+      innerGradientsY,
+      innerFit,
+      innerGradients,
+      innerIterationsFinished,
+      outerGradients,
+      outerConvergence,
+      finishOptimization,
+      optimizationFinished
+    };
+
+    const arma::rowvec startingValues;
+    const stringVector parameterLabels;
+    proximalOperator<T> &proximalOperator_;
+    penalty<T> &penalty_;
+    smoothPenalty<U> &smoothPenalty_;
+    const T &tuningParameters;
+    const U &smoothTuningParameters;
+    const control settings;
+    diagnostics diagnostics_;
+    randomNumberGenerator rng; // for stochastic Barzilai Borwein
+
+    // the local variables of the loops are kept between two requests
+    istaState state = startOptimization;
+    int outer_iteration = 0, inner_iteration = 0;
+    bool breakInner = false, breakOuter = false, innerGradientsAccepted = false;
+    double L_kMinus1 = 0.0, L_k = 0.0;
+    double fit_k = 0.0, fit_kMinus1 = 0.0, penalty_k = 0.0;
+    double penalizedFit_k = 0.0, penalizedFit_kMinus1 = 0.0;
+    double quadr = 0.0, parchTimeGrad = 0.0;
+    arma::rowvec parameters_k, parameters_kMinus1, parameters_kMinus2, y_k;
+    arma::rowvec parameterChange, gradientChange;
+    arma::rowvec gradients_k, gradients_kMinus1, gradient_y_k;
+    arma::rowvec fits;
+  };
+
+  /**
+   * @brief Reverse communication version of glmnetOptimizer::optimize. The penalties and tuning parameters
+   * are only referenced and must outlive the fit. See glmnetOptimizer for details on the arguments.
+   */
+  template <typename nonsmoothPenalty, typename smoothPenalty,
+            typename tuning>
+  class glmnetReverseCommunication : public reverseCommunicationFit
+  {
+  public:
+    glmnetReverseCommunication(const arma::rowvec &startingValues_,
+                               const stringVector &parameterLabels_,
+                               nonsmoothPenalty &penalty__,
+                               smoothPenalty &smoothPenalty__,
+                               const tuning &tuningParameters_,
+                               const controlGLMNET &control_ = controlGlmnetDefault()) : startingValues(startingValues_),
+                                                                                         parameterLabels(parameterLabels_),
+                                                                                         penalty_(penalty__),
+                                                                                         smoothPenalty_(smoothPenalty__),
+                                                                                         tuningParameters(tuningParameters_),
+                                                                                         control(control_),
+                                                                                         diagnostics_(control_.verbose != 0),
+                                                                                         selector(control_.coordinateOrder, control_.seed)
+    {
+      if (control.convergenceCriterion == dualityGap)
+        error("The dualityGap convergence criterion requires model::dualFit and is not available with reverse communication.");
+      if (control.lineSearch == strongWolfe)
+        error("The strongWolfe line search requires a differentiable objective and is only available for bfgsOptim.");
+      start();
+    }
+
+  protected:
+    void step() override
+    {
+      LESSTIMATE_PROFILE_SCOPE("glmnet::reverseCommunication");
+      const controlGLMNET &control_ = control;
+      diagnosticsScope diagnosticsScope_(&diagnostics_);
+
+      while (true)
+      {
+        switch (state)
+        {
+        case startOptimization:
+          if (control_.progress != nullptr)
+            control_.progress->startFit();
+
+          if (control_.verbose != 0)
+          {
+            print << "Optimizing with glmnet.\n";
+          }
+
+          parameters_k = startingValues;
+          parameters_kMinus1 = startingValues;
+          direction.zeros(startingValues.n_elem);
+          stepSize_k = 1.0;
+
+          requestFit(parameters_kMinus1);
+          state = initialFit;
+          return;
+
+        case initialFit:
+          fit_kMinus1 = providedFit() +
+                        smoothPenalty_.getValue(parameters_kMinus1,
+                                                parameterLabels,
+                                                tuningParameters);
+          fit_k = fit_kMinus1;
+          penalizedFit_kMinus1 = fit_kMinus1 +
+                                 penalty_.getValue(parameters_kMinus1,
+                                                   parameterLabels,
+                                                   tuningParameters);
+          penalizedFit_k = penalizedFit_kMinus1;
+
+          fits.set_size(control_.maxIterOut + 1);
+          fits.fill(NA_REAL);
+          fits(0) = penalizedFit_kMinus1;
+
+          requestGradients(parameters_kMinus1);
+          state = initialGradients;
+          return;
+
+        case initialGradients:
+          gradients_kMinus1 = providedGradients() +
+                              smoothPenalty_.getGradients(parameters_kMinus1,
+                                                          parameterLabels,
+                                                          tuningParameters);
+          gradients_k = gradients_kMinus1;
+
+          scaleHessian = (control_.initialHessian.n_elem == 1) &&
+                         (control_.hessianScaling != noHessianScaling);
+          if ((control_.initialHessian.n_cols == 1) && (control_.initialHessian.n_rows == 1))
+          {
+            Hessian_kMinus1.zeros(startingValues.n_elem, startingValues.n_elem);
+            Hessian_kMinus1.diag().fill(control_.initialHessian(0, 0));
+          }
+          else
+          {
+            Hessian_kMinus1 = control_.initialHessian;
+          }
+          Hessian_k = Hessian_kMinus1;
+
+          if (control_.convergenceCriterion == convergenceCriteriaGlmnet::kkt)
+            kktTolerance = control_.breakKKTAbsolute +
+                           control_.breakKKTRelative * glmnetKKTResidual(penalty_,
+                                                                         parameters_kMinus1,
+                                                                         gradients_kMinus1,
+                                                                         Hessian_kMinus1,
+                                                                         tuningParameters,
+                                                                         zeroDirection);
+
+          breakOuter = false;
+          outer_iteration = 0;
+          state = outerIteration;
+          break;
+
+        case outerIteration:
+          if (outer_iteration >= control_.maxIterOut)
+          {
+            state = finishOptimization;
+            break;
+          }
+          // check if user wants to stop the computation:
+#if USE_R
+          Rcpp::checkUserInterrupt();
+#endif
+
+          // find step direction
+          glmnetInner(parameters_kMinus1,
+                      gradients_kMinus1,
+                      Hessian_kMinus1,
+                      penalty_,
+                      tuningParameters,
+                      control_.maxIterIn,
+                      control_.breakInner,
+                      control_.verbose,
+                      selector,
+                      innerWorkspace,
+                      direction);
+
+          startLineSearch();
+          state = lineSearchTrial;
+          break;
+
+        case lineSearchTrial:
+          // see glmnetLineSearch
+          if (lineSearchIteration >= control_.maxIterLine)
+          {
+            stepSize_k = currentStepSize;
+            requestGradients(parameters_k);
+            state = outerGradients;
+            return;
+          }
+          if (!interpolate)
+            currentStepSize = std::pow(control_.stepSize, lineSearchIteration);
+
+          parameters_k = parameters_kMinus1 + currentStepSize * direction;
+          requestFit(parameters_k);
+          state = lineSearchFit;
+          return;
+
+        case lineSearchFit:
+          fit_k = providedFit() +
+                  smoothPenalty_.getValue(parameters_k,
+                                          parameterLabels,
+                                          tuningParameters);
+          state = lineSearchTrial;
+
+          if (!arma::is_finite(fit_k))
+          {
+            // try a smaller step size
+            currentStepSize *= control_.stepSize;
+            hasPrevious = false;
+            lineSearchIteration++;
+            break;
+          }
+
+          f_k = fit_k + penalty_.getValue(parameters_k,
+                                          parameterLabels,
+                                          tuningParameters);
+
+          if (f_k - f_0 <= control_.sigma * currentStepSize * compareTo)
+          {
+            // check if gradients can be computed at the new location
+            requestGradients(parameters_k);
+            state = lineSearchGradients;
+            return;
+          }
+
+          if (interpolate)
+          {
+            const double nextStepSize = interpolateStepSize(currentStepSize,
+                                                            f_k - f_0,
+                                                            previousStepSize,
+                                                            phi_previous,
+                                                            hasPrevious,
+                                                            compareTo);
+            previousStepSize = currentStepSize;
+            phi_previous = f_k - f_0;
+            hasPrevious = true;
+            currentStepSize = nextStepSize;
+          }
+          lineSearchIteration++;
+          break;
+
+        case lineSearchGradients:
+          if (!arma::is_finite(providedGradients()))
+          {
+            // try a smaller step size
+            currentStepSize *= control_.stepSize;
+            hasPrevious = false;
+            lineSearchIteration++;
+            state = lineSearchTrial;
+            break;
+          }
+          stepSize_k = currentStepSize;
+
+          // the fit and the gradients at the accepted step are already known
+          gradients_k = providedGradients() +
+                        smoothPenalty_.getGradients(parameters_k,
+                                                    parameterLabels,
+                                                    tuningParameters);
+          state = outerConvergence;
+          break;
+
+        case outerGradients:
+          gradients_k = providedGradients() +
+                        smoothPenalty_.getGradients(parameters_k,
+                                                    parameterLabels,
+                                                    tuningParameters);
+          requestFit(parameters_k);
+          state = outerFit;
+          return;
+
+        case outerFit:
+          fit_k = providedFit() +
+                  smoothPenalty_.getValue(parameters_k,
+                                          parameterLabels,
+                                          tuningParameters);
+          state = outerConvergence;
+          break;
+
+        case outerConvergence:
+          checkConvergence();
+
+          // report the progress; stops if the fit was cancelled
+          if (control_.progress != nullptr)
+          {
+            control_.progress->report(outer_iteration + 1, penalizedFit_k, parameters_k);
+            if (control_.progress->cancelled())
+            {
+              state = finishOptimization;
+              break;
+            }
+          }
+
+          if (breakOuter)
+          {
+            state = finishOptimization;
+            break;
+          }
+
+          fit_kMinus1 = fit_k;
+          penalizedFit_kMinus1 = penalizedFit_k;
+          parameters_kMinus1 = parameters_k;
+          gradients_kMinus1 = gradients_k;
+          Hessian_kMinus1 = Hessian_k;
+          outer_iteration++;
+          state = outerIteration;
+          break;
+
+        case finishOptimization:
+          // fits cancelled by the user are not reported as convergence failures
+          if (!breakOuter && !((control_.progress != nullptr) && control_.progress->cancelled()))
+          {
+            reportDiagnostic(outerIterationsNotConverged);
+          }
+
+          fitResults_.convergence = breakOuter;
+          fitResults_.fit = penalizedFit_k;
+          fitResults_.fits = fits;
+          fitResults_.parameterValues = parameters_k;
+          fitResults_.Hessian = Hessian_k;
+          fitResults_.dualityGap = arma::datum::nan;
+          fitResults_.warningCounts = diagnostics_.getCounts();
+          diagnostics_.summarize();
+
+          if (control_.progress != nullptr)
+            control_.progress->finishFit();
+          state = optimizationFinished;
+          return;
+
+        case optimizationFinished:
+          return;
+        }
+      }
+    }
+
+  private:
+    // position of the optimizer in the loops of glmnetOptimizer::optimize and glmnetLineSearch
+    enum glmnetState
+    {
+      startOptimization,
+      initialFit,
+      initialGradients,
+      outerIteration,
+      lineSearchTrial,
+      lineSearchFit,
+      lineSearchGradients,
+      outerGradients,
+      outerFit,
+      outerConvergence,
+      finishOptimization,
+      optimizationFinished
+    };
+
+    const arma::rowvec startingValues;
+    const stringVector parameterLabels;
+    nonsmoothPenalty &penalty_;
+    smoothPenalty &smoothPenalty_;
+    const tuning &tuningParameters;
+    const controlGLMNET control;
+    diagnostics diagnostics_;
+    coordinateSelector selector;
+    glmnetInnerWorkspace innerWorkspace; // one coordinate is updated at a time
+
+    // the local variables of the loops are kept between two requests
+    glmnetState state = startOptimization;
+    int outer_iteration = 0;
+    bool breakOuter = false, scaleHessian = false;
+    double fit_k = 0.0, fit_kMinus1 = 0.0;
+    double penalizedFit_k = 0.0, penalizedFit_kMinus1 = 0.0;
+    double kktTolerance = 0.0;
+    arma::rowvec parameters_k, parameters_kMinus1, direction, zeroDirection;
+    arma::rowvec gradients_k, gradients_kMinus1;
+    arma::mat Hessian_k, Hessian_kMinus1, HessianTimesD;
+    arma::rowvec fits;
+
+    // state of the line search
+    int lineSearchIteration = 0;
+    bool interpolate = false, hasPrevious = false;
+    double stepSize_k = 1.0, currentStepSize = 1.0, previousStepSize = 0.0, phi_previous = 0.0;
+    double f_0 = 0.0, f_k = 0.0, compareTo = 0.0;
+
+    // computes the parts of the line search criterion which do not depend on the step size
+    void startLineSearch()
+    {
+      const controlGLMNET &control_ = control;
+
+      const double pen_0 = penalty_.getValue(parameters_kMinus1,
+                                             parameterLabels,
+                                             tuningParameters);
+      f_0 = fit_kMinus1 + pen_0;
+      parameters_k = parameters_kMinus1 + direction;
+      const double pen_d = penalty_.getValue(parameters_k,
+                                             parameterLabels,
+                                             tuningParameters);
+      parameters_k.fill(arma::datum::nan);
+
+      // see Equation 20 in Yuan et al. (2012) and glmnetLineSearch
+      compareTo = arma::dot(gradients_kMinus1, direction) + pen_d - pen_0;
+      if (control_.gamma != 0.0)
+        compareTo += control_.gamma * arma::as_scalar(direction * Hessian_kMinus1 * arma::trans(direction));
+
+      interpolate = (control_.lineSearch == interpolation) && (compareTo < 0.0);
+      currentStepSize = interpolate ? initialTrialStepSize(stepSize_k, control_.stepSize) : 1.0;
+      previousStepSize = 0.0;
+      phi_previous = 0.0;
+      hasPrevious = false;
+      lineSearchIteration = 0;
+    }
+
+    // updates the Hessian and checks the convergence criterion after the step of the outer iteration
+    void checkConvergence()
+    {
+      const controlGLMNET &control_ = control;
+
+      penalizedFit_k = fit_k +
+                       penalty_.getValue(parameters_k,
+                                         parameterLabels,
+                                         tuningParameters);
+
+      fits(outer_iteration + 1) = penalizedFit_k;
+
+      if (control_.verbose > 0 && outer_iteration % control_.verbose == 0)
+      {
+        print << "Fit in iteration outer_iteration "
+              << outer_iteration + 1
+              << ": "
+              << penalizedFit_k
+              << "\n"
+              << parameters_k
+              << "\n";
+      }
+
+      if (scaleHessian && (outer_iteration == 0))
+        scaleInitialHessian(control_.hessianScaling,
+                            parameters_kMinus1,
+                            gradients_kMinus1,
+                            parameters_k,
+                            gradients_k,
+                            Hessian_kMinus1);
+
+      updateBFGS(
+          parameters_kMinus1,
+          gradients_kMinus1,
+          Hessian_kMinus1,
+          parameters_k,
+          gradients_k,
+          true,
+          .001,
+          control_.verbose == -99,
+          Hessian_k,
+          HessianTimesD);
+
+      if (control_.convergenceCriterion == GLMNET)
+      {
+        breakOuter = maxDiagonalDecrease(Hessian_k, direction) < control_.breakOuter;
+      }
+      if (control_.convergenceCriterion == fitChange)
+      {
+        breakOuter = std::abs(fits(outer_iteration + 1) -
+                              fits(outer_iteration)) <
+                     control_.breakOuter;
+      }
+      if (control_.convergenceCriterion == gradients)
+      {
+        arma::rowvec subGradients = penalty_.getSubgradients(
+            parameters_k,
+            gradients_k,
+            tuningParameters);
+
+        breakOuter = arma::sum(arma::abs(subGradients) < control_.breakOuter) ==
+                     subGradients.n_elem;
+      }
+      if (control_.convergenceCriterion == convergenceCriteriaGlmnet::kkt)
+      {
+        breakOuter = glmnetKKTResidual(penalty_,
+                                       parameters_k,
+                                       gradients_k,
+                                       Hessian_k,
+                                       tuningParameters,
+                                       zeroDirection) <= kktTolerance;
+      }
+    }
+  };
+
+  // owns the penalties of fitGlmnetReverse. Used as first base class of glmnetReverseFit
+  // so that the penalties are initialized before the optimizer which refers to them.
+  struct glmnetReversePenalties
+  {
+    tuningParametersMixedGlmnet tp;
+    penaltyMixedGlmnet pen;
+    noSmoothPenalty<tuningParametersMixedGlmnet> smoothPen;
+
+    glmnetReversePenalties(const stringVector &parameterLabels,
+                           const unsigned int numberParameters,
+                           std::vector<std::string> penalty,
+                           arma::rowvec lambda,
+                           arma::rowvec theta,
+                           const arma::mat &initialHessian,
+                           const int verbose)
+    {
+      penalty = resizeVector(numberParameters, penalty);
+      lambda = resizeVector(numberParameters, lambda);
+      theta = resizeVector(numberParameters, theta);
+
+      std::vector<penaltyType> penalties = stringPenaltyToPenaltyType(penalty);
+
+      std::vector<unsigned int> nElements{
+          (unsigned int)penalties.size(),
+          (unsigned int)lambda.n_elem,
+          (unsigned int)theta.n_elem};
+      if (initialHessian.n_elem != 1)
+      {
+        nElements.push_back(initialHessian.n_rows);
+        nElements.push_back(initialHessian.n_cols);
+      }
+
+      if (!allEqual(nElements))
+      {
+        error("penalty, regularized, lambda, theta, alpha, nrow(initialHessian) and ncol(initialHessian) must all be of the same length.");
+      }
+
+      std::vector<double> weights(numberParameters);
+      for (unsigned int i = 0; i < penalties.size(); i++)
+      {
+        weights.at(i) = (penalties.at(i) != penaltyType::none) ? 1.0 : 0.0;
+      }
+
+      if (verbose)
+        printPenaltyDetails(
+            parameterLabels,
+            penalties,
+            lambda,
+            theta);
+
+      tp.alpha = arma::rowvec(numberParameters, arma::fill::ones);
+      tp.lambda = lambda;
+      tp.penaltyType_ = penalties;
+      tp.theta = theta;
+      tp.weights = weights;
+
+      initializeMixedPenaltiesGlmnet(pen,
+                                     penalties);
+    }
+  };
+
+  class glmnetReverseFit : private glmnetReversePenalties,
+                           public glmnetReverseCommunication<penaltyMixedGlmnet,
+                                                             noSmoothPenalty<tuningParametersMixedGlmnet>,
+                                                             tuningParametersMixedGlmnet>
+  {
+  public:
+    glmnetReverseFit(const arma::rowvec &startingValues,
+                     const stringVector &parameterLabels,
+                     const std::vector<std::string> &penalty,
+                     const arma::rowvec &lambda,
+                     const arma::rowvec &theta,
+                     const controlGLMNET &controlOptimizer,
+                     const int verbose) : glmnetReversePenalties(parameterLabels,
+                                                                 startingValues.n_elem,
+                                                                 penalty,
+                                                                 lambda,
+                                                                 theta,
+                                                                 controlOptimizer.initialHessian,
+                                                                 verbose),
+                                          glmnetReverseCommunication(startingValues,
+                                                                     parameterLabels,
+                                                                     pen,
+                                                                     smoothPen,
+                                                                     tp,
+                                                                     controlOptimizer)
+    {
+    }
+  };
+
+  // owns the penalties of fitIstaReverse. Used as first base class of istaReverseFit
+  // so that the penalties are initialized before the optimizer which refers to them.
+  struct istaReversePenalties
+  {
+    tuningParametersMixedPenalty tp;
+    tuningParametersEnet smoothTp;
+    proximalOperatorMixedPenalty proxOp;
+    penaltyMixedPenalty pen;
+    penaltyRidge smoothPen;
+
+    istaReversePenalties(const stringVector &parameterLabels,
+                         const unsigned int numberParameters,
+                         std::vector<std::string> penalty,
+                         arma::rowvec lambda,
+                         arma::rowvec theta,
+                         const int verbose)
+    {
+      penalty = resizeVector(numberParameters, penalty);
+      lambda = resizeVector(numberParameters, lambda);
+      theta = resizeVector(numberParameters, theta);
+
+      std::vector<penaltyType> penalties = stringPenaltyToPenaltyType(penalty);
+
+      std::vector<unsigned int> nElements{
+          (unsigned int)penalties.size(),
+          (unsigned int)lambda.n_elem,
+          (unsigned int)theta.n_elem};
+
+      if (!allEqual(nElements))
+      {
+        error("penalty, regularized, lambda, theta, and alpha must all be of the same length.");
+      }
+
+      std::vector<double> weights(numberParameters);
+      for (unsigned int i = 0; i < penalties.size(); i++)
+      {
+        weights.at(i) = (penalties.at(i) != penaltyType::none) ? 1.0 : 0.0;
+      }
+
+      if (verbose)
+        printPenaltyDetails(
+            parameterLabels,
+            penalties,
+            lambda,
+            theta);
+
+      tp.alpha = arma::rowvec(numberParameters, arma::fill::ones);
+      tp.lambda = lambda;
+      tp.pt = penalties;
+      tp.theta = theta;
+      tp.weights = weights;
+
+      smoothTp.alpha = 0.0;
+      smoothTp.lambda = 0.0;
+      smoothTp.weights = weights;
+
+      initializeMixedProximalOperators(proxOp,
+                                       penalties);
+      initializeMixedPenalties(pen,
+                               penalties);
+    }
+  };
+
+  class istaReverseFit : private istaReversePenalties,
+                         public istaReverseCommunication<tuningParametersMixedPenalty,
+                                                         tuningParametersEnet>
+  {
+  public:
+    istaReverseFit(const arma::rowvec &startingValues,
+                   const stringVector &parameterLabels,
+                   const std::vector<std::string> &penalty,
+                   const arma::rowvec &lambda,
+                   const arma::rowvec &theta,
+                   const controlIsta &controlOptimizer,
+                   const int verbose) : istaReversePenalties(parameterLabels,
+                                                             startingValues.n_elem,
+                                                             penalty,
+                                                             lambda,
+                                                             theta,
+                                                             verbose),
+                                        istaReverseCommunication(startingValues,
+                                                                 parameterLabels,
+                                                                 proxOp,
+                                                                 pen,
+                                                                 smoothPen,
+                                                                 tp,
+                                                                 smoothTp,
+                                                                 controlOptimizer)
+    {
+    }
+  };
+
+  /**
+   * @brief Reverse communication version of fitGlmnet. See fitGlmnet for details on the arguments. The model
+   * is replaced by the requests of the returned object. The first request is computed before returning.
+   *
+   * @return std::unique_ptr<reverseCommunicationFit>
+   */
+  inline std::unique_ptr<reverseCommunicationFit> fitGlmnetReverse(
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      arma::mat initialHessian = arma::mat(1, 1, arma::fill::ones),
+      controlGLMNET controlOptimizer = controlGlmnetDefault(),
+      const int verbose = 0)
+  {
+    controlOptimizer.initialHessian = initialHessian;
+    return (std::unique_ptr<reverseCommunicationFit>(new glmnetReverseFit(startingValues,
+                                                                          parameterLabels,
+                                                                          penalty,
+                                                                          lambda,
+                                                                          theta,
+                                                                          controlOptimizer,
+                                                                          verbose)));
+  }
+
+  /**
+   * @brief Reverse communication version of fitIsta. See fitIsta for details on the arguments. The model
+   * is replaced by the requests of the returned object. The first request is computed before returning.
+   *
+   * @return std::unique_ptr<reverseCommunicationFit>
+   */
+  inline std::unique_ptr<reverseCommunicationFit> fitIstaReverse(
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      std::vector<std::string> penalty,
+      arma::rowvec lambda,
+      arma::rowvec theta,
+      controlIsta controlOptimizer = controlIstaDefault(),
+      const int verbose = 0)
+  {
+    return (std::unique_ptr<reverseCommunicationFit>(new istaReverseFit(startingValues,
+                                                                        parameterLabels,
+                                                                        penalty,
+                                                                        lambda,
+                                                                        theta,
+                                                                        controlOptimizer,
+                                                                        verbose)));
+  }
+
+}
+#endif
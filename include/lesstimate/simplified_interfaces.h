@@ -21,8 +21,8 @@ namespace lessSEM
   * regularized SEM. Your mileage may vary, so please make sure to adapt the settings
   * to your needs.
   * @param userModel your model. Must inherit from lessSEM::model!
-  * @param startingValues numericVector with initial starting values. This
-  * vector can have names.
+  * @param startingValues an arma::rowvec numeric vector with starting values
+  * @param parameterLabels a lessSEM::stringVector with labels for parameters
   * @param penalty vector with strings indicating the penalty for each parameter.
   * Currently supported are "none", "cappedL1", "lasso", "lsp", "mcp", and "scad".
   * (e.g., {"none", "scad", "scad", "lasso", "none"}). If only one value is provided,
@@ -36,7 +36,8 @@ namespace lessSEM
   * Not all penalties use theta.
   * Important: The the function will _not_ loop over these values but assume that you
   * may want to provide different levels of regularization for each parameter!
-  * @param initialHessian matrix with initial Hessian values.
+  * @param initialHessian matrix with initial Hessian values. If a single value is provided, the optimizer
+  * starts with a diagonal matrix and rescales it after the first step (see controlGLMNET.hessianScaling).
   * @param controlOptimizer option to change the optimizer settings
   * @param verbose should additional information be printed? If set > 0, additional
   * information will be provided. Highly recommended for initial runs. Note that
@@ -46,7 +47,8 @@ namespace lessSEM
   */
   inline fitResults fitGlmnet(
       model &userModel,
-      numericVector startingValues,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
       std::vector<std::string> penalty,
       arma::rowvec lambda,
       arma::rowvec theta,
@@ -55,8 +57,7 @@ namespace lessSEM
       const int verbose = 0)
   {
 
-    unsigned int numberParameters = startingValues.length();
-    stringVector parameterLabels = startingValues.names();
+    unsigned int numberParameters = startingValues.n_elem;
 
     // We expect startingValues, penalty, regularized, weights,
     // lambda, theta, and alpha to all be of the same length. For convenience,
@@ -67,25 +68,19 @@ namespace lessSEM
 
     std::vector<penaltyType> penalties = stringPenaltyToPenaltyType(penalty);
 
-    // resize Hessian if none is provided
-    if ((initialHessian.n_elem) == 1 && (numberParameters != 1))
-    {
-      double hessianValue = initialHessian(0, 0);
-      initialHessian.resize(numberParameters, numberParameters);
-      initialHessian.fill(0.0);
-      initialHessian.diag() += hessianValue;
-
-      warn("Setting initial Hessian to identity matrix. We recommend passing a better Hessian.");
-    }
-
+    // If no Hessian is provided (1x1 matrix), the optimizer starts with a diagonal
+    // matrix and rescales it after the first step (see controlGLMNET.hessianScaling)
     controlOptimizer.initialHessian = initialHessian;
     // check if all elements are of equal length now:
     std::vector<unsigned int> nElements{
         (unsigned int)penalties.size(),
         (unsigned int)lambda.n_elem,
-        (unsigned int)theta.n_elem,
-        (unsigned int)initialHessian.n_rows,
-        (unsigned int)initialHessian.n_cols};
+        (unsigned int)theta.n_elem};
+    if (initialHessian.n_elem != 1)
+    {
+      nElements.push_back(initialHessian.n_rows);
+      nElements.push_back(initialHessian.n_cols);
+    }
 
     if (!allEqual(nElements))
     {
@@ -131,6 +126,7 @@ namespace lessSEM
     fitResults fitResults_ = glmnet(
         userModel,
         startingValues,
+        parameterLabels,
         pen,
         smoothPen,
         tp,
@@ -144,8 +140,8 @@ namespace lessSEM
   * to your needs.
   * 
   * @param userModel your model. Must inherit from lessSEM::model!
-  * @param startingValues an arma::rowvec numeric vector with starting values
-  * @param parameterLabels a lessSEM::stringVector with labels for parameters
+  * @param startingValues numericVector with initial starting values. The
+  * names are used as parameter labels.
   * @param penalty vector with strings indicating the penalty for each parameter.
   * Currently supported are "none", "cappedL1", "lasso", "lsp", "mcp", and "scad".
   * (e.g., {"none", "scad", "scad", "lasso", "none"}). If only one value is provided,
@@ -159,7 +155,8 @@ namespace lessSEM
   * Not all penalties use theta.
   * Important: The the function will _not_ loop over these values but assume that you
   * may want to provide different levels of regularization for each parameter!
-  * @param initialHessian matrix with initial Hessian values.
+  * @param initialHessian matrix with initial Hessian values. If a single value is provided, the optimizer
+  * starts with a diagonal matrix and rescales it after the first step (see controlGLMNET.hessianScaling).
   * @param controlOptimizer option to change the optimizer settings
   * @param verbose should additional information be printed? If set > 0, additional
   * information will be provided. Highly recommended for initial runs. Note that
@@ -169,8 +166,7 @@ namespace lessSEM
   */
   inline fitResults fitGlmnet(
       model &userModel,
-      arma::rowvec startingValues,
-      stringVector parameterLabels,
+      numericVector startingValues,
       std::vector<std::string> penalty,
       arma::rowvec lambda,
       arma::rowvec theta,
@@ -178,12 +174,10 @@ namespace lessSEM
       controlGLMNET controlOptimizer = controlGlmnetDefault(),
       const int verbose = 0)
   {
-    numericVector startingValuesNumVec = toNumericVector(startingValues);
-    startingValuesNumVec.names() = parameterLabels;
-
     return (fitGlmnet(
         userModel,
-        startingValuesNumVec,
+        toArmaVectorView(startingValues),
+        startingValues.names(),
         penalty,
         lambda,
         theta,
@@ -205,8 +199,8 @@ namespace lessSEM
   * regularized SEM. Your mileage may vary, so please make sure to adapt the settings
   * to your needs.
   * @param userModel your model. Must inherit from lessSEM::model!
-  * @param startingValues numericVector with initial starting values. This
-  * vector can have names.
+  * @param startingValues an arma::rowvec numeric vector with starting values
+  * @param parameterLabels a lessSEM::stringVector with labels for parameters
   * @param penalty vector with strings indicating the penalty for each parameter.
   * Currently supported are "none", "cappedL1", "lasso", "lsp", "mcp", and "scad".
   * (e.g., {"none", "scad", "scad", "lasso", "none"}). If only one value is provided,
@@ -229,7 +223,8 @@ namespace lessSEM
   */
   inline fitResults fitIsta(
       model &userModel,
-      numericVector startingValues,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
       std::vector<std::string> penalty,
       arma::rowvec lambda,
       arma::rowvec theta,
@@ -237,8 +232,7 @@ namespace lessSEM
       const int verbose = 0)
   {
 
-    unsigned int numberParameters = startingValues.length();
-    stringVector parameterLabels = startingValues.names();
+    unsigned int numberParameters = startingValues.n_elem;
 
     // We expect startingValues, penalty, regularized, weights,
     // lambda, theta, and alpha to all be of the same length. For convenience,
@@ -308,6 +302,7 @@ namespace lessSEM
     fitResults fitResults_ = ista(
         userModel,
         startingValues,
+        parameterLabels,
         proximalOperatorMixedPenalty_,
         penalty_,
         smoothPenalty_,
@@ -323,8 +318,8 @@ namespace lessSEM
   * regularized SEM. Your mileage may vary, so please make sure to adapt the settings
   * to your needs.
   * @param userModel your model. Must inherit from lessSEM::model!
-  * @param startingValues an arma::rowvec numeric vector with starting values
-  * @param parameterLabels a lessSEM::stringVector with labels for parameters
+  * @param startingValues numericVector with initial starting values. The
+  * names are used as parameter labels.
   * @param penalty vector with strings indicating the penalty for each parameter.
   * Currently supported are "none", "cappedL1", "lasso", "lsp", "mcp", and "scad".
   * (e.g., {"none", "scad", "scad", "lasso", "none"}). If only one value is provided,
@@ -347,21 +342,18 @@ namespace lessSEM
   */
   inline fitResults fitIsta(
       model &userModel,
-      arma::rowvec startingValues,
-      stringVector parameterLabels,
+      numericVector startingValues,
       std::vector<std::string> penalty,
       arma::rowvec lambda,
       arma::rowvec theta,
       controlIsta controlOptimizer = controlIstaDefault(),
       const int verbose = 0)
   {
-    numericVector startingValuesNumVec = toNumericVector(startingValues);
-    startingValuesNumVec.names() = parameterLabels;
-
     return (
         fitIsta(
             userModel,
-            startingValuesNumVec,
+            toArmaVectorView(startingValues),
+            startingValues.names(),
             penalty,
             lambda,
             theta,
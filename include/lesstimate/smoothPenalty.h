@@ -1,6 +1,7 @@
 #ifndef SMOOTHPENALTY_H
 #define SMOOTHPENALTY_H
 #include "common_headers.h"
+#include "labels.h"
 
 namespace lessSEM
 {
@@ -22,7 +23,7 @@ namespace lessSEM
      * @return double
      */
     virtual double getValue(const arma::rowvec &parameterValues,
-                            const stringVector &parameterLabels,
+                            const labelHandle parameterLabels,
                             const T &tuningParameters) = 0;
     /**
      * @brief returns gradients of the penalty function
@@ -33,7 +34,7 @@ namespace lessSEM
      * @return arma::rowvec
      */
     virtual arma::rowvec getGradients(const arma::rowvec &parameterValues,
-                                      const stringVector &parameterLabels,
+                                      const labelHandle parameterLabels,
                                       const T &tuningParameters) = 0;
   };
 
@@ -56,7 +57,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const T &tuningParameters) override
     {
       return (0.0);
@@ -70,7 +71,7 @@ namespace lessSEM
      * @return arma::rowvec
      */
     arma::rowvec getGradients(const arma::rowvec &parameterValues,
-                              const stringVector &parameterLabels,
+                              const labelHandle parameterLabels,
                               const T &tuningParameters) override
     {
       arma::rowvec gradients(parameterValues.n_elem);
@@ -108,7 +109,7 @@ namespace lessSEM
      * @return double
      */
     double getValue(const arma::rowvec &parameterValues,
-                    const stringVector &parameterLabels,
+                    const labelHandle parameterLabels,
                     const tuningParametersSmoothElasticNet &tuningParameters)
         override
     {
@@ -146,7 +147,7 @@ namespace lessSEM
      * @return arma::rowvec
      */
     arma::rowvec getGradients(const arma::rowvec &parameterValues,
-                              const stringVector &parameterLabels,
+                              const labelHandle parameterLabels,
                               const tuningParametersSmoothElasticNet &tuningParameters) override
     {
 
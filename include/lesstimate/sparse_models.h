@@ -0,0 +1,352 @@
+#ifndef SPARSE_MODELS_H
+#define SPARSE_MODELS_H
+#include "common_headers.h"
+
+#include "model.h"
+
+// Built-in regression models for sparse design matrices (arma::sp_mat). The
+// fit and gradients are computed with sparse kernels that only touch the non-zero
+// elements of the design matrix. The linear predictor X*b is cached and
+// updated incrementally if only a few parameters changed since the last call
+// (as is the case for coordinate-wise updates and for sparse estimates).
+//
+// Note: glmnet stores a dense p x p Hessian approximation. For very large numbers
+// of parameters, use ista or svrg instead which only require vectors of length p.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief base class for the sparse regression models. Manages the design matrix and the
+   * incrementally updated linear predictor.
+   */
+  class sparseRegressionModelBase : public model
+  {
+  public:
+    const arma::colvec y;  ///> dependent variable
+    const arma::sp_mat X;  ///> sparse design matrix (observations in rows, predictors in columns)
+    const unsigned int N;  ///> number of observations
+
+    /**
+     * @brief Construct a new sparse regression model
+     *
+     * @param y_ dependent variable
+     * @param X_ sparse design matrix
+     */
+    sparseRegressionModelBase(arma::colvec y_, arma::sp_mat X_) : y(y_), X(X_), N(y_.n_elem)
+    {
+      if (X.n_rows != y.n_elem)
+        error("The number of rows in X must be equal to the number of elements in y.");
+      X.sync();
+      linearPredictor.zeros(N);
+      currentParameters.zeros(X.n_cols);
+    }
+
+    unsigned int numberOfObservations() override
+    {
+      return (N);
+    }
+
+  protected:
+    /**
+     * @brief update the cached linear predictor X*b to the new parameter values. If only
+     * few parameters changed, only the columns of these parameters are used in the update.
+     *
+     * @param parameterValues new parameter values
+     */
+    void updateLinearPredictor(const arma::rowvec &parameterValues)
+    {
+      if (parameterValues.n_elem != X.n_cols)
+        error("The number of parameters must be equal to the number of columns in X.");
+
+      std::vector<unsigned int> changed;
+      for (unsigned int j = 0; j < parameterValues.n_elem; j++)
+      {
+        if (parameterValues.at(j) != currentParameters.at(j))
+          changed.push_back(j);
+      }
+
+      if (changed.size() == 0)
+        return;
+
+      // incremental updates accumulate rounding errors; we recompute the
+      // linear predictor from scratch every now and then
+      if ((4 * changed.size() < parameterValues.n_elem) &&
+          (incrementalUpdates < maxIncrementalUpdates))
+      {
+        double change;
+        for (unsigned int j : changed)
+        {
+          change = parameterValues.at(j) - currentParameters.at(j);
+          for (arma::uword k = X.col_ptrs[j]; k < X.col_ptrs[j + 1]; k++)
+            linearPredictor.at(X.row_indices[k]) += X.values[k] * change;
+        }
+        incrementalUpdates++;
+      }
+      else
+      {
+        linearPredictor.zeros();
+        for (unsigned int j = 0; j < X.n_cols; j++)
+        {
+          if (parameterValues.at(j) == 0.0)
+            continue;
+          for (arma::uword k = X.col_ptrs[j]; k < X.col_ptrs[j + 1]; k++)
+            linearPredictor.at(X.row_indices[k]) += X.values[k] * parameterValues.at(j);
+        }
+        incrementalUpdates = 0;
+      }
+
+      currentParameters = parameterValues;
+    }
+
+    /**
+     * @brief computes X^T * residuals with a pass over the non-zero elements of X
+     *
+     * @param residuals vector with one element per observation
+     * @return arma::rowvec
+     */
+    arma::rowvec crossprod(const arma::colvec &residuals) const
+    {
+      arma::rowvec result(X.n_cols, arma::fill::zeros);
+      double sum;
+      for (unsigned int j = 0; j < X.n_cols; j++)
+      {
+        sum = 0.0;
+        for (arma::uword k = X.col_ptrs[j]; k < X.col_ptrs[j + 1]; k++)
+          sum += X.values[k] * residuals.at(X.row_indices[k]);
+        result.at(j) = sum;
+      }
+      return (result);
+    }
+
+    /**
+     * @brief returns the transposed design matrix which provides fast access to the rows of X. It
+     * is only created if required (e.g., for minibatches).
+     *
+     * @return const arma::sp_mat&
+     */
+    const arma::sp_mat &getTransposedX()
+    {
+      if (Xt.n_cols != N)
+      {
+        Xt = X.t();
+        Xt.sync();
+      }
+      return (Xt);
+    }
+
+    /**
+     * @brief computes the linear predictor of observation i based on the transposed design matrix
+     *
+     * @param parameterValues parameter values
+     * @param i observation
+     * @return double
+     */
+    double linearPredictorObservation(const arma::rowvec &parameterValues,
+                                      const unsigned int i)
+    {
+      double eta = 0.0;
+      for (arma::uword k = Xt.col_ptrs[i]; k < Xt.col_ptrs[i + 1]; k++)
+        eta += Xt.values[k] * parameterValues.at(Xt.row_indices[k]);
+      return (eta);
+    }
+
+    arma::colvec linearPredictor;
+    arma::rowvec currentParameters;
+    arma::sp_mat Xt;
+    unsigned int incrementalUpdates = 0;
+    const unsigned int maxIncrementalUpdates = 100;
+  };
+
+  /**
+   * @brief linear regression with a sparse design matrix. The fit function is given by
+   * $$f(b) = \frac{1}{2N}\sum_i (y_i - x_i^T b)^2$$
+   */
+  class sparseLinearRegressionModel : public sparseRegressionModelBase
+  {
+  public:
+    /**
+     * @brief Construct a new sparse linear regression model
+     *
+     * @param y_ dependent variable
+     * @param X_ sparse design matrix
+     */
+    sparseLinearRegressionModel(arma::colvec y_, arma::sp_mat X_) : sparseRegressionModelBase(y_, X_) {}
+
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      updateLinearPredictor(parameterValues);
+      double sse = 0.0;
+      for (unsigned int i = 0; i < N; i++)
+        sse += std::pow(y.at(i) - linearPredictor.at(i), 2);
+      return (sse / (2.0 * N));
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      updateLinearPredictor(parameterValues);
+      return (crossprod(linearPredictor - y) / N);
+    }
+
+    arma::rowvec minibatchGradients(const arma::rowvec &parameterValues,
+                                    const labelHandle parameterLabels,
+                                    const unsigned int firstObservation,
+                                    const unsigned int lastObservation) override
+    {
+      const arma::sp_mat &Xt_ = getTransposedX();
+      arma::rowvec gradients_(X.n_cols, arma::fill::zeros);
+      double residual;
+      for (unsigned int i = firstObservation; i < lastObservation; i++)
+      {
+        residual = linearPredictorObservation(parameterValues, i) - y.at(i);
+        for (arma::uword k = Xt_.col_ptrs[i]; k < Xt_.col_ptrs[i + 1]; k++)
+          gradients_.at(Xt_.row_indices[k]) += Xt_.values[k] * residual;
+      }
+      return (gradients_ / N);
+    }
+
+    double dualFit(const arma::rowvec &parameterValues,
+                   const double scale) override
+    {
+      // F^*(u) = sum_i N/2 u_i^2 + u_i y_i for u_i = scale * (x_i^T b - y_i) / N
+      updateLinearPredictor(parameterValues);
+      double dual = 0.0;
+      double residual;
+      for (unsigned int i = 0; i < N; i++)
+      {
+        residual = linearPredictor.at(i) - y.at(i);
+        dual -= .5 * scale * scale * residual * residual + scale * residual * y.at(i);
+      }
+      return (dual / N);
+    }
+  };
+
+  /**
+   * @brief logistic regression with a sparse design matrix. The fit function is given by the
+   * negative log-likelihood divided by the number of observations:
+   * $$f(b) = \frac{1}{N}\sum_i \log(1+\exp(x_i^T b)) - y_i x_i^T b$$
+   * where y_i is 0 or 1.
+   */
+  class sparseLogisticRegressionModel : public sparseRegressionModelBase
+  {
+  public:
+    /**
+     * @brief Construct a new sparse logistic regression model
+     *
+     * @param y_ dependent variable (0 or 1)
+     * @param X_ sparse design matrix
+     */
+    sparseLogisticRegressionModel(arma::colvec y_, arma::sp_mat X_) : sparseRegressionModelBase(y_, X_) {}
+
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      updateLinearPredictor(parameterValues);
+      double negativeLogLikelihood = 0.0;
+      for (unsigned int i = 0; i < N; i++)
+        negativeLogLikelihood += logOnePlusExp(linearPredictor.at(i)) - y.at(i) * linearPredictor.at(i);
+      return (negativeLogLikelihood / N);
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      updateLinearPredictor(parameterValues);
+      arma::colvec residuals(N);
+      for (unsigned int i = 0; i < N; i++)
+        residuals.at(i) = probability(linearPredictor.at(i)) - y.at(i);
+      return (crossprod(residuals) / N);
+    }
+
+    arma::rowvec minibatchGradients(const arma::rowvec &parameterValues,
+                                    const labelHandle parameterLabels,
+                                    const unsigned int firstObservation,
+                                    const unsigned int lastObservation) override
+    {
+      const arma::sp_mat &Xt_ = getTransposedX();
+      arma::rowvec gradients_(X.n_cols, arma::fill::zeros);
+      double residual;
+      for (unsigned int i = firstObservation; i < lastObservation; i++)
+      {
+        residual = probability(linearPredictorObservation(parameterValues, i)) - y.at(i);
+        for (arma::uword k = Xt_.col_ptrs[i]; k < Xt_.col_ptrs[i + 1]; k++)
+          gradients_.at(Xt_.row_indices[k]) += Xt_.values[k] * residual;
+      }
+      return (gradients_ / N);
+    }
+
+    double dualFit(const arma::rowvec &parameterValues,
+                   const double scale) override
+    {
+      // F^*(u) = 1/N sum_i h(N u_i + y_i) with the negative binary entropy
+      // h(t) = t log(t) + (1-t) log(1-t) for u_i = scale * (p_i - y_i) / N
+      updateLinearPredictor(parameterValues);
+      double dual = 0.0;
+      double t;
+      for (unsigned int i = 0; i < N; i++)
+      {
+        t = scale * probability(linearPredictor.at(i)) + (1.0 - scale) * y.at(i);
+        dual -= xLogX(t) + xLogX(1.0 - t);
+      }
+      return (dual / N);
+    }
+
+  protected:
+    /**
+     * @brief numerically stable computation of log(1+exp(eta))
+     */
+    static double logOnePlusExp(const double eta)
+    {
+      return (std::max(eta, 0.0) + std::log1p(std::exp(-std::abs(eta))));
+    }
+
+    /**
+     * @brief x*log(x) with 0*log(0) = 0
+     */
+    static double xLogX(const double x)
+    {
+      if (x <= 0.0)
+        return (0.0);
+      return (x * std::log(x));
+    }
+
+    /**
+     * @brief numerically stable computation of 1/(1+exp(-eta))
+     */
+    static double probability(const double eta)
+    {
+      if (eta >= 0)
+        return (1.0 / (1.0 + std::exp(-eta)));
+      double expEta = std::exp(eta);
+      return (expEta / (1.0 + expEta));
+    }
+  };
+
+}
+#endif
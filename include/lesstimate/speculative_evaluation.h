@@ -0,0 +1,223 @@
+#ifndef SPECULATIVE_EVALUATION_H
+#define SPECULATIVE_EVALUATION_H
+#include "common_headers.h"
+
+#include "model.h"
+#include "parallel.h"
+#include "profiling.h"
+
+// The backtracking line searches of glmnet and ista try the step sizes in a fixed
+// sequence (e.g., 1, s, s^2, ...) and accept the first one which meets the
+// acceptance criterion. Each trial requires an evaluation of the fit function.
+// Because the trial points are known in advance, the next nTrials fits can be
+// evaluated concurrently on copies of the model (see model::clone). The trials
+// are then checked in their original order. If the fit only depends on the parameter
+// values, the accepted step is therefore identical to that of the sequential search.
+// Models with internal state (e.g., the incrementally updated linear predictor of
+// sparseRegressionModelBase) can differ in the last digits because each copy has its
+// own rounding history. The fits of the trials after the accepted one are wasted;
+// speculative evaluation therefore only pays off for expensive models which require
+// frequent backtracking.
+//
+// The copies are created at the beginning of each optimization and reused for all
+// line searches of that optimization. Reusing them across optimizations must be
+// requested explicitly (see glmnetOptimizer::setReuseModelCopies); glmnetPath does so
+// for the lambda values of a regularization path, where the model does not change.
+//
+// Note: When using R, the trials are evaluated sequentially because the R API is single threaded.
+
+namespace lessSEM
+{
+
+  /**
+   * @brief evaluates the fit (or gradients) of a model at a batch of trial parameters concurrently.
+   * The calling thread uses the original model, all other threads use a copy of the model.
+   * Exceptions thrown by the model are stored and rethrown when the result of the trial is
+   * requested; trials which are never inspected therefore behave as if they were never evaluated.
+   */
+  class speculativeEvaluator
+  {
+  public:
+    /**
+     * @brief Construct a new speculative evaluator
+     *
+     * @param nTrials_ number of trials evaluated concurrently
+     */
+    speculativeEvaluator(const unsigned int nTrials_) : nTrials(std::max(nTrials_, 1u)),
+#if USE_R
+                                                        pool(1)
+#else
+                                                        pool(std::max(nTrials_, 1u))
+#endif
+    {
+      trialParameters.resize(nTrials);
+      fitValues.resize(nTrials);
+      gradientValues.resize(nTrials);
+      exceptions.resize(nTrials);
+    }
+
+    /**
+     * @brief returns the number of trials evaluated concurrently
+     *
+     * @return unsigned int
+     */
+    unsigned int size() const
+    {
+      return (nTrials);
+    }
+
+    /**
+     * @brief creates the copies of the model. Must be called at the beginning of each optimization.
+     *
+     * @param model_ the model object derived from the model class in model.h
+     * @param reuseCopies if true, the copies of the previous call are reused if the model is the same
+     * object and invalidate() has not been called since. The caller must make sure that the model has
+     * not changed (e.g., new data) and that no other model was created at the same address.
+     * @return true if the trials can be evaluated concurrently, false if the model does not
+     * implement clone() or only one thread is available
+     */
+    bool prepare(model &model_,
+                 const bool reuseCopies = false)
+    {
+      if (reuseCopies && (baseModel == &model_))
+        return (clones.size() > 0);
+
+      baseModel = &model_;
+      clones.clear();
+      for (unsigned int i = 1; i < pool.size(); i++)
+      {
+        std::unique_ptr<model> modelCopy = model_.clone();
+        if (!modelCopy)
+        {
+          if (!warned)
+            warn("The model does not implement clone(). The line search is not evaluated speculatively.\n");
+          warned = true;
+          clones.clear();
+          return (false);
+        }
+        clones.push_back(std::move(modelCopy));
+      }
+      return (clones.size() > 0);
+    }
+
+    /**
+     * @brief removes the copies of the model. The next call to prepare creates new copies.
+     */
+    void invalidate()
+    {
+      baseModel = nullptr;
+      clones.clear();
+    }
+
+    /**
+     * @brief evaluates the fit at trialParameters[0], ..., trialParameters[n-1]
+     *
+     * @param n number of trials
+     * @param labels handle to the parameter labels
+     */
+    void evaluateFits(const unsigned int n,
+                      const labelHandle labels)
+    {
+      evaluate(n,
+               [this, labels](const unsigned int i, model &model_)
+               {
+                 fitValues.at(i) = model_.fitFast(trialParameters.at(i), labels);
+               });
+    }
+
+    /**
+     * @brief evaluates the gradients at trialParameters[0], ..., trialParameters[n-1]
+     *
+     * @param n number of trials
+     * @param labels handle to the parameter labels
+     */
+    void evaluateGradients(const unsigned int n,
+                           const labelHandle labels)
+    {
+      evaluate(n,
+               [this, labels](const unsigned int i, model &model_)
+               {
+                 gradientValues.at(i) = model_.gradientsFast(trialParameters.at(i), labels);
+               });
+    }
+
+    /**
+     * @brief returns the fit of trial i computed by evaluateFits
+     *
+     * @param i trial
+     * @return double
+     */
+    double fit(const unsigned int i) const
+    {
+      if (exceptions.at(i))
+        std::rethrow_exception(exceptions.at(i));
+      return (fitValues.at(i));
+    }
+
+    /**
+     * @brief returns the gradients of trial i computed by evaluateGradients
+     *
+     * @param i trial
+     * @return const arma::rowvec&
+     */
+    const arma::rowvec &gradients(const unsigned int i) const
+    {
+      if (exceptions.at(i))
+        std::rethrow_exception(exceptions.at(i));
+      return (gradientValues.at(i));
+    }
+
+    /**
+     * @brief stores an exception which is rethrown when the result of trial i is requested. Used
+     * if the trial parameters can not be computed.
+     *
+     * @param i trial
+     * @param exception exception to rethrow
+     */
+    void setException(const unsigned int i,
+                      std::exception_ptr exception)
+    {
+      exceptions.at(i) = exception;
+    }
+
+    std::vector<arma::rowvec> trialParameters; ///> parameters of the trials; filled by the caller
+
+  private:
+    unsigned int nTrials;
+    threadPool pool;
+    model *baseModel = nullptr;
+    std::vector<std::unique_ptr<model>> clones;
+    std::vector<double> fitValues;
+    std::vector<arma::rowvec> gradientValues;
+    std::vector<std::exception_ptr> exceptions;
+    bool warned = false;
+
+    void evaluate(const unsigned int n,
+                  const std::function<void(unsigned int, model &)> &evaluation)
+    {
+      LESSTIMATE_PROFILE_SCOPE("speculativeEvaluator::evaluate");
+      if (baseModel == nullptr)
+        error("speculativeEvaluator::prepare must be called before evaluating the trials.");
+      if (n > nTrials)
+        error("Too many trials for the speculative evaluation.");
+
+      pool.parallelFor(
+          n,
+          [this, &evaluation](const unsigned int i, const unsigned int chunk)
+          {
+            exceptions.at(i) = nullptr;
+            try
+            {
+              evaluation(i, (chunk == 0) ? *baseModel : *clones.at(chunk - 1));
+            }
+            catch (...)
+            {
+              exceptions.at(i) = std::current_exception();
+            }
+          },
+          clones.size() + 1);
+    }
+  };
+
+}
+#endif
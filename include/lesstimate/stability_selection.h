@@ -0,0 +1,228 @@
+#ifndef STABILITY_SELECTION_H
+#define STABILITY_SELECTION_H
+// Stability selection fits the regularization path on many subsamples of the data
+// and reports how often each parameter is selected (i.e., not set to zero) for
+// each lambda. See
+// Meinshausen, N., & Bühlmann, P. (2010). Stability selection. Journal of the Royal
+// Statistical Society: Series B (Statistical Methodology), 72(4), 417–473.
+// https://doi.org/10.1111/j.1467-9868.2010.00740.x
+//
+// The estimates of the subsamples are not stored; only the selection counts are
+// accumulated. The memory is therefore independent of the number of subsamples.
+// Subsample b always uses the random number stream b; the results are identical
+// for any number of threads.
+//
+// Note: When using R, the subsamples are fitted sequentially because the R API is single threaded.
+
+#include "common_headers.h"
+
+#include <functional>
+#include "regularization_path.h"
+#include "parallel.h"
+
+namespace lessSEM
+{
+  /**
+   * @struct controlStabilitySelection
+   * @brief Allows you to adapt the settings of the stability selection
+   *
+   * @var nSubsamples number of subsamples
+   * @var subsampleFraction fraction of the observations in each subsample (drawn without replacement)
+   * @var selectionThreshold a parameter is selected if its absolute value is larger than the threshold
+   * @var seed seed of the random number generator used to draw the subsamples
+   * @var nThreads number of threads. If set to 0, the number of hardware threads is used.
+   */
+  struct controlStabilitySelection
+  {
+    unsigned int nSubsamples;
+    double subsampleFraction;
+    double selectionThreshold;
+    unsigned int seed;
+    unsigned int nThreads;
+  };
+
+  /**
+   * @brief Returns the default settings for the stability selection
+   *
+   * @return controlStabilitySelection
+   */
+  inline controlStabilitySelection controlStabilitySelectionDefault()
+  {
+    controlStabilitySelection defaultIs = {
+        100, // nSubsamples
+        .5,  // subsampleFraction
+        0.0, // selectionThreshold
+        0,   // seed
+        0    // nThreads (0 = hardware threads)
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @struct stabilitySelectionResults
+   * @brief The results of the stability selection
+   *
+   * @var lambda lambda values
+   * @var selectionCounts matrix with the number of subsamples in which parameter j (row) was selected for lambda l (column)
+   * @var selectionProbabilities selectionCounts divided by the number of subsamples
+   * @var nConverged number of subsamples in which the optimizer converged for lambda l
+   * @var nSubsamples number of subsamples
+   */
+  struct stabilitySelectionResults
+  {
+    arma::rowvec lambda;
+    arma::umat selectionCounts;
+    arma::mat selectionProbabilities;
+    arma::uvec nConverged;
+    unsigned int nSubsamples;
+  };
+
+  /**
+   * @brief draws a subsample of the observations without replacement
+   *
+   * @param rng random number generator
+   * @param nObservations total number of observations
+   * @param subsampleSize number of observations in the subsample
+   * @param observations will be overwritten with the sorted indices of the observations in the subsample
+   */
+  inline void drawSubsample(randomNumberGenerator &rng,
+                            const unsigned int nObservations,
+                            const unsigned int subsampleSize,
+                            std::vector<unsigned int> &observations)
+  {
+    observations.resize(nObservations);
+    for (unsigned int i = 0; i < nObservations; i++)
+      observations[i] = i;
+    // partial Fisher-Yates shuffle: only the first subsampleSize elements are required
+    for (unsigned int i = 0; i < subsampleSize; i++)
+      std::swap(observations[i], observations[i + rng.index(nObservations - i)]);
+    observations.resize(subsampleSize);
+    std::sort(observations.begin(), observations.end());
+  }
+
+  /**
+   * @brief Stability selection with the glmnet optimizer. The settings of the penalties are identical to
+   * those of fitGlmnet.
+   *
+   * @param modelFactory function returning a new model for the subsample given by the indices of the
+   * observations (0, ..., nObservations-1). The factory may be called from multiple threads at the same time.
+   * @param nObservations total number of observations
+   * @param startingValues an arma::rowvec numeric vector with starting values for the first lambda
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param penalty vector with strings indicating the penalty for each parameter. See fitGlmnet.
+   * @param lambdas lambda values. The same lambda is used for all regularized parameters. Typically, these are decreasing.
+   * @param theta theta tuning parameter values. See fitGlmnet.
+   * @param initialHessian matrix with initial Hessian values.
+   * @param controlOptimizer option to change the optimizer settings
+   * @param control_ settings of the stability selection
+   * @return stabilitySelectionResults
+   */
+  inline stabilitySelectionResults stabilitySelection(
+      const std::function<std::unique_ptr<model>(const std::vector<unsigned int> &)> &modelFactory,
+      const unsigned int nObservations,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      const std::vector<std::string> &penalty,
+      const arma::rowvec &lambdas,
+      const arma::rowvec &theta,
+      const arma::mat &initialHessian = arma::mat(1, 1, arma::fill::ones),
+      const controlGLMNET &controlOptimizer = controlGlmnetDefault(),
+      const controlStabilitySelection &control_ = controlStabilitySelectionDefault())
+  {
+    const unsigned int subsampleSize = (unsigned int)std::floor(control_.subsampleFraction * nObservations);
+    if ((subsampleSize == 0) || (subsampleSize > nObservations))
+      error("subsampleFraction must result in a subsample size between 1 and nObservations.");
+
+#if USE_R
+    threadPool pool(1);
+#else
+    threadPool pool(control_.nThreads);
+#endif
+
+    // the subsamples are already fitted concurrently. A speculative line search would
+    // additionally copy each subsample model (see speculative_evaluation.h)
+    controlGLMNET controlPath = controlOptimizer;
+    if (pool.size() > 1)
+      controlPath.speculativeTrials = 0;
+
+    // each thread owns a path (with its own penalties and optimizer) and its own counts.
+    // The counts are summed after all subsamples have been fitted.
+    struct threadResources
+    {
+      glmnetPath path;
+      std::vector<unsigned int> observations;
+      arma::umat selectionCounts;
+      arma::uvec nConverged;
+
+      threadResources(const unsigned int numberParameters,
+                      const std::vector<std::string> &penalty,
+                      const arma::rowvec &theta,
+                      const arma::mat &initialHessian,
+                      const controlGLMNET &controlOptimizer,
+                      const unsigned int nLambdas) : path(numberParameters,
+                                                          penalty,
+                                                          theta,
+                                                          initialHessian,
+                                                          controlOptimizer),
+                                                     selectionCounts(numberParameters, nLambdas, arma::fill::zeros),
+                                                     nConverged(nLambdas, arma::fill::zeros) {}
+    };
+    std::vector<std::unique_ptr<threadResources>> resources;
+    for (unsigned int i = 0; i < std::min(pool.size(), std::max(control_.nSubsamples, 1u)); i++)
+      resources.emplace_back(new threadResources(startingValues.n_elem,
+                                                 penalty,
+                                                 theta,
+                                                 initialHessian,
+                                                 controlPath,
+                                                 lambdas.n_elem));
+
+    // the subsamples are handed out one at a time; slowly converging paths do not hold up the other threads
+    pool.parallelForDynamic(
+        control_.nSubsamples,
+        [&](const unsigned int b, const unsigned int worker)
+        {
+          threadResources &resources_ = *resources.at(worker);
+
+          // the random numbers of subsample b only depend on the seed and b
+          randomNumberGenerator rng(control_.seed, b);
+          drawSubsample(rng, nObservations, subsampleSize, resources_.observations);
+          resources_.path.setSeed((unsigned int)rng.next());
+
+          std::unique_ptr<model> subsampleModel = modelFactory(resources_.observations);
+          if (!subsampleModel)
+            error("The model factory returned no model.");
+
+          resources_.path.run(*subsampleModel,
+                              startingValues,
+                              parameterLabels,
+                              lambdas,
+                              [&resources_, &control_](const unsigned int l, const fitResults &fitResults_)
+                              {
+                                resources_.nConverged.at(l) += fitResults_.convergence;
+                                for (unsigned int j = 0; j < fitResults_.parameterValues.n_elem; j++)
+                                {
+                                  if (std::abs(fitResults_.parameterValues.at(j)) > control_.selectionThreshold)
+                                    resources_.selectionCounts.at(j, l)++;
+                                }
+                              });
+        },
+        resources.size());
+
+    stabilitySelectionResults stabilitySelectionResults_;
+    stabilitySelectionResults_.lambda = lambdas;
+    stabilitySelectionResults_.nSubsamples = control_.nSubsamples;
+    stabilitySelectionResults_.selectionCounts.zeros(startingValues.n_elem, lambdas.n_elem);
+    stabilitySelectionResults_.nConverged.zeros(lambdas.n_elem);
+    for (const std::unique_ptr<threadResources> &resources_ : resources)
+    {
+      stabilitySelectionResults_.selectionCounts += resources_->selectionCounts;
+      stabilitySelectionResults_.nConverged += resources_->nConverged;
+    }
+    stabilitySelectionResults_.selectionProbabilities = arma::conv_to<arma::mat>::from(stabilitySelectionResults_.selectionCounts) /
+                                                        std::max(control_.nSubsamples, 1u);
+
+    return (stabilitySelectionResults_);
+  }
+
+}
+#endif
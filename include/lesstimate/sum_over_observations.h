@@ -0,0 +1,269 @@
+#ifndef SUM_OVER_OBSERVATIONS_H
+#define SUM_OVER_OBSERVATIONS_H
+#include "common_headers.h"
+
+#include "model.h"
+#include "parallel.h"
+#include "profiling.h"
+
+// Most fit functions are sums over observations (e.g., the -2 log-Likelihood of
+// a SEM estimated with full information maximum likelihood or the negative
+// log-Likelihood of a GLM). sumOverObservationsModel implements fit and gradients
+// for such models: the user only provides the contribution of a range of
+// observations; lesstimate splits the observations across a persistent thread
+// pool and sums the contributions.
+//
+// The observations are split into one contiguous range per thread. Each thread
+// accumulates into its own fit value and gradient vector; the accumulators are
+// padded to separate cache lines to avoid false sharing. The accumulators are
+// summed in the order of the ranges. For a given number of threads, the results
+// are therefore identical in each call (the order of the floating point additions
+// does not depend on the timing of the threads). Different numbers of threads
+// may result in differences due to rounding.
+//
+// Note: When using R, the observations are processed by a single thread because
+// the R API is single threaded.
+
+namespace lessSEM
+{
+  /**
+   * @struct controlSumOverObservations
+   * @brief Allows you to adapt the settings of the sumOverObservationsModel
+   *
+   * @var nThreads number of threads. If set to 0, the number of hardware threads is used.
+   * @var minObservationsPerThread additional threads are only used if each thread gets at least this many
+   * observations; for few observations, the overhead of the threads exceeds the gain.
+   */
+  struct controlSumOverObservations
+  {
+    unsigned int nThreads;
+    unsigned int minObservationsPerThread;
+  };
+
+  /**
+   * @brief Returns the default settings for the sumOverObservationsModel
+   *
+   * @return controlSumOverObservations
+   */
+  inline controlSumOverObservations controlSumOverObservationsDefault()
+  {
+    controlSumOverObservations defaultIs = {
+        0,  // nThreads (0 = hardware threads)
+        100 // minObservationsPerThread
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @brief base class for models with fit functions which are sums over observations. The user implements
+   * fitObservations and gradientsObservations; fit, gradients, numberOfObservations and minibatchGradients are
+   * provided. fitObservations and gradientsObservations are called from multiple threads at the same time
+   * (for different observations) and must therefore not change the state of the model.
+   *
+   * Example:
+   *
+   * class myModel : public lessSEM::sumOverObservationsModel
+   * {
+   * public:
+   *   myModel(arma::colvec y_, arma::mat X_) : sumOverObservationsModel(y_.n_elem), y(y_), X(X_) {}
+   *
+   *   double fitObservations(const arma::rowvec &parameterValues,
+   *                          const unsigned int firstObservation,
+   *                          const unsigned int lastObservation) override
+   *   {
+   *     double sse = 0.0;
+   *     for (unsigned int i = firstObservation; i < lastObservation; i++)
+   *       sse += std::pow(y(i) - arma::dot(X.row(i), parameterValues), 2);
+   *     return (sse);
+   *   }
+   *
+   *   void gradientsObservations(const arma::rowvec &parameterValues,
+   *                              const unsigned int firstObservation,
+   *                              const unsigned int lastObservation,
+   *                              arma::rowvec &gradients) override
+   *   {
+   *     for (unsigned int i = firstObservation; i < lastObservation; i++)
+   *       gradients -= 2.0 * (y(i) - arma::dot(X.row(i), parameterValues)) * X.row(i);
+   *   }
+   *
+   * private:
+   *   const arma::colvec y;
+   *   const arma::mat X;
+   * };
+   */
+  class sumOverObservationsModel : public model
+  {
+  public:
+    /**
+     * @brief Construct a new model
+     *
+     * @param nObservations_ number of observations
+     * @param control_ settings of the model
+     */
+    sumOverObservationsModel(const unsigned int nObservations_,
+                             const controlSumOverObservations &control_ = controlSumOverObservationsDefault()) : nObservations(nObservations_),
+                                                                                                                 control(control_),
+#if USE_R
+                                                                                                                 pool(1)
+#else
+                                                                                                                 pool(control_.nThreads)
+#endif
+    {
+    }
+
+    /**
+     * @brief Copies the model; the copy uses its own threads. This allows for implementing
+     * clone() in derived classes (e.g., return(std::make_unique<myModel>(*this));).
+     */
+    sumOverObservationsModel(const sumOverObservationsModel &other) : sumOverObservationsModel(other.nObservations,
+                                                                                               other.control) {}
+
+    sumOverObservationsModel &operator=(const sumOverObservationsModel &) = delete;
+
+    /**
+     * @brief contribution of the observations firstObservation, ..., lastObservation - 1 to the fit
+     *
+     * @param parameterValues parameter values
+     * @param firstObservation index of the first observation
+     * @param lastObservation index of the observation after the last observation
+     * @return double
+     */
+    virtual double fitObservations(const arma::rowvec &parameterValues,
+                                   const unsigned int firstObservation,
+                                   const unsigned int lastObservation) = 0;
+
+    /**
+     * @brief adds the gradients of the observations firstObservation, ..., lastObservation - 1 to gradients
+     *
+     * @param parameterValues parameter values
+     * @param firstObservation index of the first observation
+     * @param lastObservation index of the observation after the last observation
+     * @param gradients vector the gradients are added to. Has one element per parameter.
+     */
+    virtual void gradientsObservations(const arma::rowvec &parameterValues,
+                                       const unsigned int firstObservation,
+                                       const unsigned int lastObservation,
+                                       arma::rowvec &gradients) = 0;
+
+    double fit(arma::rowvec parameterValues,
+               stringVector parameterLabels) override
+    {
+      return (fitFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    double fitFast(const arma::rowvec &parameterValues,
+                   const labelHandle parameterLabels) override
+    {
+      LESSTIMATE_PROFILE_SCOPE("sumOverObservationsModel::fit");
+      const unsigned int nRanges = numberOfRanges();
+      prepareAccumulators(nRanges, 0);
+
+      pool.parallelFor(
+          nRanges,
+          [&](const unsigned int range, const unsigned int chunk)
+          {
+            LESSTIMATE_PROFILE_SCOPE("sumOverObservationsModel::fitObservations");
+            accumulators.at(range).fit = fitObservations(parameterValues,
+                                                         firstObservation(range, nRanges),
+                                                         firstObservation(range + 1, nRanges));
+          },
+          nRanges);
+
+      double fit_ = 0.0;
+      for (unsigned int range = 0; range < nRanges; range++)
+        fit_ += accumulators.at(range).fit;
+      return (fit_);
+    }
+
+    arma::rowvec gradients(arma::rowvec parameterValues,
+                           stringVector parameterLabels) override
+    {
+      return (gradientsFast(parameterValues, labelHandle(parameterLabels)));
+    }
+
+    arma::rowvec gradientsFast(const arma::rowvec &parameterValues,
+                               const labelHandle parameterLabels) override
+    {
+      LESSTIMATE_PROFILE_SCOPE("sumOverObservationsModel::gradients");
+      const unsigned int nRanges = numberOfRanges();
+      prepareAccumulators(nRanges, parameterValues.n_elem);
+
+      pool.parallelFor(
+          nRanges,
+          [&](const unsigned int range, const unsigned int chunk)
+          {
+            LESSTIMATE_PROFILE_SCOPE("sumOverObservationsModel::gradientsObservations");
+            gradientsObservations(parameterValues,
+                                  firstObservation(range, nRanges),
+                                  firstObservation(range + 1, nRanges),
+                                  accumulators.at(range).gradients);
+          },
+          nRanges);
+
+      arma::rowvec gradients_ = accumulators.at(0).gradients;
+      for (unsigned int range = 1; range < nRanges; range++)
+        gradients_ += accumulators.at(range).gradients;
+      return (gradients_);
+    }
+
+    unsigned int numberOfObservations() override
+    {
+      return (nObservations);
+    }
+
+    arma::rowvec minibatchGradients(const arma::rowvec &parameterValues,
+                                    const labelHandle parameterLabels,
+                                    const unsigned int firstObservation,
+                                    const unsigned int lastObservation) override
+    {
+      arma::rowvec gradients_(parameterValues.n_elem, arma::fill::zeros);
+      gradientsObservations(parameterValues,
+                            firstObservation,
+                            lastObservation,
+                            gradients_);
+      return (gradients_);
+    }
+
+  protected:
+    const unsigned int nObservations;
+
+  private:
+    // each thread accumulates into its own cache line(s)
+    struct alignas(64) accumulator
+    {
+      double fit;
+      arma::rowvec gradients;
+    };
+
+    const controlSumOverObservations control;
+    threadPool pool;
+    std::vector<accumulator> accumulators;
+
+    unsigned int numberOfRanges() const
+    {
+      const unsigned int maxRanges = std::max(nObservations / std::max(control.minObservationsPerThread, 1u), 1u);
+      return (std::min(pool.size(), maxRanges));
+    }
+
+    unsigned int firstObservation(const unsigned int range,
+                                  const unsigned int nRanges) const
+    {
+      return ((unsigned int)(((unsigned long long)range * nObservations) / nRanges));
+    }
+
+    void prepareAccumulators(const unsigned int nRanges,
+                             const unsigned int nParameters)
+    {
+      if (accumulators.size() < nRanges)
+        accumulators.resize(nRanges);
+      for (unsigned int range = 0; range < nRanges; range++)
+      {
+        accumulators.at(range).fit = 0.0;
+        // the memory of the gradients is reused
+        accumulators.at(range).gradients.zeros(nParameters);
+      }
+    }
+  };
+
+}
+#endif
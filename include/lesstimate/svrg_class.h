@@ -0,0 +1,433 @@
+#ifndef SVRGCLASS_H
+#define SVRGCLASS_H
+#include "common_headers.h"
+
+#include "model.h"
+#include "fitResults.h"
+#include "proximalOperator.h"
+#include "penalty.h"
+#include "smoothPenalty.h"
+#include "profiling.h"
+#include "diagnostics.h"
+
+// The design follows ensmallen (https://github.com/mlpack/ensmallen) in that the
+// user supplies a C++ class with methods fit and gradients which is used
+// by the optimizer. Additionally, the model must implement the minibatch
+// interface (numberOfObservations and minibatchGradients) of the model class.
+
+// The implementation of the proximal stochastic variance reduced gradient
+// optimizer follows
+// Xiao, L., & Zhang, T. (2014). A Proximal Stochastic Gradient Method with
+// Progressive Variance Reduction. SIAM Journal on Optimization, 24(4),
+// 2057–2075. https://doi.org/10.1137/140961791
+// The proximal operators are the same as those used by the ista optimizer.
+
+namespace lessSEM
+{
+
+  /**
+   * @struct controlSvrg
+   * @brief Allows you to adapt the optimizer settings for the svrg optimizer
+   *
+   * @var L0 controls the step size; parameters are updated with step size 1/L0. If L0 <= 0 (default),
+   * L0 is estimated from the change in the gradients of the first minibatch along a short step against
+   * the gradients at the starting values. Each rejected epoch costs two passes over the
+   * data; the estimate avoids most of the rejections caused by a badly scaled L0.
+   * @var eta if an epoch does not improve the fit, the epoch is repeated with step size
+   * 1/(eta*L)
+   * @var maxEpochs maximal number of accepted epochs. The full gradients are computed once for each
+   * new snapshot; repeating an epoch with a smaller step size does not count as a new epoch.
+   * @var batchSize number of observations in each minibatch
+   * @var innerIterations number of minibatch updates within each epoch. If set to 0,
+   * the number of minibatches in the data set is used (i.e., one pass over the data)
+   * @var breakOuter change in fit from one epoch to the next required to break the outer iteration
+   * @var sampleSize can be used to scale the fitting function down
+   * @var verbose if set to a value > 0, the fit every verbose epochs is printed.
+   * @var seed seed of the random number generator used to select the minibatches
+   * @var maxStepSizeRetries maximal number of times an epoch is repeated with a smaller step size
+   * before the optimization is stopped
+   */
+  struct controlSvrg
+  {
+    double L0;
+    double eta;
+    int maxEpochs;
+    int batchSize;
+    int innerIterations;
+    double breakOuter;
+    int sampleSize;
+    int verbose;
+    unsigned int seed;
+    int maxStepSizeRetries;
+  };
+
+  /**
+   * @brief Returns the default settings for the svrg optimizer.
+   *
+   * @return controlSvrg
+   */
+  inline controlSvrg controlSvrgDefault()
+  {
+    controlSvrg defaultIs = {
+        0,         // L0 (0 = estimated from the first minibatch)
+        2,         // eta
+        100,       // maxEpochs
+        100,       // batchSize
+        0,         // innerIterations (0 = one pass over the data)
+        .00000001, // breakOuter
+        1,         // sampleSize
+        0,         // verbose
+        0,         // seed
+        30         // maxStepSizeRetries
+    };
+    return (defaultIs);
+  }
+
+  /**
+   * @brief estimates the Lipschitz constant of the gradients of the smooth part of the objective. The
+   * gradients of the first minibatch are evaluated at the parameters and after a short step against
+   * the full gradients. The change in the minibatch gradients is scaled up to the full
+   * data set with the number of minibatches.
+   *
+   * @tparam U type of the tuning parameters of the smooth penalty
+   * @param model_ the model object derived from the model class in model.h
+   * @param parameters parameter values at which L is estimated
+   * @param gradients full gradients of the model (without smooth penalty) at parameters
+   * @param parameterLabels handle to the parameter labels
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param smoothTuningParameters tuning parameters for the smooth penalty function
+   * @param batchSize number of observations in the first minibatch
+   * @param nBatches number of minibatches
+   * @param sampleSize scaling of the fitting function (see controlSvrg)
+   * @return estimate of L. Falls back to .1 if the estimate is not usable.
+   */
+  template <typename U>
+  inline double svrgEstimateL(model &model_,
+                              const arma::rowvec &parameters,
+                              const arma::rowvec &gradients,
+                              const labelHandle parameterLabels,
+                              smoothPenalty<U> &smoothPenalty_,
+                              const U &smoothTuningParameters,
+                              const unsigned int batchSize,
+                              const unsigned int nBatches,
+                              const int sampleSize)
+  {
+    const double fallback = .1;
+
+    const arma::rowvec direction = (1.0 / sampleSize) * gradients +
+                                   smoothPenalty_.getGradients(parameters, parameterLabels, smoothTuningParameters);
+    const double directionNorm = arma::norm(direction, 2);
+    if (!arma::is_finite(directionNorm) || (directionNorm == 0.0))
+      return (fallback);
+
+    // the step is small relative to the parameters
+    const double stepLength = 1e-4 * std::max(1.0, (double)arma::norm(parameters, 2));
+    const arma::rowvec probe = parameters - (stepLength / directionNorm) * direction;
+
+    const arma::rowvec gradientChange =
+        ((double)nBatches / sampleSize) * (LESSTIMATE_PROFILE_CALL("model::minibatchGradients", model_.minibatchGradients(probe, parameterLabels, 0, batchSize)) -
+                                           LESSTIMATE_PROFILE_CALL("model::minibatchGradients", model_.minibatchGradients(parameters, parameterLabels, 0, batchSize))) +
+        smoothPenalty_.getGradients(probe, parameterLabels, smoothTuningParameters) -
+        smoothPenalty_.getGradients(parameters, parameterLabels, smoothTuningParameters);
+
+    const double L = arma::norm(gradientChange, 2) / arma::norm(probe - parameters, 2);
+    if (!arma::is_finite(L) || (L < 1e-10) || (L > 1e10))
+      return (fallback);
+    return (L);
+  }
+
+  // We provide two optimizer interfaces: One uses a combination of arma::rowvec and lessSEM::stringVector for starting
+  // values and parameter labels respectively. This interface is consistent with the fit and gradient function of the
+  // lessSEM::model-class. Alternatively, a numericVector can be passed to the optimizers. This design is rooted in
+  // the use of Rcpp::NumericVectors that combine values and labels similar to an R vector. Thus, interfacing to this
+  // second function call can be easier when coming from R.
+
+  /**
+   * @brief Optimize a model using the proximal stochastic variance reduced gradient procedure (prox-SVRG).
+   * In each epoch, the full gradients are computed at a snapshot of the parameters. The parameters are then
+   * updated with the proximal operator using the variance reduced gradient estimate
+   * B * (minibatchGradients(parameters) - minibatchGradients(snapshot)) + gradients(snapshot),
+   * where B is the number of minibatches. Because the minibatches are drawn uniformly, the estimate
+   * is unbiased even if the last minibatch is smaller than batchSize.
+   *
+   * @tparam T type of the tuning parameters of the proximal operator and the penalty
+   * @tparam U type of the tuning parameters of the smooth penalty
+   * @param model_ the model object derived from the model class in model.h. Must implement numberOfObservations and
+   * minibatchGradients
+   * @param startingValues an arma::rowvec numeric vector with starting values
+   * @param parameterLabels a lessSEM::stringVector with labels for parameters
+   * @param proximalOperator_ a proximal operator for the penalty function
+   * @param penalty_ a penalty derived from the penalty class in penalty.h
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningParameters tuning parameters for the penalty function
+   * @param smoothTuningParameters tuning parameters for the smooth penalty function
+   * @param control_ settings for the svrg optimizer.
+   * @return fit result
+   */
+  template <typename T, typename U>
+  inline lessSEM::fitResults svrg(
+      model &model_,
+      const arma::rowvec &startingValues,
+      const stringVector &parameterLabels,
+      proximalOperator<T> &proximalOperator_,
+      penalty<T> &penalty_,
+      smoothPenalty<U> &smoothPenalty_,
+      const T &tuningParameters,
+      const U &smoothTuningParameters,
+      const controlSvrg &control_ = controlSvrgDefault())
+  {
+    LESSTIMATE_PROFILE_SCOPE("svrg::optimize");
+
+    // problems are counted and summarized once at the end of the fit (see diagnostics.h)
+    diagnostics diagnostics_(control_.verbose != 0);
+    diagnosticsScope diagnosticsScope_(&diagnostics_);
+
+    if (control_.verbose != 0)
+    {
+      print << "Optimizing with svrg.\n"
+            << "Tuning parameters: \n L0 = "
+            << control_.L0
+            << "\n"
+            << " eta = "
+            << control_.eta
+            << "\n"
+            << " batchSize = "
+            << control_.batchSize
+            << "\n"
+            << " breakOuter = "
+            << control_.breakOuter
+            << std::endl;
+    }
+
+    const unsigned int nObservations = model_.numberOfObservations();
+    if (nObservations == 0)
+      error("svrg requires a model which implements numberOfObservations and minibatchGradients.");
+    if (control_.batchSize < 1)
+      error("batchSize must be at least 1.");
+
+    const unsigned int nBatches = (nObservations + control_.batchSize - 1) / control_.batchSize;
+    const int innerIterations = (control_.innerIterations > 0) ? control_.innerIterations : (int)nBatches;
+
+    // the models only receive a handle to the labels; this avoids copying them
+    const labelHandle labels(parameterLabels);
+
+    // prepare parameter vectors
+    arma::rowvec parameters_k = startingValues,
+                 parameters_snapshot = startingValues;
+    arma::rowvec gradients_k(startingValues.n_elem),
+        gradients_snapshot(startingValues.n_elem);
+    std::vector<unsigned int> batchOrder(nBatches);
+    for (unsigned int i = 0; i < nBatches; i++)
+      batchOrder.at(i) = i;
+    randomNumberGenerator rng(control_.seed);
+    unsigned int firstObservation, lastObservation;
+    // each minibatch is drawn with probability 1/nBatches
+    const double batchWeight = (double)nBatches;
+
+    // prepare fit elements
+    double fit_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_snapshot, labels)) +
+                   smoothPenalty_.getValue(parameters_snapshot, labels, smoothTuningParameters),
+           penalty_k = penalty_.getValue(parameters_snapshot, labels, tuningParameters);
+    double penalizedFit_k = fit_k + penalty_k,
+           penalizedFit_snapshot = penalizedFit_k;
+
+    // the following vector will save the fits of all epochs:
+    arma::rowvec fits(control_.maxEpochs + 1);
+    fits.fill(arma::datum::nan);
+    fits(0) = penalizedFit_snapshot;
+
+    // breaking flags
+    bool breakOuter = false;
+
+    // the full gradients are only recomputed when the snapshot changes; repeating
+    // an epoch with a smaller step size reuses them
+    bool snapshotGradientsCurrent = false;
+
+    // initialize step size
+    double L_k = control_.L0;
+    if (L_k <= 0.0)
+    {
+      // the full gradients at the starting values are also used by the first epoch
+      gradients_snapshot = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_snapshot, labels));
+      if (!arma::is_finite(gradients_snapshot))
+        error("Non-finite gradients at the snapshot parameters.");
+      snapshotGradientsCurrent = true;
+
+      L_k = svrgEstimateL(model_,
+                          parameters_snapshot,
+                          gradients_snapshot,
+                          labels,
+                          smoothPenalty_,
+                          smoothTuningParameters,
+                          std::min((unsigned int)control_.batchSize, nObservations),
+                          nBatches,
+                          control_.sampleSize);
+      if (control_.verbose != 0)
+        print << "Estimated L0 = " << L_k << std::endl;
+    }
+
+    int stepSizeRetries = 0;
+    int epoch = 0;
+
+    while (epoch < control_.maxEpochs)
+    {
+      LESSTIMATE_PROFILE_SCOPE("svrg::epoch");
+
+      // check if user wants to stop the computation:
+#if USE_R
+      Rcpp::checkUserInterrupt();
+#endif
+
+      // full gradients at the snapshot. Note: the smooth penalty is not part of the
+      // variance reduction because its gradients are cheap to compute exactly
+      if (!snapshotGradientsCurrent)
+      {
+        gradients_snapshot = LESSTIMATE_PROFILE_CALL("model::gradients", model_.gradientsFast(parameters_snapshot, labels));
+        if (!arma::is_finite(gradients_snapshot))
+          error("Non-finite gradients at the snapshot parameters.");
+        snapshotGradientsCurrent = true;
+      }
+
+      parameters_k = parameters_snapshot;
+
+      for (int inner_iteration = 0; inner_iteration < innerIterations; inner_iteration++)
+      {
+        // visit the minibatches in random order
+        if (inner_iteration % nBatches == 0)
+          rng.shuffle(batchOrder);
+
+        firstObservation = batchOrder.at(inner_iteration % nBatches) * control_.batchSize;
+        lastObservation = std::min(firstObservation + control_.batchSize, nObservations);
+
+        // variance reduced estimate of the gradients
+        gradients_k = (1.0 / control_.sampleSize) *
+                          (batchWeight * (LESSTIMATE_PROFILE_CALL("model::minibatchGradients", model_.minibatchGradients(parameters_k,
+                                                                                                                         labels,
+                                                                                                                         firstObservation,
+                                                                                                                         lastObservation)) -
+                                          LESSTIMATE_PROFILE_CALL("model::minibatchGradients", model_.minibatchGradients(parameters_snapshot,
+                                                                                                                         labels,
+                                                                                                                         firstObservation,
+                                                                                                                         lastObservation))) +
+                           gradients_snapshot) +
+                      smoothPenalty_.getGradients(parameters_k,
+                                                  labels,
+                                                  smoothTuningParameters); // ridge part
+
+        // non-finite gradients will also result in a non-finite fit; the epoch
+        // is then rejected below
+        if (!arma::is_finite(gradients_k))
+          break;
+
+        proximalOperator_.getParametersInPlace(
+            parameters_k,
+            gradients_k,
+            labels,
+            L_k,
+            tuningParameters,
+            parameters_k);
+      }
+
+      fit_k = (1.0 / control_.sampleSize) * LESSTIMATE_PROFILE_CALL("model::fit", model_.fitFast(parameters_k, labels)) +
+              smoothPenalty_.getValue(parameters_k, labels, smoothTuningParameters); // ridge penalty part
+      penalty_k = penalty_.getValue(parameters_k, labels, tuningParameters);
+      penalizedFit_k = fit_k + penalty_k;
+
+      if (!arma::is_finite(penalizedFit_k) || (penalizedFit_k > penalizedFit_snapshot))
+      {
+        // The step size was too large: repeat the epoch from the snapshot with a smaller
+        // step size. The snapshot and its full gradients are unchanged.
+        if (stepSizeRetries >= control_.maxStepSizeRetries)
+        {
+          reportDiagnostic(lineSearchNotConverged);
+          break;
+        }
+        if (control_.verbose > 0)
+          print << "Epoch " << epoch + 1 << " did not improve the fit --> decreasing step size." << std::endl;
+        L_k = control_.eta * L_k;
+        stepSizeRetries++;
+        continue;
+      }
+      stepSizeRetries = 0;
+
+      // print fit info
+      if ((control_.verbose > 0) && (epoch % control_.verbose == 0))
+      {
+        print << "Fit in epoch " << epoch + 1 << ": " << penalizedFit_k << " (" << fit_k << " + " << penalty_k << ")" << std::endl;
+        print << parameters_k << std::endl;
+      }
+
+      fits(epoch + 1) = penalizedFit_k;
+
+      // check outer breaking condition
+      breakOuter = std::abs(penalizedFit_k - penalizedFit_snapshot) < control_.breakOuter;
+
+      // the last iterate of the epoch is the snapshot of the next epoch
+      parameters_snapshot = parameters_k;
+      penalizedFit_snapshot = penalizedFit_k;
+      snapshotGradientsCurrent = false;
+      epoch++;
+
+      if (breakOuter)
+      {
+        break;
+      }
+    }
+
+    fitResults fitResults_;
+
+    fitResults_.convergence = breakOuter;
+    fitResults_.fit = control_.sampleSize * penalizedFit_snapshot; // rescale for -2log-Likelihood
+    fitResults_.fits = control_.sampleSize * fits;                 // rescale for -2log-Likelihood
+    fitResults_.parameterValues = parameters_snapshot;
+    fitResults_.dualityGap = arma::datum::nan;
+    fitResults_.warningCounts = diagnostics_.getCounts();
+    diagnostics_.summarize();
+
+    return (fitResults_);
+  }
+
+  /**
+   * @brief Optimize a model using the proximal stochastic variance reduced gradient procedure (prox-SVRG).
+   *
+   * @tparam T type of the tuning parameters of the proximal operator and the penalty
+   * @tparam U type of the tuning parameters of the smooth penalty
+   * @param model_ the model object derived from the model class in model.h. Must implement numberOfObservations and
+   * minibatchGradients
+   * @param startingValuesRcpp numericVector with starting values. The names are used as parameter labels
+   * @param proximalOperator_ a proximal operator for the penalty function
+   * @param penalty_ a penalty derived from the penalty class in penalty.h
+   * @param smoothPenalty_ a smooth penalty derived from the smoothPenalty class in smoothPenalty.h
+   * @param tuningParameters tuning parameters for the penalty function
+   * @param smoothTuningParameters tuning parameters for the smooth penalty function
+   * @param control_ settings for the svrg optimizer.
+   * @return fit result
+   */
+  template <typename T, typename U>
+  inline lessSEM::fitResults svrg(
+      model &model_,
+      numericVector startingValuesRcpp,
+      proximalOperator<T> &proximalOperator_,
+      penalty<T> &penalty_,
+      smoothPenalty<U> &smoothPenalty_,
+      const T &tuningParameters,
+      const U &smoothTuningParameters,
+      const controlSvrg &control_ = controlSvrgDefault())
+  {
+
+    return (
+        svrg(
+            model_,
+            toArmaVectorView(startingValuesRcpp),
+            startingValuesRcpp.names(),
+            proximalOperator_,
+            penalty_,
+            smoothPenalty_,
+            tuningParameters,
+            smoothTuningParameters,
+            control_));
+  }
+
+} // end namespace
+
+#endif